@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "matrix.h"
 #include "report.h"
 #include "host.h"
+#include "startup.h"
 
 
 #if (MATRIX_COLS > 16)
@@ -42,6 +43,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 static bool is_modified = false;
 static report_mouse_t mouse_report = {};
 
+static uint16_t adb_devices = 0;
+
+#ifdef ADB_MOUSE_ENABLE
+// mouse data received from poll scheduler
+static enum { MOUSE_NONE, MOUSE_DATA } mouse_state = MOUSE_NONE;
+static uint8_t mouse_buf[ADB_BUF_SIZE];
+static uint8_t mouse_len;
+#endif
+
 // matrix state buffer(1:on, 0:off)
 #if (MATRIX_COLS <= 8)
 static uint8_t matrix[MATRIX_ROWS];
@@ -67,16 +77,20 @@ uint8_t matrix_cols(void)
     return MATRIX_COLS;
 }
 
+/* time for keyboard to boot up and receive command(ms) */
+#ifndef ADB_BOOT_TIME
+#define ADB_BOOT_TIME   1000
+#endif
+
+static uint16_t init_deadline;
+static uint16_t led_deadline;
+static bool led_on = false;
+
 void matrix_init(void)
 {
     adb_host_init();
-    // wait for keyboard to boot up and receive command
-    _delay_ms(1000);
-    // Enable keyboard left/right modifier distinction
-    // Addr:Keyboard(0010), Cmd:Listen(10), Register3(11)
-    // upper byte: reserved bits 0000, device address 0010
-    // lower byte: device handler 00000011
-    adb_host_listen(0x2B,0x02,0x03);
+    // wait for keyboard to boot up and receive command in matrix_init_task
+    init_deadline = DEADLINE(ADB_BOOT_TIME);
 
     // initialize matrix state: all keys off
     for (uint8_t i=0; i < MATRIX_ROWS; i++) matrix[i] = 0x00;
@@ -87,72 +101,165 @@ void matrix_init(void)
     //debug_mouse = true;
     print("debug enabled.\n");
 
-    // LED flash
-    DDRD |= (1<<6); PORTD |= (1<<6);
-    _delay_ms(500);
-    DDRD |= (1<<6); PORTD &= ~(1<<6);
-
     return;
 }
 
+bool matrix_init_task(void)
+{
+    if (!DEADLINE_PASSED(init_deadline)) return false;
+
+    adb_devices = adb_host_find_devices();
+    // Enable keyboard left/right modifier distinction
+    // Addr:Keyboard(0010), Cmd:Listen(10), Register3(11)
+    // upper byte: reserved bits 0000, device address 0010
+    // lower byte: device handler 00000011
+    adb_host_listen(0x2B,0x02,0x03);
+    xprintf("ADB devices: %04X\n", adb_devices);
+
+    // LED flash: turned off in matrix_scan
+    DDRD |= (1<<6); PORTD |= (1<<6);
+    led_deadline = DEADLINE(500);
+    led_on = true;
+    return true;
+}
+
 #ifdef ADB_MOUSE_ENABLE
 
-#ifdef MAX
-#undef MAX
+/* mouse movement is scaled to this resolution(counts per inch) */
+#ifndef ADB_MOUSE_CPI
+#define ADB_MOUSE_CPI   400
 #endif
-#define MAX(X, Y) ((X) > (Y) ? (X) : (Y))
+
+static uint16_t mouse_scale = 256;      // 8.8 fixed point
+static int32_t mouse_acc_x = 0;         // movement not reported yet in 1/256 count
+static int32_t mouse_acc_y = 0;
+
+void adb_mouse_init(void)
+{
+    uint8_t buf[ADB_BUF_SIZE];
+    uint8_t handler = 0;
+    uint16_t cpi = 0;
+    uint8_t buttons = 1;
+
+    if (!(adb_devices & (1<<ADB_ADDR_MOUSE))) return;
+
+    // Extended Mouse Protocol: Listen Register3 with handler 4, SRQ enabled
+    adb_host_listen(ADB_CMD_LISTEN(ADB_ADDR_MOUSE, 3), 0x20 | ADB_ADDR_MOUSE, 0x04);
+    if (adb_host_talk_buf(ADB_CMD_TALK(ADB_ADDR_MOUSE, 3), buf, 2) == 2) {
+        handler = buf[1];
+    }
+
+    if (handler == 4) {
+        // Register1: vendor(4), resolution(2), class(1), number of buttons(1)
+        if (adb_host_talk_buf(ADB_CMD_TALK(ADB_ADDR_MOUSE, 1), buf, 8) == 8) {
+            cpi = (buf[4]<<8) | buf[5];
+            buttons = buf[7];
+        }
+    } else if (handler == 2) {
+        cpi = 200;
+    }
+    if (!cpi) cpi = 100;
+
+    mouse_scale = ((uint32_t)ADB_MOUSE_CPI * 256 + cpi/2) / cpi;
+    if (!mouse_scale) mouse_scale = 1;
+    xprintf("ADB mouse: handler:%u cpi:%u buttons:%u\n", handler, cpi, buttons);
+}
+
+/*
+ * Register0 of mouse
+ *     byte0: button1(0:pressed) | Y delta bit6-0
+ *     byte1: button2(0:pressed) | X delta bit6-0
+ * Extended protocol appends bytes with higher bits of delta
+ *     byteN: button | Y delta 3bits | button | X delta 3bits
+ * Delta is signed and its width is 7 + 3 * (number of appended bytes),
+ * up to two bytes are decoded.
+ */
+static void mouse_decode(const uint8_t *buf, uint8_t len)
+{
+    uint16_t x = buf[1] & 0x7F;
+    uint16_t y = buf[0] & 0x7F;
+    uint8_t bits = 7;
+    uint8_t buttons = 0;
+
+    if (!(buf[0] & 0x80)) buttons |= MOUSE_BTN1;
+    if (!(buf[1] & 0x80)) buttons |= MOUSE_BTN2;
+    for (uint8_t i = 2; i < len && i < 4; i++) {
+        x |= (uint16_t)(buf[i] & 0x07) << bits;
+        y |= (uint16_t)((buf[i] >> 4) & 0x07) << bits;
+        bits += 3;
+        if (!(buf[i] & 0x80)) buttons |= (1 << (2*i - 2));
+        if (!(buf[i] & 0x08)) buttons |= (1 << (2*i - 1));
+    }
+    // sign extension
+    if (x & (1U << (bits - 1))) x |= ~((1U << bits) - 1);
+    if (y & (1U << (bits - 1))) y |= ~((1U << bits) - 1);
+
+    mouse_report.buttons = buttons;
+    mouse_acc_x += (int32_t)(int16_t)x * mouse_scale;
+    mouse_acc_y += (int32_t)(int16_t)y * mouse_scale;
+}
+
+static mouse_xy_t mouse_take(int32_t *acc)
+{
+    // whole counts are reported, fraction and overflow are carried over
+    int32_t c = *acc / 256;
+    if (c >  MOUSE_XY_MAX) c =  MOUSE_XY_MAX;
+    if (c < -MOUSE_XY_MAX) c = -MOUSE_XY_MAX;
+    *acc -= c * 256;
+    return c;
+}
 
 void adb_mouse_task(void)
 {
-    uint16_t codes;
-    int16_t x, y;
-    static int8_t mouseacc; 
-    _delay_ms(12);  // delay for preventing overload of poor ADB keyboard controller
-    codes = adb_host_mouse_recv();
-    // If nothing received reset mouse acceleration, and quit. 
-    if (!codes) {
-        mouseacc = 1;
+    // mouse data is received by poll scheduler in matrix_scan
+    if (mouse_state == MOUSE_DATA) {
+        mouse_decode(mouse_buf, mouse_len);
+        mouse_state = MOUSE_NONE;
+    } else if (mouse_acc_x / 256 == 0 && mouse_acc_y / 256 == 0) {
         return;
-    };
-    // Bit sixteen is button.
-    if (~codes & (1 << 15))
-        mouse_report.buttons |= MOUSE_BTN1;
-    if (codes & (1 << 15))
-        mouse_report.buttons &= ~MOUSE_BTN1;
-    // lower seven bits are movement, as signed int_7. 
-    // low byte is X-axis, high byte is Y. 
-    y = (codes>>8 & 0x3F);
-    x = (codes>>0 & 0x3F);
-    // bit seven and fifteen is negative
-    // usb does not use int_8, but int_7 (measuring distance) with sign-bit. 
-    if (codes & (1 << 6))
-          x = (x-0x40);
-    if (codes & (1 << 14))
-         y = (y-0x40);
-    // Accelerate mouse. (They weren't meant to be used on screens larger than 320x200).
-    x *= mouseacc;
-    y *= mouseacc;
-    // Cap our two bytes per axis to one byte. 
-    // Easier with a MIN-function, but since -MAX(-a,-b) = MIN(a,b)...
-	 // I.E. MIN(MAX(x,-127),127) = -MAX(-MAX(x, -127), -127) = MIN(-MIN(-x,127),127)
-    mouse_report.x = -MAX(-MAX(x, -127), -127);
-    mouse_report.y = -MAX(-MAX(y, -127), -127);
+    }
+
+    mouse_report.x = mouse_take(&mouse_acc_x);
+    mouse_report.y = mouse_take(&mouse_acc_y);
     if (debug_mouse) {
-            print("adb_host_mouse_recv: "); print_bin16(codes); print("\n");
-            print("adb_mouse raw: [");
-            phex(mouseacc); print(" ");
+            print("adb_mouse: [");
             phex(mouse_report.buttons); print("|");
             print_decs(mouse_report.x); print(" ");
             print_decs(mouse_report.y); print("]\n");
     }
     // Send result by usb. 
     host_mouse_send(&mouse_report);
-    // increase acceleration of mouse
-    mouseacc += ( mouseacc < ADB_MOUSE_MAXACC ? 1 : 0 );
-    return;
 }
 #endif
 
+/* Polls device on bus and returns data of keyboard, or 0 when from others */
+static uint16_t adb_poll(void)
+{
+    uint8_t addr;
+    uint8_t buf[ADB_BUF_SIZE];
+    int8_t len = adb_host_poll(&addr, buf, sizeof(buf));
+
+    switch (addr) {
+        case ADB_ADDR_KEYBOARD:
+            if (len <= 0) return len;       // no data(0) or error(negative)
+            return (buf[0]<<8) | buf[1];
+#ifdef ADB_MOUSE_ENABLE
+        case ADB_ADDR_MOUSE:
+            if (len >= 2) {
+                for (uint8_t i = 0; i < len; i++) mouse_buf[i] = buf[i];
+                mouse_len = len;
+                mouse_state = MOUSE_DATA;
+            }
+            return 0;
+#endif
+        default:
+            if (len) {
+                dprintf("ADB addr:%u len:%d\n", addr, len);
+            }
+            return 0;
+    }
+}
+
 uint8_t matrix_scan(void)
 {
     /* extra_key is volatile and more convoluted than necessary because gcc refused
@@ -167,13 +274,17 @@ uint8_t matrix_scan(void)
 
     is_modified = false;
 
+    if (led_on && DEADLINE_PASSED(led_deadline)) {
+        DDRD |= (1<<6); PORTD &= ~(1<<6);
+        led_on = false;
+    }
+
     codes = extra_key;
     extra_key = 0xFFFF;
 
     if ( codes == 0xFFFF )
     {
-        _delay_ms(12);  // delay for preventing overload of poor ADB keyboard controller
-        codes = adb_host_kbd_recv();
+        codes = adb_poll();
     }
     key0 = codes>>8;
     key1 = codes&0xFF;
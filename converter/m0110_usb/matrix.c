@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "led.h"
 #include "m0110.h"
 #include "matrix.h"
+#include "startup.h"
 
 
 #define CAPS        0x39
@@ -58,26 +59,52 @@ uint8_t matrix_cols(void)
     return MATRIX_COLS;
 }
 
+static uint16_t init_deadline;
+static uint16_t led_deadline;
+static bool led_on = false;
+
 void matrix_init(void)
 {
     m0110_init();
+    init_deadline = DEADLINE(M0110_BOOT_TIME);
+
     // initialize matrix state: all keys off
     for (uint8_t i=0; i < MATRIX_ROWS; i++) _matrix0[i] = 0x00;
     matrix = _matrix0;
 
-    // LED flash
-    DDRD |= (1<<6); PORTD |= (1<<6);
-    _delay_ms(500);
-    DDRD |= (1<<6); PORTD &= ~(1<<6);
-
     return;
 }
 
+bool matrix_init_task(void)
+{
+    if (!DEADLINE_PASSED(init_deadline)) return false;
+
+    // LED flash: turned off in matrix_scan
+    DDRD |= (1<<6); PORTD |= (1<<6);
+    led_deadline = DEADLINE(500);
+    led_on = true;
+    return true;
+}
+
 uint8_t matrix_scan(void)
 {
     uint8_t key;
 
     is_modified = false;
+
+    if (led_on && DEADLINE_PASSED(led_deadline)) {
+        DDRD |= (1<<6); PORTD &= ~(1<<6);
+        led_on = false;
+    }
+    // release keys held when keyboard stops responding(unplugged)
+    if (m0110_error) {
+        for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+            if (matrix[i]) is_modified = true;
+            matrix[i] = 0x00;
+        }
+        if (is_modified) return 1;
+    }
+
     key = m0110_recv_key();
 
     if (key == M0110_NULL) {
@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "matrix.h"
 #include "debug.h"
 #include "protocol/serial.h"
+#include "startup.h"
 
 
 /*
@@ -61,34 +62,72 @@ uint8_t matrix_cols(void)
     return MATRIX_COLS;
 }
 
-static void pc98_inhibit_repeat(void)
+/*
+ * Inhibit repeat: send 9C and 70 with waiting for ACK(FA) of each.
+ * This runs as state machine from matrix_init_task and matrix_scan.
+ */
+static enum {
+    PC98_RETRY,
+    PC98_9C_ACK,
+    PC98_70,
+    PC98_70_ACK,
+    PC98_READY,
+} pc98_state = PC98_RETRY;
+static uint16_t pc98_deadline;
+
+static void pc98_inhibit_repeat(uint16_t wait)
 {
-    uint8_t code;
-
     while (serial_recv()) ;
-RETRY:
     PC98_RDY_PORT |= (1<<PC98_RDY_BIT);
-    _delay_ms(500);
-    serial_send(0x9C);
-
-    PC98_RDY_PORT &= ~(1<<PC98_RDY_BIT);
-    _delay_ms(100);
-    while (!(code = serial_recv())) ;
-    print("PC98: send 9C: "); print_hex8(code); print("\n");
-    if (code != 0xFA) goto RETRY;
-
-
+    pc98_deadline = DEADLINE(wait);
+    pc98_state = PC98_RETRY;
+}
 
-    PC98_RDY_PORT |= (1<<PC98_RDY_BIT);
-    _delay_ms(100);
-    serial_send(0x70);
+static bool pc98_inhibit_repeat_task(void)
+{
+    uint8_t code;
 
-    PC98_RDY_PORT &= ~(1<<PC98_RDY_BIT);
-    _delay_ms(100);
-    //code = serial_recv();
-    while (!(code = serial_recv())) ;
-    print("PC98: send 70: "); print_hex8(code); print("\n");
-    if (code != 0xFA) goto RETRY;
+    if (!DEADLINE_PASSED(pc98_deadline)) return false;
+
+    switch (pc98_state) {
+        case PC98_RETRY:
+            serial_send(0x9C);
+            PC98_RDY_PORT &= ~(1<<PC98_RDY_BIT);
+            pc98_deadline = DEADLINE(100);
+            pc98_state = PC98_9C_ACK;
+            break;
+        case PC98_9C_ACK:
+            if (!(code = serial_recv())) break;
+            print("PC98: send 9C: "); print_hex8(code); print("\n");
+            if (code != 0xFA) {
+                pc98_inhibit_repeat(500);
+                break;
+            }
+            PC98_RDY_PORT |= (1<<PC98_RDY_BIT);
+            pc98_deadline = DEADLINE(100);
+            pc98_state = PC98_70;
+            break;
+        case PC98_70:
+            serial_send(0x70);
+            PC98_RDY_PORT &= ~(1<<PC98_RDY_BIT);
+            pc98_deadline = DEADLINE(100);
+            pc98_state = PC98_70_ACK;
+            break;
+        case PC98_70_ACK:
+            if (!(code = serial_recv())) break;
+            print("PC98: send 70: "); print_hex8(code); print("\n");
+            if (code != 0xFA) {
+                pc98_inhibit_repeat(500);
+                break;
+            }
+            // PC98 ready
+            PC98_RDY_PORT &= ~(1<<PC98_RDY_BIT);
+            pc98_state = PC98_READY;
+            break;
+        case PC98_READY:
+            return true;
+    }
+    return false;
 }
 
 void matrix_init(void)
@@ -112,12 +151,8 @@ void matrix_init(void)
     PC98_RDY_PORT &= ~(1<<PC98_RDY_BIT);
 */
 
-    _delay_ms(500);
-    pc98_inhibit_repeat();
-
-
-    // PC98 ready
-    PC98_RDY_PORT &= ~(1<<PC98_RDY_BIT);
+    // wait 500ms for keyboard and 500ms with RDY high before first command
+    pc98_inhibit_repeat(1000);
 
     // initialize matrix state: all keys off
     for (uint8_t i=0; i < MATRIX_ROWS; i++) matrix[i] = 0x00;
@@ -126,10 +161,18 @@ void matrix_init(void)
     return;
 }
 
+bool matrix_init_task(void)
+{
+    return pc98_inhibit_repeat_task();
+}
+
 uint8_t matrix_scan(void)
 {
     is_modified = false;
 
+    // keyboard is being configured again
+    if (!pc98_inhibit_repeat_task()) return 0;
+
     uint16_t code;
     PC98_RDY_PORT |= (1<<PC98_RDY_BIT);
     _delay_us(30);
@@ -138,7 +181,7 @@ uint8_t matrix_scan(void)
     if (code == -1) return 0;
 
 if (code == 0x60) {
-    pc98_inhibit_repeat();
+    pc98_inhibit_repeat(500);
 
 /*
     PC98_RDY_PORT |= (1<<PC98_RDY_BIT);
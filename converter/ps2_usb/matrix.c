@@ -22,6 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "util.h"
 #include "debug.h"
 #include "ps2.h"
+#include "ps2_scancode.h"
 #include "matrix.h"
 
 
@@ -68,6 +69,8 @@ static uint8_t matrix[MATRIX_ROWS];
 
 static bool is_modified = false;
 
+static ps2_sc_decoder_t decoder;
+
 
 inline
 uint8_t matrix_rows(void)
@@ -85,6 +88,7 @@ void matrix_init(void)
 {
     debug_enable = true;
     ps2_host_init();
+    ps2_sc_init(&decoder, &ps2_sc_set2);
 
     // initialize matrix state: all keys off
     for (uint8_t i=0; i < MATRIX_ROWS; i++) matrix[i] = 0x00;
@@ -154,31 +158,11 @@ void matrix_init(void)
  *               And we need a ad hoc 'pseudo break code' hack to get the key off
  *               because it has no break code.
  *
+ * These are decoded by 'Scan Code Set 2' table of ps2_scancode.c,
+ * see tmk_core/tool/ps2_scancode/scancode.txt.
  */
 uint8_t matrix_scan(void)
 {
-
-    // scan code reading states
-    static enum {
-        INIT,
-        F0,
-        E0,
-        E0_F0,
-        // Pause
-        E1,
-        E1_14,
-        E1_14_77,
-        E1_14_77_E1,
-        E1_14_77_E1_F0,
-        E1_14_77_E1_F0_14,
-        E1_14_77_E1_F0_14_F0,
-        // Control'd Pause
-        E0_7E,
-        E0_7E_E0,
-        E0_7E_E0_F0,
-    } state = INIT;
-
-
     is_modified = false;
 
     // 'pseudo break code' hack
@@ -187,196 +171,21 @@ uint8_t matrix_scan(void)
     }
 
     uint8_t code = ps2_host_recv();
-    if (code) xprintf("%i\r\n", code);
     if (!ps2_error) {
-        switch (state) {
-            case INIT:
-                switch (code) {
-                    case 0xE0:
-                        state = E0;
-                        break;
-                    case 0xF0:
-                        state = F0;
-                        break;
-                    case 0xE1:
-                        state = E1;
-                        break;
-                    case 0x83:  // F7
-                        matrix_make(F7);
-                        state = INIT;
-                        break;
-                    case 0x84:  // Alt'd PrintScreen
-                        matrix_make(PRINT_SCREEN);
-                        state = INIT;
-                        break;
-                    case 0x00:  // Overrun [3]p.25
-                        matrix_clear();
-                        clear_keyboard();
-                        print("Overrun\n");
-                        state = INIT;
-                        break;
-                    default:    // normal key make
-                        if (code < 0x80) {
-                            matrix_make(code);
-                        } else {
-                            matrix_clear();
-                            clear_keyboard();
-                            xprintf("unexpected scan code at INIT: %02X\n", code);
-                        }
-                        state = INIT;
-                }
-                break;
-            case E0:    // E0-Prefixed
-                switch (code) {
-                    case 0x12:  // to be ignored
-                    case 0x59:  // to be ignored
-                        state = INIT;
-                        break;
-                    case 0x7E:  // Control'd Pause
-                        state = E0_7E;
-                        break;
-                    case 0xF0:
-                        state = E0_F0;
-                        break;
-                    default:
-                        if (code < 0x80) {
-                            matrix_make(code|0x80);
-                        } else {
-                            matrix_clear();
-                            clear_keyboard();
-                            xprintf("unexpected scan code at E0: %02X\n", code);
-                        }
-                        state = INIT;
-                }
-                break;
-            case F0:    // Break code
-                switch (code) {
-                    case 0x83:  // F7
-                        matrix_break(F7);
-                        state = INIT;
-                        break;
-                    case 0x84:  // Alt'd PrintScreen
-                        matrix_break(PRINT_SCREEN);
-                        state = INIT;
-                        break;
-                    case 0xF0:
-                        matrix_clear();
-                        clear_keyboard();
-                        xprintf("unexpected scan code at F0: F0(clear and cont.)\n");
-                        break;
-                    default:
-                    if (code < 0x80) {
-                        matrix_break(code);
-                    } else {
-                        matrix_clear();
-                        clear_keyboard();
-                        xprintf("unexpected scan code at F0: %02X\n", code);
-                    }
-                    state = INIT;
-                }
-                break;
-            case E0_F0: // Break code of E0-prefixed
-                switch (code) {
-                    case 0x12:  // to be ignored
-                    case 0x59:  // to be ignored
-                        state = INIT;
-                        break;
-                    default:
-                        if (code < 0x80) {
-                            matrix_break(code|0x80);
-                        } else {
-                            matrix_clear();
-                            clear_keyboard();
-                            xprintf("unexpected scan code at E0_F0: %02X\n", code);
-                        }
-                        state = INIT;
-                }
-                break;
-            // following are states of Pause
-            case E1:
-                switch (code) {
-                    case 0x14:
-                        state = E1_14;
-                        break;
-                    default:
-                        state = INIT;
-                }
-                break;
-            case E1_14:
-                switch (code) {
-                    case 0x77:
-                        state = E1_14_77;
-                        break;
-                    default:
-                        state = INIT;
-                }
-                break;
-            case E1_14_77:
-                switch (code) {
-                    case 0xE1:
-                        state = E1_14_77_E1;
-                        break;
-                    default:
-                        state = INIT;
-                }
-                break;
-            case E1_14_77_E1:
-                switch (code) {
-                    case 0xF0:
-                        state = E1_14_77_E1_F0;
-                        break;
-                    default:
-                        state = INIT;
-                }
-                break;
-            case E1_14_77_E1_F0:
-                switch (code) {
-                    case 0x14:
-                        state = E1_14_77_E1_F0_14;
-                        break;
-                    default:
-                        state = INIT;
-                }
-                break;
-            case E1_14_77_E1_F0_14:
-                switch (code) {
-                    case 0xF0:
-                        state = E1_14_77_E1_F0_14_F0;
-                        break;
-                    default:
-                        state = INIT;
-                }
-                break;
-            case E1_14_77_E1_F0_14_F0:
-                switch (code) {
-                    case 0x77:
-                        matrix_make(PAUSE);
-                        state = INIT;
-                        break;
-                    default:
-                        state = INIT;
-                }
-                break;
-            // Following are states of Control'd Pause
-            case E0_7E:
-                if (code == 0xE0)
-                    state = E0_7E_E0;
-                else
-                    state = INIT;
+        uint8_t pos;
+        switch (ps2_sc_decode(&decoder, code, &pos)) {
+            case PS2_SC_MAKE:
+            case PS2_SC_TAP:
+                matrix_make(pos);
                 break;
-            case E0_7E_E0:
-                if (code == 0xF0)
-                    state = E0_7E_E0_F0;
-                else
-                    state = INIT;
+            case PS2_SC_BREAK:
+                matrix_break(pos);
                 break;
-            case E0_7E_E0_F0:
-                if (code == 0x7E)
-                    matrix_make(PAUSE);
-                state = INIT;
+            case PS2_SC_CLEAR:
+                matrix_clear();
+                clear_keyboard();
+                xprintf("unexpected scan code: %02X\n", code);
                 break;
-            default:
-                state = INIT;
         }
     }
 
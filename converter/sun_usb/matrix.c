@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "matrix.h"
 #include "debug.h"
 #include "protocol/serial.h"
+#include "startup.h"
 
 
 /*
@@ -72,26 +73,61 @@ void matrix_init(void)
     // initialize matrix state: all keys off
     for (uint8_t i=0; i < MATRIX_ROWS; i++) matrix[i] = 0x00;
 
-    // wait for keyboard coming up
-    // otherwise LED status update fails
     print("Reseting ");
-    while (1) {
-        print(".");
-        while (serial_recv());
-        serial_send(0x01);
-        _delay_ms(500);
-        if (serial_recv() == 0xFF) {
-            _delay_ms(500);
-            if (serial_recv() == 0x04)
-                break;
-        }
-    }
-    print(" Done\n");
     return;
 }
 
+/*
+ * wait for keyboard coming up, otherwise LED status update fails
+ *
+ * Reset(01) is sent every 500ms until keyboard responds with FF 04.
+ */
+bool matrix_init_task(void)
+{
+    static enum { RESET, RESET_WAIT, RESET_FF } state = RESET;
+    static uint16_t deadline;
+    uint8_t code;
+
+    switch (state) {
+        case RESET:
+            print(".");
+            while (serial_recv());
+            serial_send(0x01);
+            deadline = DEADLINE(500);
+            state = RESET_WAIT;
+            break;
+        case RESET_WAIT:
+            if ((code = serial_recv())) {
+                if (code == 0xFF) {
+                    deadline = DEADLINE(500);
+                    state = RESET_FF;
+                } else {
+                    state = RESET;
+                }
+            } else if (DEADLINE_PASSED(deadline)) {
+                state = RESET;
+            }
+            break;
+        case RESET_FF:
+            if ((code = serial_recv())) {
+                if (code == 0x04) {
+                    print(" Done\n");
+                    return true;
+                }
+                state = RESET;
+            } else if (DEADLINE_PASSED(deadline)) {
+                state = RESET;
+            }
+            break;
+    }
+    return false;
+}
+
 uint8_t matrix_scan(void)
 {
+    // response which has a byte of parameter
+    static uint8_t response = 0;
+
     is_modified = false;
 
     uint8_t code;
@@ -100,26 +136,34 @@ uint8_t matrix_scan(void)
 
     debug_hex(code); debug(" ");
 
-    switch (code) {
+    switch (response) {
         case 0xFF:  // reset success: FF 04
-            print("reset: ");
-            _delay_ms(500);
-            code = serial_recv();
             xprintf("%02X\n", code);
             if (code == 0x04) {
                 // LED status
                 led_set(host_keyboard_leds());
             }
+            response = 0;
             return 0;
         case 0xFE:  // layout: FE <layout>
+        case 0x7E:  // reset fail: 7E 01
+            xprintf("%02X\n", code);
+            response = 0;
+            return 0;
+    }
+
+    switch (code) {
+        case 0xFF:
+            print("reset: ");
+            response = code;
+            return 0;
+        case 0xFE:
             print("layout: ");
-            _delay_ms(500);
-            xprintf("%02X\n", serial_recv());
+            response = code;
             return 0;
-        case 0x7E:  // reset fail: 7E 01
+        case 0x7E:
             print("reset fail: ");
-            _delay_ms(500);
-            xprintf("%02X\n", serial_recv());
+            response = code;
             return 0;
         case 0x7F:
             // all keys up
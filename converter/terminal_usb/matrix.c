@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "util.h"
 #include "debug.h"
 #include "ps2.h"
+#include "ps2_scancode.h"
 #include "matrix.h"
 
 
@@ -51,6 +52,8 @@ static uint8_t matrix[MATRIX_ROWS];
 
 static bool is_modified = false;
 
+static ps2_sc_decoder_t decoder;
+
 
 inline
 uint8_t matrix_rows(void)
@@ -90,7 +93,6 @@ uint8_t matrix_scan(void)
         KBD_ID1,
         CONFIG,
         READY,
-        F0,
     } state = RESET;
 
     is_modified = false;
@@ -133,39 +135,28 @@ uint8_t matrix_scan(void)
             debug("wF8 ");
             if (ps2_host_send(0xF8) == 0xFA) {
                 debug("[ack]\nREADY\n");
+                ps2_sc_init(&decoder, &ps2_sc_set3);
                 state = READY;
             }
             break;
         case READY:
-            switch (code) {
-                case 0x00:
-                    break;
-                case 0xF0:
-                    state = F0;
-                    debug(" ");
-                    break;
-                default:    // normal key make
-                    if (code < 0x88) {
-                        matrix_make(code);
-                    } else {
-                        debug("unexpected scan code at READY: "); debug_hex(code); debug("\n");
-                    }
-                    state = READY;
-                    debug("\n");
-            }
-            break;
-        case F0:    // Break code
-            switch (code) {
-                case 0x00:
-                    break;
-                default:
-                    if (code < 0x88) {
-                        matrix_break(code);
-                    } else {
-                        debug("unexpected scan code at F0: "); debug_hex(code); debug("\n");
-                    }
-                    state = READY;
-                    debug("\n");
+            if (code && !ps2_error) {
+                uint8_t pos;
+                switch (ps2_sc_decode(&decoder, code, &pos)) {
+                    case PS2_SC_MAKE:
+                        matrix_make(pos);
+                        debug("\n");
+                        break;
+                    case PS2_SC_BREAK:
+                        matrix_break(pos);
+                        debug("\n");
+                        break;
+                    case PS2_SC_CLEAR:
+                        debug("unexpected scan code: "); debug_hex(code); debug("\n");
+                        break;
+                    default:
+                        debug(" ");
+                }
             }
             break;
     }
@@ -33,6 +33,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MATRIX_ROWS 16
 #define MATRIX_COLS 16
 
+/* matrix.c queues key changes of each report for keyboard_task */
+#define MATRIX_HAS_CHANGE_LIST
+
+/* send report of keys mapped to themselves without action processing */
+//#define NO_USB_PASSTHROUGH
+
 /* key combination for command */
 #define IS_COMMAND() (keyboard_report->mods == (MOD_BIT(KC_LSHIFT) | MOD_BIT(KC_RSHIFT))) 
 
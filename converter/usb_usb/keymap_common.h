@@ -32,6 +32,26 @@ extern const uint8_t keymaps[][MATRIX_ROWS][MATRIX_COLS];
 extern const uint16_t fn_actions[];
 
 
+/* Mouse buttons of USB mouse are keys E8-EC, define these in keymap file
+ * before including this to put other actions on them, e.g. KC_FN0 for layer.
+ */
+#ifndef KEYMAP_MOUSE_BTN1
+#define KEYMAP_MOUSE_BTN1   KC_BTN1
+#endif
+#ifndef KEYMAP_MOUSE_BTN2
+#define KEYMAP_MOUSE_BTN2   KC_BTN2
+#endif
+#ifndef KEYMAP_MOUSE_BTN3
+#define KEYMAP_MOUSE_BTN3   KC_BTN3
+#endif
+#ifndef KEYMAP_MOUSE_BTN4
+#define KEYMAP_MOUSE_BTN4   KC_BTN4
+#endif
+#ifndef KEYMAP_MOUSE_BTN5
+#define KEYMAP_MOUSE_BTN5   KC_BTN5
+#endif
+
+
 /*         ,---------------. ,---------------. ,---------------.
  *         |F13|F14|F15|F16| |F17|F18|F19|F20| |F21|F22|F23|F24|
  * ,---.   |---------------| |---------------| |---------------| ,-----------. ,---------------. ,-------.
@@ -110,7 +130,8 @@ extern const uint16_t fn_actions[];
     { KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,      /* D0-D7 */ \
       KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO    }, /* D8-DF */ \
     { KC_##KE0, KC_##KE1, KC_##KE2, KC_##KE3, KC_##KE4, KC_##KE5, KC_##KE6, KC_##KE7,   /* E0-E7 */ \
-      KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO    }, /* E8-EF */ \
+      KEYMAP_MOUSE_BTN1, KEYMAP_MOUSE_BTN2, KEYMAP_MOUSE_BTN3, KEYMAP_MOUSE_BTN4,       /* E8-EB */ \
+      KEYMAP_MOUSE_BTN5, KC_NO, KC_NO, KC_NO },                                         /* EC-EF */ \
     { KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,      /* F0-F7 */ \
       KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO    }, /* F8-FF */ \
 }
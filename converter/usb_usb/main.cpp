@@ -7,8 +7,8 @@
 #include "Usb.h"
 #include "usbhub.h"
 #include "hid.h"
-#include "hidboot.h"
 #include "parser.h"
+#include "usb_hid.h"
 
 // LUFA
 #include "lufa.h"
@@ -18,6 +18,8 @@
 #include "debug.h"
 #include "keyboard.h"
 #include "led.h"
+#include "host.h"
+#include "mousekey.h"
 
 
 /* LED ping configuration */
@@ -65,20 +67,66 @@ static void LUFA_setup(void)
 
 
 /*
- * USB Host Shield HID keyboard
+ * USB Host Shield HID keyboard and mouse
+ * Report protocol with descriptor parsing, boot protocol as fallback.
+ * Keys of keyboards on hub are merged, e.g. keyboard and numpad, and so is
+ * pointer of mouse or composite device.
  */
 USB usb_host;
 USBHub hub1(&usb_host);
-HIDBoot<HID_PROTOCOL_KEYBOARD>    kbd(&usb_host);
-KBDReportParser kbd_parser;
+HIDReportKeyboard kbd1(&usb_host);
+HIDReportKeyboard kbd2(&usb_host);
 
 
+/* sent by host task, see HIDReportKeyboard::Poll() */
 void led_set(uint8_t usb_led)
 {
-    kbd.SetReport(0, 0, 2, 0, 1, &usb_led);
+    kbd1.SetLeds(usb_led);
+    kbd2.SetLeds(usb_led);
 }
 
 
+#ifdef MOUSE_ENABLE
+static int16_t mouse_take(int16_t *acc, int16_t limit)
+{
+    // rest is carried over to next frame
+    int16_t d = (*acc > limit) ? limit : (*acc < -limit ? -limit : *acc);
+    *acc -= d;
+    return d;
+}
+
+/* motion of all pointers is sent at most once a frame(1ms) */
+static void mouse_task(void)
+{
+    static uint16_t last_frame = 0;
+    static uint8_t last_buttons = 0;
+
+#ifdef MOUSEKEY_ENABLE
+    // buttons are keys on keymap and held by mouse keys
+    uint8_t buttons = mousekey_buttons();
+#else
+    uint8_t buttons = usb_hid_keyboard_bits[USB_HID_MOUSE_BUTTON / 8];
+#endif
+    if (!usb_hid_mouse.x && !usb_hid_mouse.y && !usb_hid_mouse.v && !usb_hid_mouse.h &&
+            buttons == last_buttons) {
+        return;
+    }
+    if (timer_read() == last_frame) return;
+    last_frame = timer_read();
+    last_buttons = buttons;
+
+    report_mouse_t report;
+    report.buttons = buttons;
+    report.x = mouse_take(&usb_hid_mouse.x, MOUSE_XY_MAX);
+    report.y = mouse_take(&usb_hid_mouse.y, MOUSE_XY_MAX);
+    // a detent of device is multiple units when host enables Resolution Multiplier
+    report.v = mouse_take(&usb_hid_mouse.v, 127 / host_mouse_wheel_res()) * host_mouse_wheel_res();
+    report.h = mouse_take(&usb_hid_mouse.h, 127 / host_mouse_pan_res()) * host_mouse_pan_res();
+    host_mouse_send(&report);
+}
+#endif
+
+
 
 int main(void)
 {
@@ -96,7 +144,6 @@ int main(void)
 
     // USB Host Shield setup
     usb_host.Init();
-    kbd.SetReportParser(0, (HIDReportParser*)&kbd_parser);
 
     /* NOTE: Don't insert time consuming job here.
      * It'll cause unclear initialization failure when DFU reset(worm start).
@@ -122,6 +169,10 @@ if (timer > 100) {
     debug("host.Task: "); debug_hex16(timer);  debug("\n");
 }
 
+#ifdef MOUSE_ENABLE
+        mouse_task();
+#endif
+
 #if !defined(INTERRUPT_CONTROL_ENDPOINT)
         // LUFA Task for control request
         USB_USBTask();
@@ -23,6 +23,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "print.h"
 #include "debug.h"
 #include "matrix.h"
+#include "action.h"
+#include "action_layer.h"
+#include "action_tapping.h"
+#include "action_util.h"
 
 /* KEY CODE to Matrix
  *
@@ -46,7 +50,28 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define CODE(row, col)  (((row) << 4) | (col))
 #define ROW(code)       (((code) & ROW_MASK) >> 4)
 #define COL(code)       ((code) & COL_MASK)
-#define ROW_BITS(code)  (1 << COL(code))
+
+
+/* Key changes
+ *
+ * Key bitmap of new report is compared with keys already handed to
+ * keyboard_task row by row with XOR, and changed keys are queued once per
+ * report. keyboard_task pops a change with matrix_get_change() instead of
+ * comparing every row on each call.
+ */
+#define CHANGE_MAX  32
+
+static struct {
+    uint8_t code;
+    bool pressed;
+} change_list[CHANGE_MAX];
+static uint8_t change_head = 0;
+static uint8_t change_count = 0;
+
+/* keys handed to keyboard_task */
+static matrix_row_t matrix_prev[MATRIX_ROWS];
+/* report isn't queued yet */
+static bool matrix_dirty = false;
 
 
 uint8_t matrix_rows(void) { return MATRIX_ROWS; }
@@ -56,18 +81,135 @@ bool matrix_has_ghost(void) { return false; }
 
 static bool matrix_is_mod =false;
 
+static void matrix_queue_changes(void)
+{
+    change_head = 0;
+    change_count = 0;
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        matrix_row_t change = matrix_get_row(r) ^ matrix_prev[r];
+        for (uint8_t c = 0; change; c++, change >>= 1) {
+            if (!(change & 1)) continue;
+            if (change_count == CHANGE_MAX) {
+                // rest of changes are queued after these are processed
+                matrix_dirty = true;
+                return;
+            }
+            matrix_prev[r] ^= ((matrix_row_t)1<<c);
+            change_list[change_count].code = CODE(r, c);
+            change_list[change_count].pressed = matrix_prev[r] & ((matrix_row_t)1<<c);
+            change_count++;
+        }
+    }
+}
+
+#ifndef NO_USB_PASSTHROUGH
+/* Passthrough
+ *
+ * While every key in new and old report maps to itself on current layers
+ * and no tap key is in progress the action pipeline would only copy keys,
+ * so host report is rebuilt from key bitmap directly. Keys are resolved
+ * on first use and cached until layer state changes. Anything else falls
+ * back to change list at once.
+ */
+static uint8_t ident_checked[HID_PLAN_BITS_SIZE];
+static uint8_t ident_keys[HID_PLAN_BITS_SIZE];
+static uint32_t ident_layer_state = 0;
+static uint32_t ident_default_layer_state = 0;
+
+static bool key_is_identity(uint8_t code)
+{
+    action_t action = layer_switch_get_action((keypos_t){ .row = ROW(code), .col = COL(code) });
+    return action.code == ACTION_KEY(code);
+}
+
+static bool matrix_passthrough(void)
+{
+    if (!action_tapping_idle()) return false;
+
+    if (ident_layer_state != layer_state || ident_default_layer_state != default_layer_state) {
+        ident_layer_state = layer_state;
+        ident_default_layer_state = default_layer_state;
+        for (uint8_t i = 0; i < HID_PLAN_BITS_SIZE; i++) {
+            ident_checked[i] = 0;
+        }
+    }
+
+    for (uint8_t i = 0; i < HID_PLAN_BITS_SIZE; i++) {
+        // a row of matrix_prev is two bytes of key bitmap
+        uint8_t keys = usb_hid_keyboard_bits[i] | (uint8_t)(matrix_prev[i / 2] >> ((i & 1) * 8));
+        uint8_t unchecked = keys & ~ident_checked[i];
+        for (uint8_t b = 0; unchecked; b++, unchecked >>= 1) {
+            if (!(unchecked & 1)) continue;
+            if (key_is_identity(i * 8 + b)) {
+                ident_keys[i] |= (1<<b);
+            } else {
+                ident_keys[i] &= ~(1<<b);
+            }
+            ident_checked[i] |= (1<<b);
+        }
+        if (keys & ~ident_keys[i]) return false;
+    }
+
+    uint8_t mods = usb_hid_keyboard_bits[KC_LCTRL / 8];
+#ifdef COMMAND_ENABLE
+    // command is handled in action pipeline
+    uint8_t real_mods = keyboard_report->mods;
+    keyboard_report->mods = mods;
+    bool is_command = IS_COMMAND();
+    keyboard_report->mods = real_mods;
+    if (is_command) return false;
+#endif
+
+    clear_keys();
+    set_mods(mods);
+    for (uint8_t i = 0; i < KC_LCTRL / 8; i++) {
+        uint8_t bits = usb_hid_keyboard_bits[i];
+        for (uint8_t b = 0; bits; b++, bits >>= 1) {
+            if (bits & 1) add_key(i * 8 + b);
+        }
+    }
+    send_keyboard_report();
+
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        matrix_prev[r] = matrix_get_row(r);
+    }
+    return true;
+}
+#endif
+
 uint8_t matrix_scan(void) {
     static uint16_t last_time_stamp = 0;
 
     if (last_time_stamp != usb_hid_time_stamp) {
         last_time_stamp = usb_hid_time_stamp;
         matrix_is_mod = true;
+        matrix_dirty = true;
     } else {
         matrix_is_mod = false;
     }
+
+    // keep order of events: new report is queued after older changes
+    if (matrix_dirty && change_head == change_count) {
+        matrix_dirty = false;
+#ifndef NO_USB_PASSTHROUGH
+        if (matrix_passthrough()) return 1;
+#endif
+        matrix_queue_changes();
+    }
     return 1;
 }
 
+bool matrix_get_change(keypos_t *key, bool *pressed) {
+    if (change_head == change_count) {
+        return false;
+    }
+    key->row = ROW(change_list[change_head].code);
+    key->col = COL(change_list[change_head].code);
+    *pressed = change_list[change_head].pressed;
+    change_head++;
+    return true;
+}
+
 bool matrix_is_modified(void) {
 
     return matrix_is_mod;
@@ -75,45 +217,18 @@ bool matrix_is_modified(void) {
 
 bool matrix_is_on(uint8_t row, uint8_t col) {
     uint8_t code = CODE(row, col);
-
-    if (IS_MOD(code)) {
-        if (usb_hid_keyboard_report.mods & ROW_BITS(code)) {
-            return true;
-        }
-    }
-    for (uint8_t i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
-        if (usb_hid_keyboard_report.keys[i] == code) {
-            return true;
-        }
-    }
-    return false;
+    return usb_hid_keyboard_bits[code >> 3] & (1 << (code & 7));
 }
 
+/* a row is two bytes of key bitmap */
 matrix_row_t matrix_get_row(uint8_t row) {
-    uint16_t row_bits = 0;
-
-    if (IS_MOD(CODE(row, 0)) && usb_hid_keyboard_report.mods) {
-        row_bits |= usb_hid_keyboard_report.mods;
-    }
-
-    for (uint8_t i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
-        if (IS_ANY(usb_hid_keyboard_report.keys[i])) {
-            if (row == ROW(usb_hid_keyboard_report.keys[i])) {
-                row_bits |= ROW_BITS(usb_hid_keyboard_report.keys[i]);
-            }
-        }
-    }
-    return row_bits;
+    return usb_hid_keyboard_bits[row * 2] | ((matrix_row_t)usb_hid_keyboard_bits[row * 2 + 1] << 8);
 }
 
 uint8_t matrix_key_count(void) {
     uint8_t count = 0;
-
-    count += bitpop(usb_hid_keyboard_report.mods);
-    for (uint8_t i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
-        if (IS_ANY(usb_hid_keyboard_report.keys[i])) {
-            count++;
-        }
+    for (uint8_t i = 0; i < HID_PLAN_BITS_SIZE; i++) {
+        count += bitpop(usb_hid_keyboard_bits[i]);
     }
     return count;
 }
@@ -15,12 +15,19 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "keymap_common.h"
+#ifdef SPARSE_KEYMAP_ENABLE
+#include "keymap_sparse.h"
+#endif
 
 
 /* translates key to keycode */
 uint8_t keymap_key_to_keycode(uint8_t layer, keypos_t key)
 {
+#ifdef SPARSE_KEYMAP_ENABLE
+    return keymap_sparse_keycode(layer, key);
+#else
     return pgm_read_byte(&keymaps[(layer)][(key.row)][(key.col)]);
+#endif
 }
 
 /* translates Fn keycode to action */
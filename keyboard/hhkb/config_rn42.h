@@ -78,8 +78,18 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
         DDRD |= (1<<5); PORTD &= ~(1<<5);   /* RTS for flow control by firmware */ \
         sei(); \
     } while(0)
-    #define SERIAL_UART_RTS_LO()    do { PORTD &= ~(1<<5); } while (0)
-    #define SERIAL_UART_RTS_HI()    do { PORTD |=  (1<<5); } while (0)
+    /* PD5 is shared with wake pulse of RN-42, see rn42.c */
+    #ifndef __ASSEMBLER__
+    void rn42_rx_hold(void);
+    void rn42_rx_release(void);
+    #endif
+    #define SERIAL_UART_RTS_LO()    rn42_rx_release()
+    #define SERIAL_UART_RTS_HI()    rn42_rx_hold()
+    /* buffered transmit with flow control by RTS of RN-42(PF1: low when allowed to send) */
+    #define SERIAL_UART_TXD_VECT    USART1_UDRE_vect
+    #define SERIAL_UART_TXD_INT_ON()    do { UCSR1B |=  (1<<UDRIE1); } while (0)
+    #define SERIAL_UART_TXD_INT_OFF()   do { UCSR1B &= ~(1<<UDRIE1); } while (0)
+    #define SERIAL_UART_CTS         (!(PINF&(1<<1)))
 #else
     #error "USART configuration is needed."
 #endif
@@ -30,11 +30,18 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <avr/wdt.h>
 #include "suspend.h"
 #include "lufa.h"
+#ifdef POWER_POLICY_ENABLE
+#include "power_policy.h"
+#endif
 
 
 // matrix power saving
+#ifndef POWER_POLICY_ENABLE
+#ifndef MATRIX_POWER_SAVE
 #define MATRIX_POWER_SAVE       10000
+#endif
 static uint32_t matrix_last_modified = 0;
+#endif
 
 // matrix state buffer(1:on, 0:off)
 static matrix_row_t *matrix;
@@ -140,13 +147,19 @@ uint8_t matrix_scan(void)
             _delay_us(75);
 #endif
         }
+#ifndef POWER_POLICY_ENABLE
         if (matrix[row] ^ matrix_prev[row]) matrix_last_modified = timer_read32();
+#endif
     }
     // power off
     if (KEY_POWER_STATE() &&
             (USB_DeviceState == DEVICE_STATE_Suspended ||
              USB_DeviceState == DEVICE_STATE_Unattached ) &&
+#ifdef POWER_POLICY_ENABLE
+            power_policy_state() == POWER_SLEEP) {
+#else
             timer_elapsed32(matrix_last_modified) > MATRIX_POWER_SAVE) {
+#endif
         KEY_POWER_OFF();
         suspend_power_down();
     }
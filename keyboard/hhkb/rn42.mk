@@ -9,4 +9,10 @@ SRC +=  serial_uart.c \
 
 OPT_DEFS += -DPROTOCOL_RN42
 
+# USB and Bluetooth output through host routing driver
+HOST_ROUTE_ENABLE = yes
+
+# Step down link and matrix power with key activity
+POWER_POLICY_ENABLE = yes
+
 VPATH += $(RN42_DIR)
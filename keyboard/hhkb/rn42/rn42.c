@@ -1,4 +1,6 @@
+#include <string.h>
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include "host.h"
 #include "host_driver.h"
 #include "serial.h"
@@ -70,15 +72,17 @@ const char *rn42_gets(uint16_t timeout)
     return s;
 }
 
-void rn42_putc(uint8_t c)
+bool rn42_putc(uint8_t c)
 {
-    serial_send(c);
+    return serial_send(c);
 }
 
-void rn42_puts(char *s)
+// stops at a character dropped while module prohibits sending
+bool rn42_puts(char *s)
 {
     while (*s)
-	serial_send(*s++);
+	if (!serial_send(*s++)) return false;
+    return true;
 }
 
 bool rn42_autoconnecting(void)
@@ -108,18 +112,39 @@ bool rn42_rts(void)
     return PINF&(1<<1);
 }
 
+/*
+ * PD5(CTS) is shared by wake pulse and RX flow control of serial_uart,
+ * SERIAL_UART_RTS_HI/LO in config_rn42.h. It is kept high while either of
+ * them holds it, so that RX buffer drained never cuts wake pulse short.
+ */
+#define CTS_HOLD_WAKE   (1<<0)
+#define CTS_HOLD_RX     (1<<1)
+static volatile uint8_t cts_hold = 0;
+
+static void cts_set(uint8_t hold, bool on)
+{
+    uint8_t sreg = SREG;
+    cli();
+    if (on) cts_hold |= hold; else cts_hold &= ~hold;
+    if (cts_hold) PORTD |= (1<<5); else PORTD &= ~(1<<5);
+    SREG = sreg;
+}
+
 void rn42_cts_hi(void)
 {
     // not allow to send
-    PORTD |= (1<<5);
+    cts_set(CTS_HOLD_WAKE, true);
 }
 
 void rn42_cts_lo(void)
 {
     // allow to send
-    PORTD &= ~(1<<5);
+    cts_set(CTS_HOLD_WAKE, false);
 }
 
+void rn42_rx_hold(void)    { cts_set(CTS_HOLD_RX, true); }
+void rn42_rx_release(void) { cts_set(CTS_HOLD_RX, false); }
+
 bool rn42_linked(void)
 {
     // RN-42 GPIO2
@@ -134,44 +159,161 @@ static uint8_t leds = 0;
 static uint8_t keyboard_leds(void) { return leds; }
 void rn42_set_leds(uint8_t l) { leds = l; }
 
+/*
+ * Raw mode frames
+ *     Frames wait in a short queue and each is handed to UART TX buffer as
+ *     a whole when it fits, in the order reported. Unsent frame at tail is
+ *     updated by newer report only when no press or release is lost; that
+ *     is, it released nothing and all of its keys, mods or usages are still
+ *     down in newer one. Mouse frame with the same buttons gets motion of
+ *     newer one added unless it overflows. Otherwise newer frame is queued.
+ */
+#define FRAME_SIZE  11
+#define FRAME_QUEUE 4
+
+typedef struct {
+    uint8_t data[FRAME_SIZE];
+    uint8_t len;
+    bool release;   // something is released since previous frame of its type
+} frame_t;
+
+static frame_t frames[FRAME_QUEUE];
+static uint8_t frame_head = 0;
+static uint8_t frame_count = 0;
+
+/*
+ * Wake from deep sleep
+ *     With deep sleep enabled(SW,8xxx) RN-42 sleeps after 1 sec of no
+ *     traffic and loses first character received while sleeping. Before
+ *     sending after a pause CTS is toggled low to high and frames are held
+ *     for 5ms until the module is up.
+ */
+#define RN42_SLEEP_AFTER    900
+#define RN42_WAKE_TIME      5
+
+static uint32_t last_send = 0;
+static uint16_t wake_timer = 0;
+static bool waking = false;
+
+// returns true when module is ready to receive
+static bool wake_check(void)
+{
+    if (waking) {
+        if (timer_elapsed(wake_timer) < RN42_WAKE_TIME) return false;
+        rn42_cts_lo();
+        waking = false;
+    } else if (timer_elapsed32(last_send) > RN42_SLEEP_AFTER) {
+        rn42_cts_hi();
+        wake_timer = timer_read();
+        waking = true;
+        return false;
+    }
+    last_send = timer_read32();
+    return true;
+}
+
+void rn42_send_task(void)
+{
+    while (frame_count) {
+        frame_t *f = &frames[frame_head];
+        if (serial_send_space() < f->len || !wake_check()) break;
+        for (uint8_t i = 0; i < f->len; i++) {
+            serial_send(f->data[i]);
+        }
+        frame_head = (frame_head + 1) % FRAME_QUEUE;
+        frame_count--;
+    }
+    serial_send_task();
+}
+
+// unsent frame at tail if it is of the type
+static frame_t *frame_tail(uint8_t type)
+{
+    if (!frame_count) return NULL;
+    frame_t *f = &frames[(frame_head + frame_count - 1) % FRAME_QUEUE];
+    return (f->data[2] == type) ? f : NULL;
+}
+
+static frame_t *frame_new(uint8_t type, uint8_t len)
+{
+    while (frame_count == FRAME_QUEUE) {
+        if (rn42_rts()) {
+            // module prohibits sending: drop oldest so that latest state is kept
+            frame_head = (frame_head + 1) % FRAME_QUEUE;
+            frame_count--;
+            break;
+        }
+        rn42_send_task();
+    }
+    frame_t *f = &frames[(frame_head + frame_count) % FRAME_QUEUE];
+    frame_count++;
+    f->data[0] = 0xFD;      // Raw report mode
+    f->data[1] = len - 2;   // length
+    f->data[2] = type;      // descriptor type
+    f->len = len;
+    f->release = false;
+    return f;
+}
+
+/* keyboard state in frame layout: mods, reserved, keys[6] */
+static uint8_t keyboard_last[8];
+
+// all mods and keys of a are still down in b
+static bool keys_held(const uint8_t *a, const uint8_t *b)
+{
+    if (a[0] & ~b[0]) return false;
+    for (uint8_t i = 2; i < 8; i++) {
+        if (!a[i]) continue;
+        uint8_t j = 2;
+        while (j < 8 && b[j] != a[i]) j++;
+        if (j == 8) return false;
+    }
+    return true;
+}
+
 static void send_keyboard(report_keyboard_t *report)
 {
-    // wake from deep sleep
-/*
-    PORTD |= (1<<5);    // high
-    wait_ms(5);
-    PORTD &= ~(1<<5);   // low
-*/
-
-    serial_send(0xFD);  // Raw report mode
-    serial_send(9);     // length
-    serial_send(1);     // descriptor type
-    serial_send(report->mods);
-    serial_send(0x00);
-    serial_send(report->keys[0]);
-    serial_send(report->keys[1]);
-    serial_send(report->keys[2]);
-    serial_send(report->keys[3]);
-    serial_send(report->keys[4]);
-    serial_send(report->keys[5]);
+    uint8_t state[8];
+    state[0] = report->mods;
+    state[1] = 0x00;
+    memcpy(&state[2], report->keys, 6);
+
+    frame_t *f = frame_tail(1);
+    if (!f || f->release || !keys_held(&f->data[3], state)) {
+        f = frame_new(1, FRAME_SIZE);
+        f->release = !keys_held(keyboard_last, state);
+    }
+    memcpy(&f->data[3], state, 8);
+    memcpy(keyboard_last, state, 8);
+    rn42_send_task();
 }
 
-static void send_mouse(report_mouse_t *report)
+// adds motion of report to unsent frame unless it overflows
+static bool mouse_merge(frame_t *f, report_mouse_t *report)
 {
-    // wake from deep sleep
-/*
-    PORTD |= (1<<5);    // high
-    wait_ms(5);
-    PORTD &= ~(1<<5);   // low
-*/
+    int16_t x = (int8_t)f->data[4] + MOUSE_XY_CLIP8(report->x);
+    int16_t y = (int8_t)f->data[5] + MOUSE_XY_CLIP8(report->y);
+    int16_t v = (int8_t)f->data[6] + report->v;
+    if (x < -127 || x > 127 || y < -127 || y > 127 || v < -127 || v > 127) {
+        return false;
+    }
+    f->data[4] = x;
+    f->data[5] = y;
+    f->data[6] = v;
+    return true;
+}
 
-    serial_send(0xFD);  // Raw report mode
-    serial_send(5);     // length
-    serial_send(2);     // descriptor type
-    serial_send(report->buttons);
-    serial_send(report->x);
-    serial_send(report->y);
-    serial_send(report->v);
+static void send_mouse(report_mouse_t *report)
+{
+    frame_t *f = frame_tail(2);
+    if (!f || f->data[3] != report->buttons || !mouse_merge(f, report)) {
+        f = frame_new(2, 7);
+        f->data[3] = report->buttons;
+        f->data[4] = MOUSE_XY_CLIP8(report->x);
+        f->data[5] = MOUSE_XY_CLIP8(report->y);
+        f->data[6] = report->v;
+    }
+    rn42_send_task();
 }
 
 static void send_system(uint16_t data)
@@ -204,34 +346,18 @@ static uint16_t usage2bits(uint16_t usage)
     return 0;
 }
 
+static uint16_t consumer_last = 0;
+
 static void send_consumer(uint16_t data)
 {
     uint16_t bits = usage2bits(data);
-    serial_send(0xFD);  // Raw report mode
-    serial_send(3);     // length
-    serial_send(3);     // descriptor type
-    serial_send(bits&0xFF);
-    serial_send((bits>>8)&0xFF);
-}
-
-
-/* Null driver for config_mode */
-static uint8_t config_keyboard_leds(void);
-static void config_send_keyboard(report_keyboard_t *report);
-static void config_send_mouse(report_mouse_t *report);
-static void config_send_system(uint16_t data);
-static void config_send_consumer(uint16_t data);
-
-host_driver_t rn42_config_driver = {
-    config_keyboard_leds,
-    config_send_keyboard,
-    config_send_mouse,
-    config_send_system,
-    config_send_consumer
-};
-
-static uint8_t config_keyboard_leds(void) { return leds; }
-static void config_send_keyboard(report_keyboard_t *report) {}
-static void config_send_mouse(report_mouse_t *report) {}
-static void config_send_system(uint16_t data) {}
-static void config_send_consumer(uint16_t data) {}
+    frame_t *f = frame_tail(3);
+    if (!f || f->release || (f->data[3] | f->data[4]<<8) & ~bits) {
+        f = frame_new(3, 5);
+        f->release = (consumer_last & ~bits);
+    }
+    f->data[3] = bits&0xFF;
+    f->data[4] = (bits>>8)&0xFF;
+    consumer_last = bits;
+    rn42_send_task();
+}
@@ -4,13 +4,12 @@
 #include <stdbool.h>
 
 host_driver_t rn42_driver;
-host_driver_t rn42_config_driver;
 
 void rn42_init(void);
 int16_t rn42_getc(void);
 const char *rn42_gets(uint16_t timeout);
-void rn42_putc(uint8_t c);
-void rn42_puts(char *s);
+bool rn42_putc(uint8_t c);
+bool rn42_puts(char *s);
 bool rn42_autoconnecting(void);
 void rn42_autoconnect(void);
 void rn42_disconnect(void);
@@ -19,5 +18,6 @@ void rn42_cts_hi(void);
 void rn42_cts_lo(void);
 bool rn42_linked(void);
 void rn42_set_leds(uint8_t l);
+void rn42_send_task(void);
 
 #endif
@@ -5,6 +5,7 @@
 #include "keycode.h"
 #include "serial.h"
 #include "host.h"
+#include "host_route.h"
 #include "action.h"
 #include "action_util.h"
 #include "lufa.h"
@@ -19,6 +20,20 @@
 static bool config_mode = false;
 static bool force_usb = false;
 
+/* host routing sinks */
+static uint8_t usb_sink = HOST_ROUTE_NONE;
+static uint8_t bt_sink = HOST_ROUTE_NONE;
+
+static bool usb_ready(void)
+{
+    return USB_DeviceState == DEVICE_STATE_Configured;
+}
+
+static bool bt_ready(void)
+{
+    return !rn42_rts();
+}
+
 static void status_led(bool on)
 {
     if (on) {
@@ -33,11 +48,25 @@ static void status_led(bool on)
 void rn42_task_init(void)
 {
     battery_init();
+
+    int8_t n;
+    if ((n = host_route_add_sink(&lufa_driver, usb_ready)) >= 0) usb_sink = HOST_ROUTE_SINK(n);
+    if ((n = host_route_add_sink(&rn42_driver, bt_ready)) >= 0)  bt_sink  = HOST_ROUTE_SINK(n);
+    host_route_set_all(rn42_rts() ? usb_sink : bt_sink);
+    host_set_driver(&host_route_driver);
+}
+
+bool rn42_task_bt_active(void)
+{
+    return host_route_get(HOST_ROUTE_KEYBOARD) == bt_sink;
 }
 
 void rn42_task(void)
 {
     int16_t c;
+    // send frames waiting for UART buffer or flow control
+    rn42_send_task();
+
     // Raw mode: interpret output report of LED state
     while ((c = rn42_getc()) != -1) {
         // LED Out report: 0xFE, 0x02, 0x01, <leds>
@@ -69,16 +98,15 @@ void rn42_task(void)
         }
     }
 
-    /* Bluetooth mode when ready */
+    /* Bluetooth mode when ready: keys held are carried over to new host */
     if (!config_mode && !force_usb) {
-        if (!rn42_rts() && host_get_driver() != &rn42_driver) {
-            clear_keyboard();
-            host_set_driver(&rn42_driver);
-        } else if (rn42_rts() && host_get_driver() != &lufa_driver) {
-            clear_keyboard();
-            host_set_driver(&lufa_driver);
+        if (!rn42_rts() && host_route_get(HOST_ROUTE_KEYBOARD) != bt_sink) {
+            host_route_set_all(bt_sink);
+        } else if (rn42_rts() && host_route_get(HOST_ROUTE_KEYBOARD) != usb_sink) {
+            host_route_set_all(usb_sink);
         }
     }
+    host_route_task();
 
 
     static uint16_t prev_timer = 0;
@@ -123,7 +151,7 @@ void rn42_task(void)
 /******************************************************************************
  * Command
  ******************************************************************************/
-static host_driver_t *prev_driver = &rn42_driver;
+static uint8_t prev_route = HOST_ROUTE_NONE;
 
 static void print_rn42(void)
 {
@@ -161,9 +189,9 @@ static const char *send_command(const char *cmd)
 
 static void enter_command_mode(void)
 {
-    prev_driver = host_get_driver();
+    prev_route = host_route_get(HOST_ROUTE_KEYBOARD);
     clear_keyboard();
-    host_set_driver(&rn42_config_driver);   // null driver; not to send a key to host
+    host_route_set_all(HOST_ROUTE_NONE);    // not to send a key to host
     rn42_disconnect();
     while (rn42_linked()) ;
 
@@ -183,7 +211,7 @@ static void exit_command_mode(void)
 
     rn42_autoconnect();
     clear_keyboard();
-    host_set_driver(prev_driver);
+    host_route_set_all(prev_route);
 }
 
 static void init_rn42(void)
@@ -194,7 +222,7 @@ static void init_rn42(void)
     SEND_COMMAND("S-,TmkBT\r\n");
     SEND_COMMAND("SS,Keyboard/Mouse\r\n");
     SEND_COMMAND("SM,4\r\n");  // auto connect(DTR)
-    SEND_COMMAND("SW,8000\r\n");   // Sniff disable
+    SEND_COMMAND("SW,8010\r\n");   // Deep sleep, Sniff 10ms(no latency felt)
     SEND_COMMAND("S~,6\r\n");   // HID profile
     SEND_COMMAND("SH,003C\r\n");   // combo device, out-report, 4-reconnect
     SEND_COMMAND("SY,FFF4\r\n");   // transmit power -12
@@ -320,7 +348,7 @@ bool command_extra(uint8_t code)
 #endif
         case KC_I:
             print("\n----- RN-42 info -----\n");
-            xprintf("protocol: %s\n", (host_get_driver() == &rn42_driver) ? "RN-42" : "LUFA");
+            xprintf("protocol: %s\n", rn42_task_bt_active() ? "RN-42" : "LUFA");
             xprintf("force_usb: %X\n", force_usb);
             xprintf("rn42: %s\n", rn42_rts() ? "OFF" : (rn42_linked() ? "CONN" : "ON"));
             xprintf("rn42_autoconnecting(): %X\n", rn42_autoconnecting());
@@ -373,8 +401,7 @@ bool command_extra(uint8_t code)
             } else {
                 print("USB mode\n");
                 force_usb = true;
-                clear_keyboard();
-                host_set_driver(&lufa_driver);
+                host_route_set_all(usb_sink);
             }
             return true;
         case KC_DELETE:
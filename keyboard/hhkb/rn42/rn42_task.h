@@ -6,5 +6,6 @@
 
 void rn42_task_init(void);
 void rn42_task(void);
+bool rn42_task_bt_active(void);
 
 #endif
@@ -1,6 +1,7 @@
 COMMON_DIR = common
 SRC +=	$(COMMON_DIR)/host.c \
 	$(COMMON_DIR)/keyboard.c \
+	$(COMMON_DIR)/startup.c \
 	$(COMMON_DIR)/action.c \
 	$(COMMON_DIR)/action_tapping.c \
 	$(COMMON_DIR)/action_macro.c \
@@ -49,10 +50,29 @@ ifdef NKRO_ENABLE
     OPT_DEFS += -DNKRO_ENABLE
 endif
 
+ifdef MOUSE_EXTENDED_REPORT
+    OPT_DEFS += -DMOUSE_EXTENDED_REPORT
+endif
+
+ifdef SPARSE_KEYMAP_ENABLE
+    SRC += $(COMMON_DIR)/keymap_sparse.c
+    OPT_DEFS += -DSPARSE_KEYMAP_ENABLE
+endif
+
 ifdef USB_6KRO_ENABLE
     OPT_DEFS += -DUSB_6KRO_ENABLE
 endif
 
+ifdef HOST_ROUTE_ENABLE
+    SRC += $(COMMON_DIR)/host_route.c
+    OPT_DEFS += -DHOST_ROUTE_ENABLE
+endif
+
+ifdef POWER_POLICY_ENABLE
+    SRC += $(COMMON_DIR)/power_policy.c
+    OPT_DEFS += -DPOWER_POLICY_ENABLE
+endif
+
 ifdef KEYBOARD_LOCK_ENABLE
     OPT_DEFS += -DKEYBOARD_LOCK_ENABLE
 endif
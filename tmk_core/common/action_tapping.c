@@ -68,6 +68,11 @@ void action_tapping_process(keyrecord_t record)
     }
 }
 
+bool action_tapping_idle(void)
+{
+    return IS_NOEVENT(tapping_key.event) && waiting_buffer_head == waiting_buffer_tail;
+}
+
 
 /* Tapping
  *
@@ -34,6 +34,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #ifndef NO_ACTION_TAPPING
 void action_tapping_process(keyrecord_t record);
+/* no tap key in progress and no event waiting */
+bool action_tapping_idle(void);
+#else
+#define action_tapping_idle()   true
 #endif
 
 #endif
@@ -1,6 +1,5 @@
 #include <stdint.h>
 #include <stdbool.h>
-#include <util/delay.h>
 #include "matrix.h"
 #include "bootloader.h"
 #include "debug.h"
@@ -18,11 +17,7 @@ void bootmagic(void)
         eeconfig_init();
     }
 
-    /* do scans in case of bounce */
-    print("bootmagic scan: ... ");
-    uint8_t scan = 100;
-    while (scan--) { matrix_scan(); _delay_ms(10); }
-    print("done.\n");
+    /* matrix has been scanned in keyboard_init_task */
 
     /* bootmagic skip */
     if (bootmagic_scan_keycode(BOOTMAGIC_KEY_SKIP)) {
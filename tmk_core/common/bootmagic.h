@@ -2,6 +2,14 @@
 #define BOOTMAGIC_H
 
 
+/* matrix is scanned until it doesn't change for SETTLE_TIME(ms) or SCAN_TIME passes */
+#ifndef BOOTMAGIC_SETTLE_TIME
+#define BOOTMAGIC_SETTLE_TIME           30
+#endif
+#ifndef BOOTMAGIC_SCAN_TIME
+#define BOOTMAGIC_SCAN_TIME             1000
+#endif
+
 /* bootmagic salt key */
 #ifndef BOOTMAGIC_KEY_SALT
 #define BOOTMAGIC_KEY_SALT              KC_SPACE
@@ -421,6 +421,7 @@ static void mousekey_param_print(void)
     print("4: time_to_max: "); pdec(mk_time_to_max); print("\n");
     print("5: wheel_max_speed: "); pdec(mk_wheel_max_speed); print("\n");
     print("6: wheel_time_to_max: "); pdec(mk_wheel_time_to_max); print("\n");
+    xprintf("7: curve: %d\n", mk_curve);
 }
 
 //#define PRINT_SET_VAL(v)  print(#v " = "); print_dec(v); print("\n");
@@ -470,6 +471,14 @@ static void mousekey_param_inc(uint8_t param, uint8_t inc)
                 mk_wheel_time_to_max = UINT8_MAX;
             PRINT_SET_VAL(mk_wheel_time_to_max);
             break;
+        case 7:
+            // step of 10
+            if (mk_curve + inc * 10 < 1000)
+                mk_curve += inc * 10;
+            else
+                mk_curve = 1000;
+            PRINT_SET_VAL(mk_curve);
+            break;
     }
 }
 
@@ -518,6 +527,13 @@ static void mousekey_param_dec(uint8_t param, uint8_t dec)
                 mk_wheel_time_to_max = 0;
             PRINT_SET_VAL(mk_wheel_time_to_max);
             break;
+        case 7:
+            if (mk_curve - dec * 10 > -900)
+                mk_curve -= dec * 10;
+            else
+                mk_curve = -900;
+            PRINT_SET_VAL(mk_curve);
+            break;
     }
 }
 
@@ -531,6 +547,7 @@ static void mousekey_console_help(void)
           "4:	time_to_max\n"
           "5:	wheel_max_speed\n"
           "6:	wheel_time_to_max\n"
+          "7:	curve(*10)\n"
           "\n"
           "p:	print values\n"
           "d:	set defaults\n"
@@ -539,7 +556,7 @@ static void mousekey_console_help(void)
           "pgup:	+10\n"
           "pgdown:	-10\n"
           "\n"
-          "speed = delta * max_speed * (repeat / time_to_max)\n");
+          "speed = delta * max_speed * (repeat / time_to_max)^((1000 + curve) / 1000)\n");
     xprintf("where delta: cursor=%d, wheel=%d\n" 
             "See http://en.wikipedia.org/wiki/Mouse_keys\n", MOUSEKEY_MOVE_DELTA,  MOUSEKEY_WHEEL_DELTA);
 }
@@ -570,6 +587,7 @@ static bool mousekey_console(uint8_t code)
         case KC_4:
         case KC_5:
         case KC_6:
+        case KC_7:
             mousekey_param = numkey2num(code);
             break;
         case KC_UP:
@@ -591,6 +609,7 @@ static bool mousekey_console(uint8_t code)
             mk_time_to_max = MOUSEKEY_TIME_TO_MAX;
             mk_wheel_max_speed = MOUSEKEY_WHEEL_MAX_SPEED;
             mk_wheel_time_to_max = MOUSEKEY_WHEEL_TIME_TO_MAX;
+            mk_curve = MOUSEKEY_CURVE;
             print("set default\n");
             break;
         default:
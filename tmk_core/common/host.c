@@ -27,6 +27,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 bool keyboard_nkro = true;
 #endif
 
+#ifdef MOUSE_EXTENDED_REPORT
+uint8_t mouse_resolution = 0;
+#endif
+
 static host_driver_t *driver;
 static uint16_t last_system_report = 0;
 static uint16_t last_consumer_report = 0;
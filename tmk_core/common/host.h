@@ -35,6 +35,16 @@ extern bool keyboard_nkro;
 extern uint8_t keyboard_idle;
 extern uint8_t keyboard_protocol;
 
+#ifdef MOUSE_EXTENDED_REPORT
+/* Resolution Multiplier feature set by host, bit0-1: wheel, bit2-3: pan */
+extern uint8_t mouse_resolution;
+#define host_mouse_wheel_res()  ((mouse_resolution & 0x03) ? MOUSE_WHEEL_RESOLUTION : 1)
+#define host_mouse_pan_res()    ((mouse_resolution & 0x0C) ? MOUSE_WHEEL_RESOLUTION : 1)
+#else
+#define host_mouse_wheel_res()  1
+#define host_mouse_pan_res()    1
+#endif
+
 
 /* host driver */
 void host_set_driver(host_driver_t *driver);
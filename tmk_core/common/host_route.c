@@ -0,0 +1,239 @@
+/*
+Copyright 2016 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "report.h"
+#include "host_driver.h"
+#include "host_route.h"
+#include "debug.h"
+
+
+typedef struct {
+    host_driver_t *driver;
+    bool (*ready)(void);
+    report_keyboard_t kbuf[HOST_ROUTE_QUEUE];
+    uint8_t head;
+    uint8_t tail;
+    bool system_pending;
+    bool consumer_pending;
+    uint16_t system;
+    uint16_t consumer;
+} sink_t;
+
+static sink_t sinks[HOST_ROUTE_SINKS];
+static uint8_t sink_count = 0;
+static uint8_t routes[HOST_ROUTE_CLASSES];
+
+/* current state to be given to sink newly routed */
+static report_keyboard_t keyboard_state;
+static uint16_t system_state = 0;
+static uint16_t consumer_state = 0;
+
+
+static inline bool sink_ready(sink_t *s)
+{
+    return !s->ready || s->ready();
+}
+
+static void sink_flush(sink_t *s)
+{
+    while (s->head != s->tail && sink_ready(s)) {
+        (*s->driver->send_keyboard)(&s->kbuf[s->tail]);
+        s->tail = (s->tail + 1) % HOST_ROUTE_QUEUE;
+    }
+    if (s->system_pending && sink_ready(s)) {
+        (*s->driver->send_system)(s->system);
+        s->system_pending = false;
+    }
+    if (s->consumer_pending && sink_ready(s)) {
+        (*s->driver->send_consumer)(s->consumer);
+        s->consumer_pending = false;
+    }
+}
+
+static void sink_keyboard(sink_t *s, report_keyboard_t *report)
+{
+    uint8_t next = (s->head + 1) % HOST_ROUTE_QUEUE;
+    if (next == s->tail) {
+        // latest state supersedes the newest queued so that release is never lost
+        s->kbuf[(s->head + HOST_ROUTE_QUEUE - 1) % HOST_ROUTE_QUEUE] = *report;
+        dprint("route: queue full\n");
+    } else {
+        s->kbuf[s->head] = *report;
+        s->head = next;
+    }
+    sink_flush(s);
+}
+
+static void sink_system(sink_t *s, uint16_t data)
+{
+    s->system = data;
+    s->system_pending = true;
+    sink_flush(s);
+}
+
+static void sink_consumer(sink_t *s, uint16_t data)
+{
+    s->consumer = data;
+    s->consumer_pending = true;
+    sink_flush(s);
+}
+
+
+/*------------------------------------------------------------------*
+ * Routing
+ *------------------------------------------------------------------*/
+int8_t host_route_add_sink(host_driver_t *driver, bool (*ready)(void))
+{
+    if (sink_count >= HOST_ROUTE_SINKS) return -1;
+
+    sink_t *s = &sinks[sink_count];
+    s->driver = driver;
+    s->ready = ready;
+    s->head = s->tail = 0;
+    s->system_pending = s->consumer_pending = false;
+    return sink_count++;
+}
+
+void host_route_set(uint8_t cls, uint8_t mask)
+{
+    if (cls >= HOST_ROUTE_CLASSES) return;
+
+    uint8_t removed = routes[cls] & ~mask;
+    uint8_t added = mask & ~routes[cls];
+    routes[cls] = mask;
+    if (removed || added) {
+        dprintf("route: %u %02X\n", cls, mask);
+    }
+
+    static report_keyboard_t empty;
+    for (uint8_t i = 0; i < sink_count; i++) {
+        sink_t *s = &sinks[i];
+        switch (cls) {
+            case HOST_ROUTE_KEYBOARD:
+                if (removed & HOST_ROUTE_SINK(i)) {
+                    // queued keys are stale for the host switched away from
+                    s->head = s->tail;
+                    sink_keyboard(s, &empty);
+                }
+                if (added & HOST_ROUTE_SINK(i))   sink_keyboard(s, &keyboard_state);
+                break;
+            case HOST_ROUTE_EXTRA:
+                if (removed & HOST_ROUTE_SINK(i)) {
+                    if (system_state)   sink_system(s, 0);
+                    if (consumer_state) sink_consumer(s, 0);
+                }
+                if (added & HOST_ROUTE_SINK(i)) {
+                    if (system_state)   sink_system(s, system_state);
+                    if (consumer_state) sink_consumer(s, consumer_state);
+                }
+                break;
+            default:
+                // mouse reports are relative and have nothing to carry over
+                break;
+        }
+    }
+}
+
+void host_route_set_all(uint8_t mask)
+{
+    for (uint8_t cls = 0; cls < HOST_ROUTE_CLASSES; cls++) {
+        host_route_set(cls, mask);
+    }
+}
+
+uint8_t host_route_get(uint8_t cls)
+{
+    if (cls >= HOST_ROUTE_CLASSES) return HOST_ROUTE_NONE;
+    return routes[cls];
+}
+
+void host_route_task(void)
+{
+    for (uint8_t i = 0; i < sink_count; i++) {
+        sink_flush(&sinks[i]);
+    }
+}
+
+
+/*------------------------------------------------------------------*
+ * Host driver
+ *------------------------------------------------------------------*/
+static uint8_t keyboard_leds(void);
+static void send_keyboard(report_keyboard_t *report);
+static void send_mouse(report_mouse_t *report);
+static void send_system(uint16_t data);
+static void send_consumer(uint16_t data);
+
+host_driver_t host_route_driver = {
+    keyboard_leds,
+    send_keyboard,
+    send_mouse,
+    send_system,
+    send_consumer
+};
+
+static uint8_t keyboard_leds(void)
+{
+    // LED state of the first sink which keyboard is routed to
+    for (uint8_t i = 0; i < sink_count; i++) {
+        if (routes[HOST_ROUTE_KEYBOARD] & HOST_ROUTE_SINK(i)) {
+            return (*sinks[i].driver->keyboard_leds)();
+        }
+    }
+    return 0;
+}
+
+static void send_keyboard(report_keyboard_t *report)
+{
+    keyboard_state = *report;
+    for (uint8_t i = 0; i < sink_count; i++) {
+        if (routes[HOST_ROUTE_KEYBOARD] & HOST_ROUTE_SINK(i)) {
+            sink_keyboard(&sinks[i], report);
+        }
+    }
+}
+
+static void send_mouse(report_mouse_t *report)
+{
+    for (uint8_t i = 0; i < sink_count; i++) {
+        if ((routes[HOST_ROUTE_MOUSE] & HOST_ROUTE_SINK(i)) && sink_ready(&sinks[i])) {
+            (*sinks[i].driver->send_mouse)(report);
+        }
+    }
+}
+
+static void send_system(uint16_t data)
+{
+    system_state = data;
+    for (uint8_t i = 0; i < sink_count; i++) {
+        if (routes[HOST_ROUTE_EXTRA] & HOST_ROUTE_SINK(i)) {
+            sink_system(&sinks[i], data);
+        }
+    }
+}
+
+static void send_consumer(uint16_t data)
+{
+    consumer_state = data;
+    for (uint8_t i = 0; i < sink_count; i++) {
+        if (routes[HOST_ROUTE_EXTRA] & HOST_ROUTE_SINK(i)) {
+            sink_consumer(&sinks[i], data);
+        }
+    }
+}
@@ -0,0 +1,85 @@
+/*
+Copyright 2016 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HOST_ROUTE_H
+#define HOST_ROUTE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "host_driver.h"
+
+
+/*
+ * Host routing driver
+ *
+ * Fans reports out to several host drivers(sinks) such as LUFA and
+ * Bluetooth module. Each report class is routed to a set of sinks and each
+ * sink has its own keyboard report queue which is drained while the sink is
+ * ready. When a route changes the sink removed drops its queue and gets a
+ * release-all report and the sink added gets current state, so that keys
+ * held stay held over switching hosts.
+ *
+ * Usage:
+ *   usb = host_route_add_sink(&lufa_driver, usb_ready);
+ *   bt  = host_route_add_sink(&rn42_driver, bt_ready);
+ *   host_route_set_all(HOST_ROUTE_SINK(usb));
+ *   host_set_driver(&host_route_driver);
+ *   ...
+ *   host_route_task();     // in main loop
+ */
+
+/* max number of sinks */
+#ifndef HOST_ROUTE_SINKS
+#define HOST_ROUTE_SINKS    2
+#endif
+
+/* keyboard report queue length of each sink */
+#ifndef HOST_ROUTE_QUEUE
+#define HOST_ROUTE_QUEUE    4
+#endif
+
+/* report class */
+enum host_route_class {
+    HOST_ROUTE_KEYBOARD = 0,
+    HOST_ROUTE_MOUSE,
+    HOST_ROUTE_EXTRA,       // system and consumer
+    HOST_ROUTE_CLASSES
+};
+
+/* sink bitmap */
+#define HOST_ROUTE_NONE     0
+#define HOST_ROUTE_SINK(n)  (1<<(n))
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern host_driver_t host_route_driver;
+
+/* returns sink number or -1 when no room. ready can be NULL */
+int8_t host_route_add_sink(host_driver_t *driver, bool (*ready)(void));
+void host_route_set(uint8_t cls, uint8_t sinks);
+void host_route_set_all(uint8_t sinks);
+uint8_t host_route_get(uint8_t cls);
+void host_route_task(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -30,6 +30,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "bootmagic.h"
 #include "eeconfig.h"
 #include "backlight.h"
+#include "startup.h"
 #ifdef MOUSEKEY_ENABLE
 #   include "mousekey.h"
 #endif
@@ -42,6 +43,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifdef ADB_MOUSE_ENABLE
 #include "adb.h"
 #endif
+#ifdef POWER_POLICY_ENABLE
+#include "power_policy.h"
+#endif
 
 
 #ifdef MATRIX_HAS_GHOST
@@ -68,28 +72,102 @@ void keyboard_setup(void)
     matrix_setup();
 }
 
+/* matrix_init starts device and this polls it until ready without blocking */
+__attribute__ ((weak)) bool matrix_init_task(void) { return true; }
+
 void keyboard_init(void)
 {
     timer_init();
+    startup_mark(STARTUP_INIT);
     matrix_init();
 #ifdef PS2_MOUSE_ENABLE
     ps2_mouse_init();
 #endif
-#ifdef SERIAL_MOUSE_ENABLE
-    serial_mouse_init();
-#endif
-#ifdef ADB_MOUSE_ENABLE
-    adb_mouse_init();
+
+#ifdef BACKLIGHT_ENABLE
+    backlight_init();
 #endif
+}
+
+#ifdef BOOTMAGIC_ENABLE
+/* scan until matrix settles instead of fixed time in case of bounce */
+static bool bootmagic_scan(void)
+{
+    static matrix_row_t matrix_last[MATRIX_ROWS];
+    static uint16_t settled;
+    static uint16_t timeout;
+    static bool started = false;
 
+    if (!started) {
+        print("bootmagic scan: ... ");
+        settled = DEADLINE(BOOTMAGIC_SETTLE_TIME);
+        timeout = DEADLINE(BOOTMAGIC_SCAN_TIME);
+        started = true;
+    }
 
+    matrix_scan();
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        if (matrix_get_row(r) != matrix_last[r]) {
+            matrix_last[r] = matrix_get_row(r);
+            settled = DEADLINE(BOOTMAGIC_SETTLE_TIME);
+        }
+    }
+    if (!DEADLINE_PASSED(settled) && !DEADLINE_PASSED(timeout)) return false;
+
+    print("done.\n");
+    return true;
+}
+#endif
+
+/*
+ * Runs device initialization from main loop until keyboard is ready.
+ * This can be called while waiting for USB enumeration.
+ */
+bool keyboard_init_task(void)
+{
+    static enum {
+        INIT_MATRIX,
 #ifdef BOOTMAGIC_ENABLE
-    bootmagic();
+        INIT_BOOTMAGIC,
 #endif
+        INIT_DONE,
+    } stage = INIT_MATRIX;
 
-#ifdef BACKLIGHT_ENABLE
-    backlight_init();
+    if (stage == INIT_DONE) return true;
+
+#ifdef PS2_MOUSE_ENABLE
+    // mouse initializes in its task concurrently
+    ps2_mouse_task();
+#endif
+
+    switch (stage) {
+        case INIT_MATRIX:
+            if (!matrix_init_task()) return false;
+            startup_mark(STARTUP_MATRIX);
+            // these use keyboard protocol or need no wait
+#ifdef SERIAL_MOUSE_ENABLE
+            serial_mouse_init();
 #endif
+#ifdef ADB_MOUSE_ENABLE
+            adb_mouse_init();
+            startup_mark(STARTUP_MOUSE);
+#endif
+#ifdef BOOTMAGIC_ENABLE
+            stage = INIT_BOOTMAGIC;
+            return false;
+        case INIT_BOOTMAGIC:
+            if (!bootmagic_scan()) return false;
+            bootmagic();
+            startup_mark(STARTUP_BOOTMAGIC);
+#endif
+            stage = INIT_DONE;
+            startup_mark(STARTUP_READY);
+            if (debug_enable) startup_print();
+            // fall through
+        case INIT_DONE:
+        default:
+            return true;
+    }
 }
 
 /*
@@ -98,15 +176,36 @@ void keyboard_init(void)
  */
 void keyboard_task(void)
 {
+#ifndef MATRIX_HAS_CHANGE_LIST
     static matrix_row_t matrix_prev[MATRIX_ROWS];
+#endif
 #ifdef MATRIX_HAS_GHOST
     static matrix_row_t matrix_ghost[MATRIX_ROWS];
 #endif
     static uint8_t led_status = 0;
-    matrix_row_t matrix_row = 0;
-    matrix_row_t matrix_change = 0;
+
+    if (!keyboard_init_task()) return;
 
     matrix_scan();
+#ifdef MATRIX_HAS_CHANGE_LIST
+    keypos_t key;
+    bool pressed;
+    if (matrix_get_change(&key, &pressed)) {
+        if (debug_matrix) matrix_print();
+#ifdef POWER_POLICY_ENABLE
+        power_policy_activity();
+#endif
+        action_exec((keyevent_t){
+            .key = key,
+            .pressed = pressed,
+            .time = (timer_read() | 1) /* time should not be 0 */
+        });
+        // process a key per task call
+        goto MATRIX_LOOP_END;
+    }
+#else
+    matrix_row_t matrix_row = 0;
+    matrix_row_t matrix_change = 0;
     for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
         matrix_row = matrix_get_row(r);
         matrix_change = matrix_row ^ matrix_prev[r];
@@ -126,6 +225,9 @@ void keyboard_task(void)
             matrix_ghost[r] = matrix_row;
 #endif
             if (debug_matrix) matrix_print();
+#ifdef POWER_POLICY_ENABLE
+            power_policy_activity();
+#endif
             for (uint8_t c = 0; c < MATRIX_COLS; c++) {
                 if (matrix_change & ((matrix_row_t)1<<c)) {
                     action_exec((keyevent_t){
@@ -141,11 +243,16 @@ void keyboard_task(void)
             }
         }
     }
+#endif
     // call with pseudo tick event when no real key event.
     action_exec(TICK);
 
 MATRIX_LOOP_END:
 
+#ifdef POWER_POLICY_ENABLE
+    power_policy_task();
+#endif
+
 #ifdef MOUSEKEY_ENABLE
     // mousekey repeat & acceleration
     mousekey_task();
@@ -0,0 +1,69 @@
+/*
+Copyright 2016 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdint.h>
+#include "keycode.h"
+#include "progmem.h"
+#include "keymap_sparse.h"
+
+/* generated: SPARSE_KEYMAP_LAYERS, sparse_fill[], sparse_rows[][MATRIX_ROWS], sparse_keycodes[] */
+#include "keymap_sparse_table.h"
+
+
+/* rank table: on-bits of nibble */
+static const uint8_t PROGMEM nibble_bits[16] = {
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+};
+
+static matrix_row_t read_bits(const matrix_row_t *p)
+{
+#if (MATRIX_COLS <= 8)
+    return pgm_read_byte(p);
+#elif (MATRIX_COLS <= 16)
+    return pgm_read_word(p);
+#else
+    return pgm_read_dword(p);
+#endif
+}
+
+/* number of on-bits, same steps for any bits unlike bitpop() */
+static uint8_t rank(matrix_row_t bits)
+{
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < sizeof(matrix_row_t) * 2; i++) {
+        n += pgm_read_byte(&nibble_bits[bits & 0x0F]);
+        bits >>= 4;
+    }
+    return n;
+}
+
+uint8_t keymap_sparse_keycode(uint8_t layer, keypos_t key)
+{
+    if (layer >= SPARSE_KEYMAP_LAYERS) {
+        return KC_TRNS;
+    }
+
+    const sparse_row_t *row = &sparse_rows[layer][key.row];
+    matrix_row_t bits = read_bits(&row->bits);
+    matrix_row_t mask = (matrix_row_t)1 << key.col;
+
+    if (!(bits & mask)) {
+        return pgm_read_byte(&sparse_fill[layer]);
+    }
+    // keycodes of keys on left side of this key come first
+    uint16_t i = pgm_read_word(&row->index) + rank(bits & (mask - 1));
+    return pgm_read_byte(&sparse_keycodes[i]);
+}
@@ -0,0 +1,43 @@
+/*
+Copyright 2016 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef KEYMAP_SPARSE_H
+#define KEYMAP_SPARSE_H
+
+#include <stdint.h>
+#include "keymap.h"
+#include "matrix.h"
+
+
+/*
+ * Sparse keymap
+ *
+ * Each layer has fill keycode, which is its most common keycode(KC_TRNS on
+ * most upper layers, KC_NO on padded converter layouts), and only keys
+ * other than that are stored. Each row of a layer has bitmap of those keys
+ * and index of its first keycode in packed keycode table.
+ * Tables are generated from dense keymaps[] by tool/sparse_keymap at build
+ * time with SPARSE_KEYMAP_ENABLE.
+ */
+typedef struct {
+    matrix_row_t bits;      // keys stored, others are fill keycode
+    uint16_t index;         // first keycode of row in packed table
+} sparse_row_t;
+
+/* constant time lookup, replaces keymaps[layer][row][col] */
+uint8_t keymap_sparse_keycode(uint8_t layer, keypos_t key);
+
+#endif
@@ -20,6 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "keyboard.h"
 
 
 #if (MATRIX_COLS <= 8)
@@ -47,6 +48,8 @@ uint8_t matrix_cols(void);
 void matrix_setup(void);
 /* intialize matrix for scaning. */
 void matrix_init(void);
+/* poll initialization started by matrix_init without blocking, true when ready.(optional) */
+bool matrix_init_task(void);
 /* scan all key states on matrix */
 uint8_t matrix_scan(void);
 /* whether modified from previous scan. used after matrix_scan. */
@@ -57,6 +60,11 @@ bool matrix_is_on(uint8_t row, uint8_t col);
 matrix_row_t matrix_get_row(uint8_t row);
 /* print matrix for debug */
 void matrix_print(void);
+#ifdef MATRIX_HAS_CHANGE_LIST
+/* next switch changed since last call, false when no change is left.
+ * used instead of comparing every row when matrix tracks changes itself. */
+bool matrix_get_change(keypos_t *key, bool *pressed);
+#endif
 
 
 /* power control */
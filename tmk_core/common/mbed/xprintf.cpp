@@ -2,12 +2,29 @@
 //#include <stdarg.h>
 #include "mbed.h"
 #include "mbed/xprintf.h"
+#include "sendchar.h"
 
 
 #define STRING_STACK_LIMIT    120
 
+#ifdef CONSOLE_ENABLE
+/* output to USB console with sendchar() of protocol driver */
+int xprintf(const char* format, ...)
+{
+    char temp[STRING_STACK_LIMIT];
+    std::va_list arg;
+    va_start(arg, format);
+    int len = vsnprintf(temp, sizeof(temp), format, arg);
+    va_end(arg);
+    for (char *p = temp; *p; p++) {
+        sendchar(*p);
+    }
+    return len;
+}
+#else
 //TODO
 int xprintf(const char* format, ...) { return 0; }
+#endif
 
 #if 0
 /* mbed Serial */
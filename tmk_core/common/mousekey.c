@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "timer.h"
 #include "print.h"
 #include "debug.h"
+#include "progmem.h"
 #include "mousekey.h"
 
 
@@ -29,6 +30,26 @@ static report_mouse_t mouse_report = {};
 static uint8_t mousekey_repeat =  0;
 static uint8_t mousekey_accel = 0;
 
+/* direction of movement and wheel keys: -1, 0 or 1 */
+static int8_t dir_x = 0;
+static int8_t dir_y = 0;
+static int8_t dir_v = 0;
+static int8_t dir_h = 0;
+/* velocity in 1/256 unit per mk_interval */
+static int16_t vel_x = 0;
+static int16_t vel_y = 0;
+static int16_t vel_v = 0;
+static int16_t vel_h = 0;
+/* motion not sent yet, in 1/256 unit */
+static int16_t rem_x = 0;
+static int16_t rem_y = 0;
+static int16_t rem_v = 0;
+static int16_t rem_h = 0;
+/* when first key of motion is pressed */
+static uint16_t move_start = 0;
+/* when motion is integrated last time */
+static uint16_t last_move = 0;
+
 static void mousekey_debug(void);
 
 
@@ -40,14 +61,14 @@ static void mousekey_debug(void);
  */
 /* milliseconds between the initial key press and first repeated motion event (0-2550) */
 uint8_t mk_delay = MOUSEKEY_DELAY/10;
-/* milliseconds between repeated motion events (0-255) */
+/* milliseconds per repeat, speed is motion in this time (0-255) */
 uint8_t mk_interval = MOUSEKEY_INTERVAL;
-/* steady speed (in action_delta units) applied each event (0-255) */
+/* steady speed (in action_delta units) per interval (0-255) */
 uint8_t mk_max_speed = MOUSEKEY_MAX_SPEED;
-/* number of events (count) accelerating to steady speed (0-255) */
+/* number of intervals (count) accelerating to steady speed (0-255) */
 uint8_t mk_time_to_max = MOUSEKEY_TIME_TO_MAX;
-/* ramp used to reach maximum pointer speed (NOT SUPPORTED) */
-//int8_t mk_curve = 0;
+/* ramp used to reach maximum pointer speed (-900-1000), 0 is linear */
+int16_t mk_curve = MOUSEKEY_CURVE;
 /* wheel params */
 uint8_t mk_wheel_max_speed = MOUSEKEY_WHEEL_MAX_SPEED;
 uint8_t mk_wheel_time_to_max = MOUSEKEY_WHEEL_TIME_TO_MAX;
@@ -56,85 +77,203 @@ uint8_t mk_wheel_time_to_max = MOUSEKEY_WHEEL_TIME_TO_MAX;
 static uint16_t last_timer = 0;
 
 
-static uint8_t move_unit(void)
+/*
+ * Acceleration curve
+ *
+ * (x/16)**((1000+curve)/1000) of x=0-16 in 1/255 is tabled with integer
+ * calculation 2**(-e * -log2(x/16)) when mk_curve is changed, and
+ * interpolated between the points.
+ */
+/* -log2(x/16) of x=1-16 in 1/256 */
+static const uint16_t log2_table[16] PROGMEM = {
+    1024, 768, 618, 512, 430, 362, 305, 256, 212, 174, 138, 106, 77, 49, 24, 0
+};
+/* 2**(-x/16) of x=0-16 in 1/65536 */
+static const uint16_t exp2_table[17] PROGMEM = {
+    65535, 62757, 60097, 57549, 55109, 52773, 50535, 48393, 46341,
+    44376, 42495, 40693, 38968, 37316, 35734, 34219, 32768
+};
+
+static uint8_t curve_table[17];
+static int16_t curve_table_curve = INT16_MIN;
+
+static void curve_build(void)
 {
-    uint16_t unit;
-    if (mousekey_accel & (1<<0)) {
-        unit = (MOUSEKEY_MOVE_DELTA * mk_max_speed)/4;
-    } else if (mousekey_accel & (1<<1)) {
-        unit = (MOUSEKEY_MOVE_DELTA * mk_max_speed)/2;
-    } else if (mousekey_accel & (1<<2)) {
-        unit = (MOUSEKEY_MOVE_DELTA * mk_max_speed);
-    } else if (mousekey_repeat == 0) {
-        unit = MOUSEKEY_MOVE_DELTA;
-    } else if (mousekey_repeat >= mk_time_to_max) {
-        unit = MOUSEKEY_MOVE_DELTA * mk_max_speed;
-    } else {
-        unit = (MOUSEKEY_MOVE_DELTA * mk_max_speed * mousekey_repeat) / mk_time_to_max;
+    curve_table[0] = 0;
+    for (uint8_t i = 1; i <= 16; i++) {
+        uint32_t t = (uint32_t)pgm_read_word(&log2_table[i - 1]) * (1000 + mk_curve) / 1000;
+        uint8_t n = t >> 8;
+        uint8_t f = t & 0xFF;
+        uint16_t a = pgm_read_word(&exp2_table[f >> 4]);
+        uint16_t b = pgm_read_word(&exp2_table[(f >> 4) + 1]);
+        uint16_t y = a - (uint16_t)(((uint32_t)(a - b) * (f & 0x0F)) >> 4);
+        curve_table[i] = (n < 16) ? (y >> n) >> 8 : 0;
     }
-    return (unit > MOUSEKEY_MOVE_MAX ? MOUSEKEY_MOVE_MAX : (unit == 0 ? 1 : unit));
+    curve_table_curve = mk_curve;
+}
+
+/* (repeat / time_to_max)**e in 1/255, repeat < time_to_max */
+static uint8_t curve(uint8_t repeat, uint8_t time_to_max)
+{
+    if (curve_table_curve != mk_curve) curve_build();
+
+    uint8_t x = ((uint16_t)repeat << 8) / time_to_max;
+    uint8_t a = curve_table[x >> 4];
+    uint8_t b = curve_table[(x >> 4) + 1];
+    return a + (((b - a) * (x & 0x0F)) >> 4);
 }
 
-static uint8_t wheel_unit(void)
+/* speed in 1/256 unit per event */
+static uint16_t unit_speed(uint8_t delta, uint8_t max_speed, uint8_t time_to_max, uint8_t limit)
 {
-    uint16_t unit;
+    uint32_t max = ((uint32_t)delta * max_speed) << 8;
+    uint32_t unit;
     if (mousekey_accel & (1<<0)) {
-        unit = (MOUSEKEY_WHEEL_DELTA * mk_wheel_max_speed)/4;
+        unit = max/4;
     } else if (mousekey_accel & (1<<1)) {
-        unit = (MOUSEKEY_WHEEL_DELTA * mk_wheel_max_speed)/2;
+        unit = max/2;
     } else if (mousekey_accel & (1<<2)) {
-        unit = (MOUSEKEY_WHEEL_DELTA * mk_wheel_max_speed);
+        unit = max;
     } else if (mousekey_repeat == 0) {
-        unit = MOUSEKEY_WHEEL_DELTA;
-    } else if (mousekey_repeat >= mk_wheel_time_to_max) {
-        unit = MOUSEKEY_WHEEL_DELTA * mk_wheel_max_speed;
+        unit = (uint16_t)delta << 8;
+    } else if (mousekey_repeat >= time_to_max) {
+        unit = max;
     } else {
-        unit = (MOUSEKEY_WHEEL_DELTA * mk_wheel_max_speed * mousekey_repeat) / mk_wheel_time_to_max;
+        unit = (max * curve(mousekey_repeat, time_to_max)) / 255;
     }
-    return (unit > MOUSEKEY_WHEEL_MAX ? MOUSEKEY_WHEEL_MAX : (unit == 0 ? 1 : unit));
+    if (unit > ((uint16_t)limit << 8)) return (uint16_t)limit << 8;
+    if (unit < 256) return 256;
+    return unit;
 }
 
-void mousekey_task(void)
+/*
+ * Time-based motion
+ *
+ * Velocity of each axis is integrated with real elapsed time on every call
+ * of mousekey_task(), so pointer speed doesn't depend on how often main loop
+ * runs. mousekey_repeat is derived from time since motion started. Motion is
+ * sent every MOUSEKEY_REPORT_INTERVAL ms; fraction of unit is carried over.
+ *
+ * With MOUSEKEY_INERTIA(or MOUSEKEY_WHEEL_INERTIA for wheel) velocity
+ * follows target speed with the time constant in ms instead of jumping,
+ * and glides to stop after key is released.
+ */
+static bool mousekey_moving(void)
 {
-    if (timer_elapsed(last_timer) < (mousekey_repeat ? mk_interval : mk_delay*10))
-        return;
+    return dir_x || dir_y || dir_v || dir_h || vel_x || vel_y || vel_v || vel_h;
+}
 
-    if (mouse_report.x == 0 && mouse_report.y == 0 && mouse_report.v == 0 && mouse_report.h == 0)
-        return;
+static int16_t approach(int16_t vel, int16_t target, uint16_t dt, uint16_t time_constant)
+{
+    if (!time_constant || dt >= time_constant)
+        return target;
+
+    int16_t v = vel + (int32_t)(target - vel) * dt / time_constant;
+    // stuck by rounding or slow enough to stop
+    if (v == vel || (target == 0 && v > -32 && v < 32))
+        return target;
+    return v;
+}
+
+static void add_motion(int16_t *rem, int32_t d)
+{
+    int32_t r = *rem + d;
+    // don't catch up long stall
+    if (r >  (MOUSEKEY_MOVE_MAX << 8)) r =  (MOUSEKEY_MOVE_MAX << 8);
+    if (r < -(MOUSEKEY_MOVE_MAX << 8)) r = -(MOUSEKEY_MOVE_MAX << 8);
+    *rem = r;
+}
 
-    if (mousekey_repeat != UINT8_MAX)
-        mousekey_repeat++;
+/* whole units of motion, fraction is left for next report */
+static int8_t take(int16_t *rem)
+{
+    int8_t d = *rem / 256;
+    *rem -= (int16_t)d * 256;
+    return d;
+}
+
+static void mousekey_move(uint16_t dt)
+{
+    uint8_t interval = mk_interval ? mk_interval : 1;
+    uint16_t elapsed = timer_elapsed(move_start);
 
+    if (dir_x || dir_y || dir_v || dir_h) {
+        // no motion until repeat starts
+        if (elapsed < mk_delay*10)
+            return;
+        if (mousekey_repeat != UINT8_MAX) {
+            uint16_t repeat = (elapsed - mk_delay*10) / interval + 1;
+            mousekey_repeat = (repeat > UINT8_MAX) ? UINT8_MAX : repeat;
+        }
+    }
 
-    if (mouse_report.x > 0) mouse_report.x = move_unit();
-    if (mouse_report.x < 0) mouse_report.x = move_unit() * -1;
-    if (mouse_report.y > 0) mouse_report.y = move_unit();
-    if (mouse_report.y < 0) mouse_report.y = move_unit() * -1;
+    uint16_t move = unit_speed(MOUSEKEY_MOVE_DELTA, mk_max_speed, mk_time_to_max, MOUSEKEY_MOVE_MAX);
+    uint16_t wheel = unit_speed(MOUSEKEY_WHEEL_DELTA, mk_wheel_max_speed, mk_wheel_time_to_max, MOUSEKEY_WHEEL_MAX);
 
-    /* diagonal move [1/sqrt(2) = 0.7] */
-    if (mouse_report.x && mouse_report.y) {
-        mouse_report.x *= 0.7;
-        mouse_report.y *= 0.7;
+    /* diagonal move [1/sqrt(2) = 181/256] */
+    if (dir_x && dir_y) {
+        move = ((uint32_t)move * 181) >> 8;
     }
 
-    if (mouse_report.v > 0) mouse_report.v = wheel_unit();
-    if (mouse_report.v < 0) mouse_report.v = wheel_unit() * -1;
-    if (mouse_report.h > 0) mouse_report.h = wheel_unit();
-    if (mouse_report.h < 0) mouse_report.h = wheel_unit() * -1;
+    vel_x = approach(vel_x, dir_x * (int16_t)move, dt, MOUSEKEY_INERTIA);
+    vel_y = approach(vel_y, dir_y * (int16_t)move, dt, MOUSEKEY_INERTIA);
+    vel_v = approach(vel_v, dir_v * (int16_t)wheel, dt, MOUSEKEY_WHEEL_INERTIA);
+    vel_h = approach(vel_h, dir_h * (int16_t)wheel, dt, MOUSEKEY_WHEEL_INERTIA);
 
-    mousekey_send();
+    add_motion(&rem_x, (int32_t)vel_x * dt / interval);
+    add_motion(&rem_y, (int32_t)vel_y * dt / interval);
+    // finer wheel units when host enables Resolution Multiplier
+    add_motion(&rem_v, (int32_t)vel_v * host_mouse_wheel_res() * dt / interval);
+    add_motion(&rem_h, (int32_t)vel_h * host_mouse_pan_res() * dt / interval);
+}
+
+void mousekey_task(void)
+{
+    uint16_t dt = timer_elapsed(last_move);
+    if (!dt)
+        return;
+    last_move = timer_read();
+
+    if (!mousekey_moving())
+        return;
+
+    mousekey_move(dt);
+
+    if (timer_elapsed(last_timer) < MOUSEKEY_REPORT_INTERVAL)
+        return;
+
+    mouse_report.x = take(&rem_x);
+    mouse_report.y = take(&rem_y);
+    mouse_report.v = take(&rem_v);
+    mouse_report.h = take(&rem_h);
+    if (mouse_report.x || mouse_report.y || mouse_report.v || mouse_report.h)
+        mousekey_send();
+}
+
+/* first step is sent on key press */
+static void mousekey_kick(int16_t *rem, int8_t dir, uint16_t delta)
+{
+    add_motion(rem, (int32_t)dir * delta << 8);
 }
 
 void mousekey_on(uint8_t code)
 {
-    if      (code == KC_MS_UP)       mouse_report.y = move_unit() * -1;
-    else if (code == KC_MS_DOWN)     mouse_report.y = move_unit();
-    else if (code == KC_MS_LEFT)     mouse_report.x = move_unit() * -1;
-    else if (code == KC_MS_RIGHT)    mouse_report.x = move_unit();
-    else if (code == KC_MS_WH_UP)    mouse_report.v = wheel_unit();
-    else if (code == KC_MS_WH_DOWN)  mouse_report.v = wheel_unit() * -1;
-    else if (code == KC_MS_WH_LEFT)  mouse_report.h = wheel_unit() * -1;
-    else if (code == KC_MS_WH_RIGHT) mouse_report.h = wheel_unit();
+    if (IS_MOUSEKEY_MOVE(code) || IS_MOUSEKEY_WHEEL(code)) {
+        if (!mousekey_moving()) {
+            move_start = timer_read();
+            last_move = move_start;
+            mousekey_repeat = 0;
+        }
+    }
+
+    if      (code == KC_MS_UP)       mousekey_kick(&rem_y, dir_y = -1, MOUSEKEY_MOVE_DELTA);
+    else if (code == KC_MS_DOWN)     mousekey_kick(&rem_y, dir_y =  1, MOUSEKEY_MOVE_DELTA);
+    else if (code == KC_MS_LEFT)     mousekey_kick(&rem_x, dir_x = -1, MOUSEKEY_MOVE_DELTA);
+    else if (code == KC_MS_RIGHT)    mousekey_kick(&rem_x, dir_x =  1, MOUSEKEY_MOVE_DELTA);
+    else if (code == KC_MS_WH_UP)    mousekey_kick(&rem_v, dir_v =  1, MOUSEKEY_WHEEL_DELTA * host_mouse_wheel_res());
+    else if (code == KC_MS_WH_DOWN)  mousekey_kick(&rem_v, dir_v = -1, MOUSEKEY_WHEEL_DELTA * host_mouse_wheel_res());
+    else if (code == KC_MS_WH_LEFT)  mousekey_kick(&rem_h, dir_h = -1, MOUSEKEY_WHEEL_DELTA * host_mouse_pan_res());
+    else if (code == KC_MS_WH_RIGHT) mousekey_kick(&rem_h, dir_h =  1, MOUSEKEY_WHEEL_DELTA * host_mouse_pan_res());
     else if (code == KC_MS_BTN1)     mouse_report.buttons |= MOUSE_BTN1;
     else if (code == KC_MS_BTN2)     mouse_report.buttons |= MOUSE_BTN2;
     else if (code == KC_MS_BTN3)     mouse_report.buttons |= MOUSE_BTN3;
@@ -143,18 +282,23 @@ void mousekey_on(uint8_t code)
     else if (code == KC_MS_ACCEL0)   mousekey_accel |= (1<<0);
     else if (code == KC_MS_ACCEL1)   mousekey_accel |= (1<<1);
     else if (code == KC_MS_ACCEL2)   mousekey_accel |= (1<<2);
+
+    mouse_report.x = take(&rem_x);
+    mouse_report.y = take(&rem_y);
+    mouse_report.v = take(&rem_v);
+    mouse_report.h = take(&rem_h);
 }
 
 void mousekey_off(uint8_t code)
 {
-    if      (code == KC_MS_UP       && mouse_report.y < 0) mouse_report.y = 0;
-    else if (code == KC_MS_DOWN     && mouse_report.y > 0) mouse_report.y = 0;
-    else if (code == KC_MS_LEFT     && mouse_report.x < 0) mouse_report.x = 0;
-    else if (code == KC_MS_RIGHT    && mouse_report.x > 0) mouse_report.x = 0;
-    else if (code == KC_MS_WH_UP    && mouse_report.v > 0) mouse_report.v = 0;
-    else if (code == KC_MS_WH_DOWN  && mouse_report.v < 0) mouse_report.v = 0;
-    else if (code == KC_MS_WH_LEFT  && mouse_report.h < 0) mouse_report.h = 0;
-    else if (code == KC_MS_WH_RIGHT && mouse_report.h > 0) mouse_report.h = 0;
+    if      (code == KC_MS_UP       && dir_y < 0) dir_y = 0;
+    else if (code == KC_MS_DOWN     && dir_y > 0) dir_y = 0;
+    else if (code == KC_MS_LEFT     && dir_x < 0) dir_x = 0;
+    else if (code == KC_MS_RIGHT    && dir_x > 0) dir_x = 0;
+    else if (code == KC_MS_WH_UP    && dir_v > 0) dir_v = 0;
+    else if (code == KC_MS_WH_DOWN  && dir_v < 0) dir_v = 0;
+    else if (code == KC_MS_WH_LEFT  && dir_h < 0) dir_h = 0;
+    else if (code == KC_MS_WH_RIGHT && dir_h > 0) dir_h = 0;
     else if (code == KC_MS_BTN1) mouse_report.buttons &= ~MOUSE_BTN1;
     else if (code == KC_MS_BTN2) mouse_report.buttons &= ~MOUSE_BTN2;
     else if (code == KC_MS_BTN3) mouse_report.buttons &= ~MOUSE_BTN3;
@@ -164,7 +308,17 @@ void mousekey_off(uint8_t code)
     else if (code == KC_MS_ACCEL1) mousekey_accel &= ~(1<<1);
     else if (code == KC_MS_ACCEL2) mousekey_accel &= ~(1<<2);
 
-    if (mouse_report.x == 0 && mouse_report.y == 0 && mouse_report.v == 0 && mouse_report.h == 0)
+    // without inertia motion stops at once
+    if (!MOUSEKEY_INERTIA) {
+        if (!dir_x) { vel_x = 0; rem_x = 0; }
+        if (!dir_y) { vel_y = 0; rem_y = 0; }
+    }
+    if (!MOUSEKEY_WHEEL_INERTIA) {
+        if (!dir_v) { vel_v = 0; rem_v = 0; }
+        if (!dir_h) { vel_h = 0; rem_h = 0; }
+    }
+
+    if (!dir_x && !dir_y && !dir_v && !dir_h)
         mousekey_repeat = 0;
 }
 
@@ -173,11 +327,25 @@ void mousekey_send(void)
     mousekey_debug();
     host_mouse_send(&mouse_report);
     last_timer = timer_read();
+
+    // motion is sent only once
+    mouse_report.x = 0;
+    mouse_report.y = 0;
+    mouse_report.v = 0;
+    mouse_report.h = 0;
+}
+
+uint8_t mousekey_buttons(void)
+{
+    return mouse_report.buttons;
 }
 
 void mousekey_clear(void)
 {
     mouse_report = (report_mouse_t){};
+    dir_x = dir_y = dir_v = dir_h = 0;
+    vel_x = vel_y = vel_v = vel_h = 0;
+    rem_x = rem_y = rem_v = rem_h = 0;
     mousekey_repeat = 0;
     mousekey_accel = 0;
 }
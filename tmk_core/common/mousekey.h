@@ -44,6 +44,20 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef MOUSEKEY_TIME_TO_MAX
 #define MOUSEKEY_TIME_TO_MAX 20
 #endif
+#ifndef MOUSEKEY_CURVE
+#define MOUSEKEY_CURVE 0
+#endif
+/* ms between motion reports, mouse endpoint is polled every 10ms */
+#ifndef MOUSEKEY_REPORT_INTERVAL
+#define MOUSEKEY_REPORT_INTERVAL 10
+#endif
+/* time constant(ms) of velocity change, 0: no inertia */
+#ifndef MOUSEKEY_INERTIA
+#define MOUSEKEY_INERTIA 0
+#endif
+#ifndef MOUSEKEY_WHEEL_INERTIA
+#define MOUSEKEY_WHEEL_INERTIA 0
+#endif
 #ifndef MOUSEKEY_WHEEL_MAX_SPEED
 #define MOUSEKEY_WHEEL_MAX_SPEED 8
 #endif
@@ -60,6 +74,7 @@ extern uint8_t mk_delay;
 extern uint8_t mk_interval;
 extern uint8_t mk_max_speed;
 extern uint8_t mk_time_to_max;
+extern int16_t mk_curve;
 extern uint8_t mk_wheel_max_speed;
 extern uint8_t mk_wheel_time_to_max;
 
@@ -69,6 +84,8 @@ void mousekey_on(uint8_t code);
 void mousekey_off(uint8_t code);
 void mousekey_clear(void);
 void mousekey_send(void);
+/* buttons held with mouse keys */
+uint8_t mousekey_buttons(void);
 
 #ifdef __cplusplus
 }
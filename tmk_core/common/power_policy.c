@@ -0,0 +1,97 @@
+/*
+Copyright 2016 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <stdint.h>
+#include "power_policy.h"
+#include "timer.h"
+#include "debug.h"
+
+
+static power_state_t state = POWER_ACTIVE;
+static uint32_t last_activity = 0;
+static uint32_t sleep_start = 0;
+
+/* moving average of key event gaps while typing */
+static uint16_t gap_avg = POWER_IDLE_MIN / POWER_IDLE_GAPS;
+static uint16_t sleep_timeout = POWER_SLEEP_TIMEOUT;
+
+
+static void set_state(power_state_t s)
+{
+    dprintf("power: %u -> %u\n", state, s);
+    state = s;
+}
+
+static uint16_t idle_timeout(void)
+{
+    uint32_t t = (uint32_t)gap_avg * POWER_IDLE_GAPS;
+    if (t < POWER_IDLE_MIN) return POWER_IDLE_MIN;
+    if (t > POWER_IDLE_MAX) return POWER_IDLE_MAX;
+    return t;
+}
+
+void power_policy_activity(void)
+{
+    uint32_t now = timer_read32();
+    uint32_t gap = now - last_activity;
+    last_activity = now;
+
+    switch (state) {
+        case POWER_ACTIVE:
+            // gap is less than idle timeout here: avg += (gap - avg)/8
+            gap_avg = gap_avg - (gap_avg >> 3) + (uint16_t)(gap >> 3);
+            break;
+        case POWER_SLEEP:
+            // woken soon: sleep came too early, wait longer next time
+            if (now - sleep_start < sleep_timeout) {
+                if (sleep_timeout <= POWER_SLEEP_MAX / 2) sleep_timeout *= 2;
+            } else {
+                sleep_timeout = POWER_SLEEP_TIMEOUT;
+            }
+            dprintf("power: sleep timeout %u\n", sleep_timeout);
+            set_state(POWER_ACTIVE);
+            break;
+        default:
+            set_state(POWER_ACTIVE);
+            break;
+    }
+}
+
+void power_policy_task(void)
+{
+    uint32_t elapsed = timer_elapsed32(last_activity);
+
+    switch (state) {
+        case POWER_ACTIVE:
+            if (elapsed > idle_timeout()) set_state(POWER_IDLE);
+            break;
+        case POWER_IDLE:
+            if (elapsed > sleep_timeout) {
+                sleep_start = timer_read32();
+                set_state(POWER_SLEEP);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+power_state_t power_policy_state(void)
+{
+    return state;
+}
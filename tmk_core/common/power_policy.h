@@ -0,0 +1,69 @@
+/*
+Copyright 2016 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef POWER_POLICY_H
+#define POWER_POLICY_H
+
+#include <stdint.h>
+
+
+/*
+ * Power policy
+ *
+ * Tracks key activity from keyboard_task and steps down from active through
+ * idle to sleep. Radio link and matrix power follow the state:
+ *
+ *   ACTIVE: typing; link stays active for the best latency
+ *   IDLE:   pause longer than typing rhythm; link can go into sniff mode
+ *   SLEEP:  no activity for long; link and matrix can be powered down
+ *
+ * Any activity returns to ACTIVE at once, while stepping down needs a quiet
+ * period. Idle timeout follows average gap between key events and sleep
+ * timeout backs off when woken shortly after going to sleep.
+ */
+typedef enum {
+    POWER_ACTIVE = 0,
+    POWER_IDLE,
+    POWER_SLEEP,
+} power_state_t;
+
+/* idle timeout: POWER_IDLE_GAPS times of average key event gap(ms) */
+#ifndef POWER_IDLE_GAPS
+#define POWER_IDLE_GAPS         8
+#endif
+#ifndef POWER_IDLE_MIN
+#define POWER_IDLE_MIN          500
+#endif
+#ifndef POWER_IDLE_MAX
+#define POWER_IDLE_MAX          5000
+#endif
+
+/* sleep timeout(ms): doubled up to POWER_SLEEP_MAX on early wake */
+#ifndef POWER_SLEEP_TIMEOUT
+#define POWER_SLEEP_TIMEOUT     10000
+#endif
+#ifndef POWER_SLEEP_MAX
+#define POWER_SLEEP_MAX         60000
+#endif
+
+
+void power_policy_activity(void);
+void power_policy_task(void);
+power_state_t power_policy_state(void);
+
+#endif
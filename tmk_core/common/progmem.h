@@ -7,6 +7,7 @@
 #   define PROGMEM
 #   define pgm_read_byte(p)     *(p)
 #   define pgm_read_word(p)     *(p)
+#   define pgm_read_dword(p)    *(p)
 #endif
 
 #endif
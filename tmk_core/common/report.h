@@ -34,6 +34,21 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MOUSE_BTN4 (1<<3)
 #define MOUSE_BTN5 (1<<4)
 
+/* pointer motion: 16-bit with MOUSE_EXTENDED_REPORT, otherwise 8-bit */
+#ifdef MOUSE_EXTENDED_REPORT
+typedef int16_t mouse_xy_t;
+#define MOUSE_XY_MAX    32767
+/* wheel units per detent once host enables Resolution Multiplier */
+#ifndef MOUSE_WHEEL_RESOLUTION
+#define MOUSE_WHEEL_RESOLUTION  8
+#endif
+#else
+typedef int8_t mouse_xy_t;
+#define MOUSE_XY_MAX    127
+#endif
+/* for 8-bit report of boot protocol or other interfaces */
+#define MOUSE_XY_CLIP8(v)   ((int8_t)((v) > 127 ? 127 : ((v) < -127 ? -127 : (v))))
+
 /* Consumer Page(0x0C)
  * following are supported by Windows: http://msdn.microsoft.com/en-us/windows/hardware/gg463372.aspx
  */
@@ -85,6 +100,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #   define KEYBOARD_REPORT_KEYS (NKRO_EPSIZE - 2)
 #   define KEYBOARD_REPORT_BITS (NKRO_EPSIZE - 1)
 
+#elif defined(PROTOCOL_MBED) && defined(NKRO_ENABLE)
+#   define KEYBOARD_REPORT_SIZE 16
+#   define KEYBOARD_REPORT_KEYS (KEYBOARD_REPORT_SIZE - 2)
+#   define KEYBOARD_REPORT_BITS (KEYBOARD_REPORT_SIZE - 1)
+
 #else
 #   define KEYBOARD_REPORT_SIZE 8
 #   define KEYBOARD_REPORT_KEYS 6
@@ -139,8 +159,8 @@ typedef struct {
 
 typedef struct {
     uint8_t buttons;
-    int8_t x;
-    int8_t y;
+    mouse_xy_t x;
+    mouse_xy_t y;
     int8_t v;
     int8_t h;
 } __attribute__ ((packed)) report_mouse_t;
@@ -0,0 +1,60 @@
+/*
+Copyright 2016 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+#include "print.h"
+#include "startup.h"
+
+
+static uint16_t stage_time[STARTUP_STAGES];
+static uint8_t reached = 0;
+
+
+void startup_mark(uint8_t stage)
+{
+    if (stage >= STARTUP_STAGES || startup_reached(stage)) return;
+    stage_time[stage] = timer_read();
+    reached |= (1<<stage);
+}
+
+bool startup_reached(uint8_t stage)
+{
+    return reached & (1<<stage);
+}
+
+void startup_print(void)
+{
+    print("startup(ms):");
+    for (uint8_t i = 0; i < STARTUP_STAGES; i++) {
+        switch (i) {
+            case STARTUP_INIT:      print(" init:");      break;
+            case STARTUP_USB:       print(" usb:");       break;
+            case STARTUP_MATRIX:    print(" matrix:");    break;
+            case STARTUP_MOUSE:     print(" mouse:");     break;
+            case STARTUP_BOOTMAGIC: print(" bootmagic:"); break;
+            case STARTUP_READY:     print(" ready:");     break;
+        }
+        if (startup_reached(i)) {
+            print_dec(stage_time[i]);
+        } else {
+            print("-");
+        }
+    }
+    print("\n");
+}
@@ -0,0 +1,55 @@
+/*
+Copyright 2016 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+
+
+/*
+ * Startup timeline
+ *
+ * Device initialization runs as state machines from main loop concurrently
+ * with USB enumeration, instead of blocking with long delays. Each stage
+ * records its time(ms since keyboard_init) here to see what startup waits for.
+ */
+enum {
+    STARTUP_INIT = 0,   // keyboard_init
+    STARTUP_USB,        // USB configured
+    STARTUP_MATRIX,     // matrix_init_task done
+    STARTUP_MOUSE,      // mouse initialized
+    STARTUP_BOOTMAGIC,  // bootmagic done
+    STARTUP_READY,      // keyboard_task starts to process keys
+    STARTUP_STAGES
+};
+
+void startup_mark(uint8_t stage);
+bool startup_reached(uint8_t stage);
+void startup_print(void);
+
+
+/*
+ * Deadline for non-blocking wait: set with DEADLINE(ms) and poll with
+ * DEADLINE_PASSED() instead of _delay_ms(). Up to 32767ms.
+ */
+#define DEADLINE(ms)            ((uint16_t)(timer_read() + (ms)))
+#define DEADLINE_PASSED(d)      ((int16_t)(timer_read() - (d)) >= 0)
+
+#endif
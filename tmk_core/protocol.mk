@@ -10,32 +10,37 @@ endif
 ifdef PS2_USE_BUSYWAIT
     SRC += protocol/ps2_busywait.c
     SRC += protocol/ps2_io_avr.c
+    SRC += protocol/ps2_scancode.c
     OPT_DEFS += -DPS2_USE_BUSYWAIT
 endif
 
 ifdef PS2_USE_INT
     SRC += protocol/ps2_interrupt.c
     SRC += protocol/ps2_io_avr.c
+    SRC += protocol/ps2_scancode.c
     OPT_DEFS += -DPS2_USE_INT
 endif
 
 ifdef PS2_USE_USART
     SRC += protocol/ps2_usart.c
     SRC += protocol/ps2_io_avr.c
+    SRC += protocol/ps2_scancode.c
     OPT_DEFS += -DPS2_USE_USART
 endif
 
 
 ifdef SERIAL_MOUSE_MICROSOFT_ENABLE
+    SRC += $(PROTOCOL_DIR)/serial_mouse.c
     SRC += $(PROTOCOL_DIR)/serial_mouse_microsoft.c
     OPT_DEFS += -DSERIAL_MOUSE_ENABLE -DSERIAL_MOUSE_MICROSOFT \
-                -DMOUSE_ENABLE
+                -DSERIAL_RECV_HOOK=serial_mouse_recv -DMOUSE_ENABLE
 endif
 
 ifdef SERIAL_MOUSE_MOUSESYSTEMS_ENABLE
+    SRC += $(PROTOCOL_DIR)/serial_mouse.c
     SRC += $(PROTOCOL_DIR)/serial_mouse_mousesystems.c
     OPT_DEFS += -DSERIAL_MOUSE_ENABLE -DSERIAL_MOUSE_MOUSESYSTEMS \
-                -DMOUSE_ENABLE
+                -DSERIAL_RECV_HOOK=serial_mouse_recv -DMOUSE_ENABLE
 endif
 
 ifdef SERIAL_MOUSE_USE_SOFT
@@ -37,10 +37,22 @@ POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include <stdbool.h>
-#include <util/delay.h>
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include "adb.h"
+#include "timer.h"
+
+
+#if !(defined(ADB_INT_INIT) && \
+      defined(ADB_INT_ON)   && \
+      defined(ADB_INT_OFF)  && \
+      defined(ADB_INT_VECT))
+#   error "ADB pin interrupt setting is required in config.h"
+#endif
+
+#ifdef SLEEP_LED_ENABLE
+#   error "ADB host uses Timer1 which conflicts with SLEEP_LED_ENABLE"
+#endif
 
 
 // GCC doesn't inline functions normally
@@ -54,13 +66,200 @@ static inline void psw_hi(void);
 static inline bool psw_in(void);
 #endif
 
-static inline void attention(void);
-static inline void place_bit0(void);
-static inline void place_bit1(void);
-static inline void send_byte(uint8_t data);
-static inline uint16_t wait_data_lo(uint16_t us);
-static inline uint16_t wait_data_hi(uint16_t us);
-static inline uint16_t adb_host_dev_recv(uint8_t device);
+
+/*
+ * ADB host engine
+ *
+ * A transaction runs in background with global interrupts enabled.
+ * Timer1 runs free at F_CPU/8 and its compare match A places bit cells
+ * of command from host and times out waiting for device. Pin change
+ * interrupt of data line timestamps edges of bit cells from device.
+ *
+ * Edges are placed and timestamped in ISR, so that other interrupts like
+ * USB and timer can delay them by their latency. Bit cells are decided by
+ * ratio of low and high part which tolerates the jitter.
+ */
+#define TICKS(us)       ((uint16_t)((us) * (F_CPU / 8 / 1000000UL)))
+
+enum {
+    IDLE = 0,
+    SEND,       // host places bits
+    TLT,        // stop to start: wait for start bit from device
+    RECV,       // device places bits
+};
+
+static volatile uint8_t state = IDLE;
+static volatile int8_t result = 0;
+static volatile bool srq = false;
+
+static uint32_t send_bits;      // bits to place MSB first
+static uint8_t  send_count;     // bits left
+static uint8_t  send_tlt;       // Tlt after this number of bits left(Listen)
+static bool     send_talk;      // receive after command(Talk)
+static bool     send_lo;        // low part of bit is being placed
+static uint16_t send_hi;        // high part of the bit
+
+static uint8_t  recv_buf[ADB_BUF_SIZE];
+static uint8_t  recv_bits;      // including start bit
+static uint16_t recv_edge;      // falling edge starting the bit
+static uint16_t recv_lo;        // low part of the bit
+
+
+static inline void timeout(uint16_t ticks)
+{
+    OCR1A = TCNT1 + ticks;
+    TIFR1 = (1<<OCF1A);
+}
+
+static inline void schedule(uint16_t ticks)
+{
+    // next edge relative to previous one not to accumulate ISR latency
+    OCR1A += ticks;
+    if ((int16_t)(OCR1A - TCNT1) < (int16_t)TICKS(2)) timeout(TICKS(2));
+}
+
+static void finish(int8_t r)
+{
+    ADB_INT_OFF();
+    TIMSK1 &= ~(1<<OCIE1A);
+    data_hi();
+    result = r;
+    state = IDLE;
+}
+
+static bool start(uint32_t bits, uint8_t count, uint8_t tlt, bool talk)
+{
+    if (state != IDLE) return false;
+
+    send_bits = bits;
+    send_count = count;
+    send_tlt = tlt;
+    send_talk = talk;
+    srq = false;
+    result = 0;
+    recv_bits = 0;
+    for (uint8_t i = 0; i < ADB_BUF_SIZE; i++) recv_buf[i] = 0;
+
+    uint8_t sreg = SREG;
+    cli();
+    state = SEND;
+    // Attention: low in 800us, followed by start bit
+    data_lo();
+    send_lo = false;
+    send_hi = 0;
+    timeout(TICKS(800 - 35));
+    TIMSK1 |= (1<<OCIE1A);
+    SREG = sreg;
+    return true;
+}
+
+static inline void send_isr(void)
+{
+    if (send_lo) {
+        data_hi();
+        send_lo = false;
+        schedule(send_hi);
+    } else if (send_count) {
+        bool b = send_bits & 0x80000000UL;
+        send_bits <<= 1;
+        send_count--;
+        data_lo();
+        send_lo = true;
+        schedule(b ? TICKS(35) : TICKS(65));
+        send_hi = b ? TICKS(65) : TICKS(35);
+        if (send_count && send_count == send_tlt) {
+            send_hi += TICKS(200);      // Tlt/Stop to Start
+        }
+    } else if (send_talk) {
+        // Service Request: device keeps the stop bit low(140-260us)
+        state = TLT;
+        ADB_INT_ON();
+        srq = !data_in();
+        timeout(TICKS(500));
+    } else {
+        finish(0);
+    }
+}
+
+static inline void recv_edge_isr(uint16_t now)
+{
+    if (data_in()) {
+        // rising edge: end of low part
+        recv_lo = now - recv_edge;
+        // no falling edge follows stop bit
+        timeout(TICKS(150));
+    } else {
+        // falling edge: end of bit cell and start of next one
+        uint16_t hi = now - recv_edge - recv_lo;
+        recv_edge = now;
+        timeout(TICKS(400));
+
+        // bit1 when low part is shorter than high part
+        bool b = (recv_lo < hi);
+        if (recv_bits == 0) {
+            if (!b) { finish(-20); return; }    // start bit must be 1
+        } else {
+            uint8_t n = recv_bits - 1;
+            if (n >= ADB_BUF_SIZE * 8) { finish(-22); return; }
+            if (b) recv_buf[n / 8] |= (0x80 >> (n % 8));
+        }
+        recv_bits++;
+    }
+}
+
+ISR(TIMER1_COMPA_vect)
+{
+    switch (state) {
+        case SEND:
+            send_isr();
+            break;
+        case TLT:
+            if (!data_in()) {
+                finish(-30);        // something wrong: line is stuck low
+            } else {
+                finish(0);          // No data to send
+            }
+            break;
+        case RECV:
+            if (!data_in()) {
+                finish(-21);        // stop bit is too long
+            } else if (recv_bits == 0) {
+                finish(-20);        // no start bit
+            } else if ((recv_bits - 1) % 8) {
+                finish(-(recv_bits - 1));   // broken data
+            } else {
+                finish((recv_bits - 1) / 8);
+            }
+            break;
+        default:
+            finish(0);
+            break;
+    }
+}
+
+ISR(ADB_INT_VECT)
+{
+    uint16_t now = TCNT1;
+    switch (state) {
+        case TLT:
+            if (data_in()) {
+                // end of Service Request: Tlt starts
+                timeout(TICKS(500));
+            } else {
+                // start bit
+                state = RECV;
+                recv_edge = now;
+                recv_lo = 0;
+                timeout(TICKS(400));
+            }
+            break;
+        case RECV:
+            recv_edge_isr(now);
+            break;
+        default:
+            break;
+    }
+}
 
 
 void adb_host_init(void)
@@ -70,6 +269,12 @@ void adb_host_init(void)
 #ifdef ADB_PSW_BIT
     psw_hi();
 #endif
+
+    // Timer1: normal mode, clk/8
+    TCCR1A = 0;
+    TCCR1B = (1<<CS11);
+    ADB_INT_INIT();
+    ADB_INT_OFF();
 }
 
 #ifdef ADB_PSW_BIT
@@ -79,6 +284,46 @@ bool adb_host_psw(void)
 }
 #endif
 
+bool adb_host_talk_start(uint8_t cmd)
+{
+    // Startbit(1), Command, Stopbit(0)
+    return start((1UL<<31) | ((uint32_t)cmd<<23), 10, 0, true);
+}
+
+bool adb_host_listen_start(uint8_t cmd, uint8_t data_h, uint8_t data_l)
+{
+    // Startbit(1), Command, Stopbit(0), Tlt, Startbit(1), Data, Stopbit(0)
+    return start((1UL<<31) | ((uint32_t)cmd<<23) |
+                 (1UL<<21) | ((uint32_t)data_h<<13) | ((uint32_t)data_l<<5),
+                 28, 18, false);
+}
+
+bool adb_host_busy(void)
+{
+    return state != IDLE;
+}
+
+bool adb_host_srq(void)
+{
+    return srq;
+}
+
+int8_t adb_host_talk_end(uint8_t *buf, uint8_t len)
+{
+    if (state != IDLE) return 0;
+    if (result > 0) {
+        for (uint8_t i = 0; i < len && i < ADB_BUF_SIZE; i++) buf[i] = recv_buf[i];
+    }
+    return result;
+}
+
+int8_t adb_host_talk_buf(uint8_t cmd, uint8_t *buf, uint8_t len)
+{
+    while (!adb_host_talk_start(cmd)) ;
+    while (adb_host_busy()) ;
+    return adb_host_talk_end(buf, len);
+}
+
 /*
  * Don't call this in a row without the delay, otherwise it makes some of poor controllers
  * overloaded and misses strokes. Recommended interval is 12ms.
@@ -122,93 +367,105 @@ bool adb_host_psw(void)
 //
 // [from Apple IIgs Hardware Reference Second Edition]
 
-enum {
-    ADDR_KEYB  = 0x20,
-    ADDR_MOUSE = 0x30
-};
 
-uint16_t adb_host_kbd_recv(void)
+static uint16_t adb_host_dev_recv(uint8_t addr)
 {
-    return adb_host_dev_recv(ADDR_KEYB);
+    uint8_t buf[2];
+    int8_t r = adb_host_talk_buf(ADB_CMD_TALK(addr, 0), buf, sizeof(buf));
+    if (r <= 0) return r;       // no data(0) or error(negative)
+    return (buf[0]<<8) | buf[1];
 }
 
-#ifdef ADB_MOUSE_ENABLE
-void adb_mouse_init(void) {
-	    return;
+uint16_t adb_host_kbd_recv(void)
+{
+    return adb_host_dev_recv(ADB_ADDR_KEYBOARD);
 }
 
+#ifdef ADB_MOUSE_ENABLE
 uint16_t adb_host_mouse_recv(void)
 {
-    return adb_host_dev_recv(ADDR_MOUSE);
+    return adb_host_dev_recv(ADB_ADDR_MOUSE);
 }
 #endif
 
-static inline uint16_t adb_host_dev_recv(uint8_t device)
+/*
+ * Poll scheduler
+ *
+ * Devices found on bus at startup are polled one at a time. A device
+ * which has data but is not addressed asserts Service Request at stop bit
+ * of the command, then next device is polled until the requester is
+ * found. Otherwise the last device which sent data is polled again, which
+ * is typically being typed or moved.
+ *
+ * Polling a device with no data in a row overloads some of poor
+ * controllers and they miss strokes, so that idle bus is polled at
+ * ADB_POLL_IDLE interval while devices with data or requests are polled
+ * without delay.
+ */
+static uint16_t devices = 0;
+static uint8_t handlers[16];
+static uint8_t active = ADB_ADDR_KEYBOARD;
+static uint8_t target = ADB_ADDR_KEYBOARD;
+static uint16_t idle_timer = 0;
+static bool idle = false;
+
+uint16_t adb_host_find_devices(void)
 {
-    uint16_t data = 0;
-    cli();
-    attention();
-    send_byte(device|0x0C);     // Addr:Keyboard(0010)/Mouse(0011), Cmd:Talk(11), Register0(00)
-    place_bit0();               // Stopbit(0)
-    if (!wait_data_hi(500)) {    // Service Request(310us Adjustable Keyboard): just ignored
-        sei();
-        return -30;             // something wrong
+    uint8_t buf[2];
+    devices = 0;
+    for (uint8_t addr = 1; addr < 16; addr++) {
+        // Register3: device address and handler ID
+        if (adb_host_talk_buf(ADB_CMD_TALK(addr, 3), buf, sizeof(buf)) == 2) {
+            devices |= (1<<addr);
+            handlers[addr] = buf[1];
+        }
     }
-    if (!wait_data_lo(500)) {   // Tlt/Stop to Start(140-260us)
-        sei();
-        return 0;               // No data to send
+    if (devices & (1<<ADB_ADDR_KEYBOARD)) {
+        active = target = ADB_ADDR_KEYBOARD;
     }
-    
-    uint8_t n = 17; // start bit + 16 data bits
-    do {
-        uint8_t lo = (uint8_t) wait_data_hi(130);
-        if (!lo)
-            goto error;
-        
-        uint8_t hi = (uint8_t) wait_data_lo(lo);
-        if (!hi)
-            goto error;
-        
-        hi = lo - hi;
-        lo = 130 - lo;
-        
-        data <<= 1;
-        if (lo < hi) {
-            data |= 1;
-        }
-        else if (n == 17) {
-            sei();
-            return -20;
-        }
+    return devices;
+}
+
+uint8_t adb_host_handler(uint8_t addr)
+{
+    return handlers[addr & 0x0F];
+}
+
+static uint8_t next_device(uint8_t addr)
+{
+    for (uint8_t i = 0; i < 16; i++) {
+        addr = (addr + 1) & 0x0F;
+        if (devices & (1<<addr)) return addr;
     }
-    while ( --n );
+    return ADB_ADDR_KEYBOARD;
+}
 
-    // Stop bit can't be checked normally since it could have service request lenghtening
-    // and its high state never goes low.
-    if (!wait_data_hi(351) || wait_data_lo(91)) {
-        sei();
-        return -21;
+int8_t adb_host_poll(uint8_t *addr, uint8_t *buf, uint8_t len)
+{
+    if (idle && timer_elapsed(idle_timer) < ADB_POLL_IDLE) {
+        *addr = 0;
+        return 0;
     }
-    sei();
-    return data;
 
-error:
-    sei();
-    return -n;
+    *addr = target;
+    int8_t r = adb_host_talk_buf(ADB_CMD_TALK(target, 0), buf, len);
+    if (r > 0) active = target;
+
+    if (adb_host_srq()) {
+        target = next_device(target);
+        idle = false;
+    } else {
+        target = active;
+        idle = (r == 0);
+        idle_timer = timer_read();
+    }
+    return r;
 }
 
 void adb_host_listen(uint8_t cmd, uint8_t data_h, uint8_t data_l)
 {
-    cli();
-    attention();
-    send_byte(cmd);
-    place_bit0();               // Stopbit(0)
-    _delay_us(200);             // Tlt/Stop to Start
-    place_bit1();               // Startbit(1)
-    send_byte(data_h); 
-    send_byte(data_l);
-    place_bit0();               // Stopbit(0);
-    sei();
+    while (!adb_host_listen_start(cmd, data_h, data_l)) ;
+    while (adb_host_busy()) ;
 }
 
 // send state of LEDs
@@ -217,7 +474,7 @@ void adb_host_kbd_led(uint8_t led)
     // Addr:Keyboard(0010), Cmd:Listen(10), Register2(10)
     // send upper byte (not used)
     // send lower byte (bit2: ScrollLock, bit1: CapsLock, bit0:
-    adb_host_listen(0x2A,0,led&0x07);
+    adb_host_listen(ADB_CMD_LISTEN(ADB_ADDR_KEYBOARD, 2),0,led&0x07);
 }
 
 
@@ -240,63 +497,6 @@ static inline bool psw_in()
 }
 #endif
 
-static inline void attention(void)
-{
-    data_lo();
-    _delay_us(800-35); // bit1 holds lo for 35 more
-    place_bit1();
-}
-
-static inline void place_bit0(void)
-{
-    data_lo();
-    _delay_us(65);
-    data_hi();
-    _delay_us(35);
-}
-
-static inline void place_bit1(void)
-{
-    data_lo();
-    _delay_us(35);
-    data_hi();
-    _delay_us(65);
-}
-
-static inline void send_byte(uint8_t data)
-{
-    for (int i = 0; i < 8; i++) {
-        if (data&(0x80>>i))
-            place_bit1();
-        else
-            place_bit0();
-    }
-}
-
-// These are carefully coded to take 6 cycles of overhead.
-// inline asm approach became too convoluted
-static inline uint16_t wait_data_lo(uint16_t us)
-{
-    do {
-        if ( !data_in() )
-            break;
-        _delay_us(1 - (6 * 1000000.0 / F_CPU));
-    }
-    while ( --us );
-    return us;
-}
-
-static inline uint16_t wait_data_hi(uint16_t us)
-{
-    do {
-        if ( data_in() )
-            break;
-        _delay_us(1 - (6 * 1000000.0 / F_CPU));
-    }
-    while ( --us );
-    return us;
-}
-
 
 /*
 ADB Protocol
@@ -52,6 +52,23 @@ POSSIBILITY OF SUCH DAMAGE.
 #define ADB_CAPS        0x39
 
 
+/* default address of devices */
+#define ADB_ADDR_KEYBOARD   2
+#define ADB_ADDR_MOUSE      3
+
+/* commands */
+#define ADB_CMD_LISTEN(addr, reg)   ((addr)<<4 | 0x08 | (reg))
+#define ADB_CMD_TALK(addr, reg)     ((addr)<<4 | 0x0C | (reg))
+
+/* poll interval(ms) when no device has data */
+#ifndef ADB_POLL_IDLE
+#define ADB_POLL_IDLE   2
+#endif
+
+/* max size of register data */
+#define ADB_BUF_SIZE    8
+
+
 // ADB host
 void     adb_host_init(void);
 bool     adb_host_psw(void);
@@ -62,5 +79,18 @@ void     adb_host_kbd_led(uint8_t led);
 void     adb_mouse_task(void);
 void     adb_mouse_init(void);
 
+// Transaction in background: bits are placed and received by interrupts
+bool     adb_host_talk_start(uint8_t cmd);
+bool     adb_host_listen_start(uint8_t cmd, uint8_t data_h, uint8_t data_l);
+bool     adb_host_busy(void);
+bool     adb_host_srq(void);
+int8_t   adb_host_talk_end(uint8_t *buf, uint8_t len);  // size of data or error(<0)
+int8_t   adb_host_talk_buf(uint8_t cmd, uint8_t *buf, uint8_t len);
+
+// Poll scheduler: polls device with data or Service Request first
+uint16_t adb_host_find_devices(void);   // bitmap of device addresses
+uint8_t  adb_host_handler(uint8_t addr);
+int8_t   adb_host_poll(uint8_t *addr, uint8_t *buf, uint8_t len);
+
 
 #endif
@@ -2,6 +2,9 @@ IWRAP_DIR = protocol/iwrap
 
 OPT_DEFS += -DPROTOCOL_IWRAP
 
+# Sniff and sleep link with key activity
+POWER_POLICY_ENABLE = yes
+
 SRC +=	$(IWRAP_DIR)/main.c \
 	$(IWRAP_DIR)/iwrap.c \
 	$(IWRAP_DIR)/suart.S \
@@ -267,12 +267,27 @@ void iwrap_sleep(void)
     iwrap_mux_send("SLEEP");
 }
 
+/*
+ * Link power mode of first connection(link id 0)
+ *     SNIFF {link_id} {max} {min} [{attempt} {timeout}]    interval in 0.625ms slots
+ *     SSR {link_id} {max_latency} {min_remote_timeout} {min_local_timeout}
+ *     ACTIVE {link_id}
+ */
 void iwrap_sniff(void)
 {
+    // 10-20ms interval: no latency felt in typing
+    iwrap_mux_send("SNIFF 0 32 16 1 8");
 }
 
 void iwrap_subrate(void)
 {
+    // allow host to skip sniff anchors up to 200ms while idle
+    iwrap_mux_send("SSR 0 320 0 0");
+}
+
+void iwrap_active(void)
+{
+    iwrap_mux_send("ACTIVE 0");
 }
 
 bool iwrap_failed(void)
@@ -358,8 +373,8 @@ static void send_mouse(report_mouse_t *report)
     xmit(0xa1); // DATA(Input)
     xmit(0x02); // Report ID
     xmit(report->buttons);
-    xmit(report->x);
-    xmit(report->y);
+    xmit(MOUSE_XY_CLIP8(report->x));
+    xmit(MOUSE_XY_CLIP8(report->y));
     xmit(report->v);
     xmit(report->h);
     MUX_FOOTER(0x01);
@@ -37,6 +37,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "debug.h"
 #include "keycode.h"
 #include "command.h"
+#include "power_policy.h"
 
 
 static void sleep(uint8_t term);
@@ -121,9 +122,8 @@ void change_driver(host_driver_t *driver)
 }
 
 
-static bool sleeping = false;
 static bool insomniac = false;   // TODO: should be false for power saving
-static uint16_t last_timer = 0;
+static power_state_t link_state = POWER_ACTIVE;
 
 int main(void)
 {
@@ -161,7 +161,6 @@ int main(void)
     iwrap_init();
     iwrap_call();
 
-    last_timer = timer_read();
     while (true) {
 #ifdef PROTOCOL_VUSB
         if (host_get_driver() == vusb_driver())
@@ -172,18 +171,30 @@ int main(void)
         if (host_get_driver() == vusb_driver())
             vusb_transfer_keyboard();
 #endif
-        // TODO: depricated
-        if (matrix_is_modified() || console()) {
-            last_timer = timer_read();
-            sleeping = false;
-        } else if (!sleeping && timer_elapsed(last_timer) > 4000) {
-            sleeping = true;
-            iwrap_check_connection();
+        if (console()) power_policy_activity();
+
+        // link power mode follows key activity
+        if (link_state != power_policy_state()) {
+            link_state = power_policy_state();
+            if (host_get_driver() == iwrap_driver()) {
+                switch (link_state) {
+                    case POWER_ACTIVE:
+                        iwrap_active();
+                        break;
+                    case POWER_IDLE:
+                        iwrap_sniff();
+                        iwrap_subrate();
+                        break;
+                    case POWER_SLEEP:
+                        iwrap_check_connection();
+                        break;
+                }
+            }
         }
 
         // TODO: suspend.h
         if (host_get_driver() == iwrap_driver()) {
-            if (sleeping && !insomniac) {
+            if (link_state == POWER_SLEEP && !insomniac) {
                 _delay_ms(1);   // wait for UART to send
                 iwrap_sleep();
                 sleep(WDTO_60MS);
@@ -40,6 +40,7 @@
 #include "host.h"
 #include "host_driver.h"
 #include "keyboard.h"
+#include "startup.h"
 #include "action.h"
 #include "led.h"
 #include "sendchar.h"
@@ -175,6 +176,10 @@ void EVENT_USB_Device_Disconnect(void)
 void EVENT_USB_Device_Reset(void)
 {
     print("[R]");
+#ifdef MOUSE_EXTENDED_REPORT
+    // new host enables Resolution Multiplier again
+    mouse_resolution = 0;
+#endif
 }
 
 void EVENT_USB_Device_Suspend()
@@ -295,6 +300,15 @@ void EVENT_USB_Device_ControlRequest(void)
                     ReportData = (uint8_t*)&keyboard_report_sent;
                     ReportSize = sizeof(keyboard_report_sent);
                     break;
+#if defined(MOUSE_ENABLE) && defined(MOUSE_EXTENDED_REPORT)
+                case MOUSE_INTERFACE:
+                    // Feature report: Resolution Multiplier
+                    if ((USB_ControlRequest.wValue >> 8) != HID_REPORT_TYPE_FEATURE)
+                        break;
+                    ReportData = &mouse_resolution;
+                    ReportSize = sizeof(mouse_resolution);
+                    break;
+#endif
                 }
 
                 /* Write the report data to the control endpoint */
@@ -324,6 +338,23 @@ void EVENT_USB_Device_ControlRequest(void)
                     Endpoint_ClearOUT();
                     Endpoint_ClearStatusStage();
                     break;
+#if defined(MOUSE_ENABLE) && defined(MOUSE_EXTENDED_REPORT)
+                case MOUSE_INTERFACE:
+                    // Feature report: Resolution Multiplier, Output report isn't used
+                    if ((USB_ControlRequest.wValue >> 8) != HID_REPORT_TYPE_FEATURE)
+                        break;
+                    Endpoint_ClearSETUP();
+
+                    while (!(Endpoint_IsOUTReceived())) {
+                        if (USB_DeviceState == DEVICE_STATE_Unattached)
+                          return;
+                    }
+                    mouse_resolution = Endpoint_Read_8();
+
+                    Endpoint_ClearOUT();
+                    Endpoint_ClearStatusStage();
+                    break;
+#endif
                 }
 
             }
@@ -596,18 +627,18 @@ int main(void)
     setup_usb();
     sei();
 
-    /* wait for USB startup & debug output */
+    /* init modules while waiting for USB startup */
+    keyboard_init();
     while (USB_DeviceState != DEVICE_STATE_Configured) {
-#if defined(INTERRUPT_CONTROL_ENDPOINT)
-        ;
-#else
+#if !defined(INTERRUPT_CONTROL_ENDPOINT)
         USB_USBTask();
 #endif
+        keyboard_init_task();
     }
+    startup_mark(STARTUP_USB);
     print("USB configured.\n");
+    if (debug_enable && startup_reached(STARTUP_READY)) startup_print();
 
-    /* init modules */
-    keyboard_init();
     host_set_driver(&lufa_driver);
 #ifdef SLEEP_LED_ENABLE
     sleep_led_init();
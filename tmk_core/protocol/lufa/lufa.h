@@ -66,6 +66,9 @@ typedef struct {
     uint16_t usage;
 } __attribute__ ((packed)) report_extra_t;
 
+/* report type in high byte of wValue of GET_REPORT/SET_REPORT */
+#define HID_REPORT_TYPE_FEATURE 0x03
+
 
 #if LUFA_VERSION_INTEGER < 0x120730
     /* old API 120219 */
@@ -39,119 +39,198 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <stdbool.h>
 #include <avr/io.h>
 #include <avr/interrupt.h>
-#include <util/delay.h>
 #include "m0110.h"
+#include "timer.h"
+#include "startup.h"
 #include "debug.h"
 
 
+#if !(defined(M0110_INT_INIT) && \
+      defined(M0110_INT_ON)   && \
+      defined(M0110_INT_OFF)  && \
+      defined(M0110_INT_VECT))
+#   error "M0110 clock pin interrupt setting is required in config.h"
+#endif
+
+
+#define KEY(raw)        ((raw) & 0x7f)
+#define IS_BREAK(raw)   (((raw) & 0x80) == 0x80)
+
+
 static inline uint8_t raw2scan(uint8_t raw);
-static inline uint8_t inquiry(void);
-static inline uint8_t instant(void);
-static inline void clock_lo(void);
-static inline void clock_hi(void);
-static inline bool clock_in(void);
+static void decode(uint8_t raw);
 static inline void data_lo(void);
 static inline void data_hi(void);
 static inline bool data_in(void);
-static inline uint16_t wait_clock_lo(uint16_t us);
-static inline uint16_t wait_clock_hi(uint16_t us);
-static inline uint16_t wait_data_lo(uint16_t us);
-static inline uint16_t wait_data_hi(uint16_t us);
+static inline bool clock_in(void);
 static inline void idle(void);
 static inline void request(void);
 
 
-#define WAIT_US(stat, us, err) do { \
-    if (!wait_##stat(us)) { \
-        m0110_error = err; \
-        goto ERROR; \
-    } \
-} while (0)
-
-#define WAIT_MS(stat, ms, err) do { \
-    uint16_t _ms = ms; \
-    while (_ms) { \
-        if (wait_##stat(1000)) { \
-            break; \
-        } \
-        _ms--; \
-    } \
-    if (_ms == 0) { \
-        m0110_error = err; \
-        goto ERROR; \
-    } \
-} while (0)
-
-#define KEY(raw)        ((raw) & 0x7f)
-#define IS_BREAK(raw)   (((raw) & 0x80) == 0x80)
+volatile uint8_t m0110_error = 0;
 
 
-uint8_t m0110_error = 0;
+/*
+ * M0110 host engine
+ *
+ * CLOCK is always driven by keyboard, so bits are shifted in interrupt of
+ * clock edges: host places a bit on falling edge when sending and reads
+ * a bit on rising edge when receiving. A command and its response run in
+ * background and m0110_task() issues next one from main loop.
+ *
+ * Data of the last command bit is held for 80us after its rising edge; the
+ * line is released from Timer0 compare B interrupt so that no ISR waits.
+ *
+ * Inquiry is kept outstanding so that keyboard responds as soon as key event
+ * occurs, or with NULL after its 250ms timeout. Instant is used instead
+ * to get rest of multi-byte event(Keypad/Shift prefix) without waiting.
+ * Decoded scan codes are queued into ring buffer for m0110_recv_key().
+ */
+enum {
+    IDLE = 0,
+    SEND,       // request to send and command bits
+    HOLD,       // last command bit held
+    RECV,       // response bits
+};
+
+/* hold time of the last command bit in Timer0 ticks */
+#define HOLD_TICKS  (TIMER_RAW_FREQ * 80 / 1000000)
+
+static volatile uint8_t state = IDLE;
+static volatile uint16_t last_edge;     // ms
+static uint8_t shift_bits;
+static uint8_t bit_count;
+
+static uint16_t error_deadline;
+static bool error_wait = false;
+
+#define KEY_BUF_SIZE    8
+static uint8_t key_buf[KEY_BUF_SIZE];
+static volatile uint8_t key_head = 0;
+static volatile uint8_t key_tail = 0;
+
+// state of multi-byte event decoding
+static enum {
+    DECODE_NORMAL,
+    DECODE_KEYPAD,          // 79
+    DECODE_SHIFT,           // 71/F1
+    DECODE_SHIFT_KEYPAD,    // 71/F1 79
+} decode_state = DECODE_NORMAL;
+static uint8_t decode_shift;
+
+
+static void key_put(uint8_t key)
+{
+    uint8_t next = (key_head + 1) % KEY_BUF_SIZE;
+    if (next == key_tail) return;   // overflow: drop
+    key_buf[key_head] = key;
+    key_head = next;
+}
 
+static void start(uint8_t cmd)
+{
+    shift_bits = cmd;
+    bit_count = 8;
+    last_edge = timer_read();
+    state = SEND;
+    request();      // keyboard starts clocking
+}
 
-void m0110_init(void)
+static void abort_error(uint8_t err)
 {
+    M0110_INT_OFF();
+    TIMSK0 &= ~(1<<OCIE0B);
+    state = IDLE;
     idle();
-    _delay_ms(1000);
-
-/* Not needed to initialize in fact.
-    uint8_t data;
-    m0110_send(M0110_MODEL);
-    data = m0110_recv();
-    print("m0110_init model: "); phex(data); print("\n");
-
-    m0110_send(M0110_TEST);
-    data = m0110_recv();
-    print("m0110_init test: "); phex(data); print("\n");
-*/
+    M0110_INT_ON();
+
+    m0110_error = err;
+    decode_state = DECODE_NORMAL;
+    dprintf("m0110 err: %02X\n", err);
+    // let keyboard recover
+    error_deadline = DEADLINE(M0110_ERROR_WAIT);
+    error_wait = true;
 }
 
-uint8_t m0110_send(uint8_t data)
+ISR(M0110_INT_VECT)
 {
-    m0110_error = 0;
-
-    request();
-    WAIT_MS(clock_lo, 250, 1);  // keyboard may block long time
-    for (uint8_t bit = 0x80; bit; bit >>= 1) {
-        WAIT_US(clock_lo, 250, 3);
-        if (data&bit) {
-            data_hi();
-        } else {
-            data_lo();
-        }
-        WAIT_US(clock_hi, 200, 4);
+    bool clk = clock_in();
+
+    last_edge = timer_read();
+    switch (state) {
+        case SEND:
+            if (!clk) {
+                // falling edge: place bit MSB first
+                if (shift_bits & 0x80) data_hi(); else data_lo();
+                shift_bits <<= 1;
+            } else if (--bit_count == 0) {
+                // rising edge of last bit: keyboard needs the bit held for 80us
+                uint16_t t = TIMER_RAW + HOLD_TICKS;
+                OCR0B = (t > TIMER_RAW_TOP) ? t - TIMER_RAW_TOP - 1 : t;
+                TIFR0 = (1<<OCF0B);
+                TIMSK0 |= (1<<OCIE0B);
+                state = HOLD;
+            }
+            break;
+        case RECV:
+            if (clk) {
+                // rising edge: read bit MSB first
+                shift_bits <<= 1;
+                if (data_in()) shift_bits |= 1;
+                if (--bit_count == 0) {
+                    state = IDLE;
+                    m0110_error = 0;
+                    decode(shift_bits);
+                }
+            }
+            break;
+        default:
+            break;
     }
-    _delay_us(100); // hold last bit for 80us
+}
+
+// end of holding the last command bit
+ISR(TIMER0_COMPB_vect)
+{
+    TIMSK0 &= ~(1<<OCIE0B);
+    if (state != HOLD) return;
     idle();
-    return 1;
-ERROR:
-    print("m0110_send err: "); phex(m0110_error); print("\n");
-    _delay_ms(500);
+    bit_count = 8;
+    state = RECV;
+}
+
+void m0110_init(void)
+{
     idle();
-    return 0;
+    M0110_INT_INIT();
+    M0110_INT_ON();
+    error_wait = false;
 }
 
-uint8_t m0110_recv(void)
+/* issues next command and watches timeout, called from main loop */
+void m0110_task(void)
 {
-    uint8_t data = 0;
-    m0110_error = 0;
-
-    WAIT_MS(clock_lo, 250, 1);  // keyboard may block long time
-    for (uint8_t i = 0; i < 8; i++) {
-        data <<= 1;
-        WAIT_US(clock_lo, 200, 2);
-        WAIT_US(clock_hi, 200, 3);
-        if (data_in()) {
-            data |= 1;
+    uint8_t s = state;
+
+    if (s == IDLE) {
+        if (error_wait) {
+            if (!DEADLINE_PASSED(error_deadline)) return;
+            error_wait = false;
         }
+        // Instant to get rest of event, otherwise wait for key with Inquiry
+        start(decode_state == DECODE_NORMAL ? M0110_INQUIRY : M0110_INSTANT);
+        return;
+    }
+
+    uint8_t sreg = SREG;
+    cli();
+    uint16_t edge = last_edge;
+    SREG = sreg;
+
+    // keyboard may block 250ms for Inquiry before response
+    if (TIMER_DIFF_16(timer_read(), edge) > M0110_TIMEOUT) {
+        abort_error(s != RECV ? 1 : (bit_count == 8 ? 2 : 3));
     }
-    idle();
-    return data;
-ERROR:
-    print("m0110_recv err: "); phex(m0110_error); print("\n");
-    _delay_ms(500);
-    idle();
-    return 0xFF;
 }
 
 /*
@@ -201,104 +280,113 @@ During Calc key is hold:
 */
 uint8_t m0110_recv_key(void)
 {
-    static uint8_t keybuf = 0x00;
-    static uint8_t keybuf2 = 0x00;
-    static uint8_t rawbuf = 0x00;
-    uint8_t raw, raw2, raw3;
-
-    if (keybuf) {
-        raw = keybuf;
-        keybuf = 0x00;
-        return raw;
-    }
-    if (keybuf2) {
-        raw = keybuf2;
-        keybuf2 = 0x00;
-        return raw;
-    }
+    m0110_task();
 
-    if (rawbuf) {
-        raw = rawbuf;
-        rawbuf = 0x00;
-    } else {
-        raw = instant();  // Use INSTANT for better response. Should be INQUIRY ?
-    }
-    switch (KEY(raw)) {
-        case M0110_KEYPAD:
-            raw2 = instant();
-            switch (KEY(raw2)) {
+    if (key_head == key_tail) return M0110_NULL;
+    uint8_t key = key_buf[key_tail];
+    key_tail = (key_tail + 1) % KEY_BUF_SIZE;
+    return key;
+}
+
+/* runs in ISR when a byte is received */
+static void decode(uint8_t raw)
+{
+    switch (decode_state) {
+        case DECODE_NORMAL:
+            switch (KEY(raw)) {
+                case M0110_KEYPAD:
+                    decode_state = DECODE_KEYPAD;
+                    break;
+                case M0110_SHIFT:
+                    decode_shift = raw;
+                    decode_state = DECODE_SHIFT;
+                    break;
+                case M0110_NULL:
+                    break;
+                default:
+                    // Normal keys
+                    key_put(raw2scan(raw));
+                    break;
+            }
+            break;
+        case DECODE_KEYPAD:
+            switch (KEY(raw)) {
                 case M0110_ARROW_UP:
                 case M0110_ARROW_DOWN:
                 case M0110_ARROW_LEFT:
                 case M0110_ARROW_RIGHT:
-                    if (IS_BREAK(raw2)) {
+                    if (IS_BREAK(raw)) {
                         // Case B,F,N:
-                        keybuf = (raw2scan(raw2) | M0110_CALC_OFFSET); // Calc(u)
-                        return (raw2scan(raw2) | M0110_KEYPAD_OFFSET); // Arrow(u)
+                        key_put(raw2scan(raw) | M0110_KEYPAD_OFFSET); // Arrow(u)
+                        key_put(raw2scan(raw) | M0110_CALC_OFFSET);   // Calc(u)
+                        break;
                     }
+                    // fall through
+                default:
+                    // Keypad or Arrow
+                    key_put(raw2scan(raw) | M0110_KEYPAD_OFFSET);
                     break;
             }
-            // Keypad or Arrow
-            return (raw2scan(raw2) | M0110_KEYPAD_OFFSET);
+            decode_state = DECODE_NORMAL;
             break;
-        case M0110_SHIFT:
-            raw2 = instant();
-            switch (KEY(raw2)) {
+        case DECODE_SHIFT:
+            switch (KEY(raw)) {
                 case M0110_SHIFT:
                     // Case: 5-8,C,G,H
-                    rawbuf = raw2;
-                    return raw2scan(raw); // Shift(d/u)
+                    key_put(raw2scan(decode_shift)); // Shift(d/u)
+                    decode_shift = raw;
                     break;
                 case M0110_KEYPAD:
                     // Shift + Arrow, Calc, or etc.
-                    raw3 = instant();
-                    switch (KEY(raw3)) {
-                        case M0110_ARROW_UP:
-                        case M0110_ARROW_DOWN:
-                        case M0110_ARROW_LEFT:
-                        case M0110_ARROW_RIGHT:
-                            if (IS_BREAK(raw)) {
-                                if (IS_BREAK(raw3)) {
-                                    // Case 4:
-                                    print("(4)\n");
-                                    keybuf2 = raw2scan(raw); // Shift(u)
-                                    keybuf  = (raw2scan(raw3) | M0110_CALC_OFFSET); // Calc(u)
-                                    return (raw2scan(raw3) | M0110_KEYPAD_OFFSET);  // Arrow(u)
-                                } else {
-                                    // Case 3:
-                                    print("(3)\n");
-                                    return (raw2scan(raw)); // Shift(u)
-                                }
-                            } else {
-                                if (IS_BREAK(raw3)) {
-                                    // Case 2:
-                                    print("(2)\n");
-                                    keybuf  = (raw2scan(raw3) | M0110_CALC_OFFSET); // Calc(u)
-                                    return (raw2scan(raw3) | M0110_KEYPAD_OFFSET);  // Arrow(u)
-                                } else {
-                                    // Case 1:
-                                    print("(1)\n");
-                                    return (raw2scan(raw3) | M0110_CALC_OFFSET); // Calc(d)
-                                }
-                            }
-                            break;
-                        default:
-                            // Shift + Keypad
-                            keybuf = (raw2scan(raw3) | M0110_KEYPAD_OFFSET);
-                            return raw2scan(raw);   // Shift(d/u)
-                            break;
-                    }
+                    decode_state = DECODE_SHIFT_KEYPAD;
+                    break;
+                case M0110_NULL:
+                    // Shift alone
+                    key_put(raw2scan(decode_shift));
+                    decode_state = DECODE_NORMAL;
                     break;
                 default:
                     // Shift + Normal keys
-                    keybuf = raw2scan(raw2);
-                    return raw2scan(raw);   // Shift(d/u)
+                    key_put(raw2scan(decode_shift)); // Shift(d/u)
+                    key_put(raw2scan(raw));
+                    decode_state = DECODE_NORMAL;
                     break;
             }
             break;
-        default:
-            // Normal keys
-            return raw2scan(raw);
+        case DECODE_SHIFT_KEYPAD:
+            switch (KEY(raw)) {
+                case M0110_ARROW_UP:
+                case M0110_ARROW_DOWN:
+                case M0110_ARROW_LEFT:
+                case M0110_ARROW_RIGHT:
+                    if (IS_BREAK(decode_shift)) {
+                        if (IS_BREAK(raw)) {
+                            // Case 4:
+                            key_put(raw2scan(raw) | M0110_KEYPAD_OFFSET); // Arrow(u)
+                            key_put(raw2scan(raw) | M0110_CALC_OFFSET);   // Calc(u)
+                            key_put(raw2scan(decode_shift));              // Shift(u)
+                        } else {
+                            // Case 3:
+                            key_put(raw2scan(decode_shift));              // Shift(u)
+                        }
+                    } else {
+                        if (IS_BREAK(raw)) {
+                            // Case 2:
+                            key_put(raw2scan(raw) | M0110_KEYPAD_OFFSET); // Arrow(u)
+                            key_put(raw2scan(raw) | M0110_CALC_OFFSET);   // Calc(u)
+                        } else {
+                            // Case 1:
+                            key_put(raw2scan(raw) | M0110_CALC_OFFSET);   // Calc(d)
+                        }
+                    }
+                    break;
+                default:
+                    // Shift + Keypad
+                    key_put(raw2scan(decode_shift));                      // Shift(d/u)
+                    key_put(raw2scan(raw) | M0110_KEYPAD_OFFSET);
+                    break;
+            }
+            decode_state = DECODE_NORMAL;
             break;
     }
 }
@@ -312,38 +400,8 @@ static inline uint8_t raw2scan(uint8_t raw) {
            );
 }
 
-static inline uint8_t inquiry(void)
-{
-    m0110_send(M0110_INQUIRY);
-    return m0110_recv();
-}
-
-static inline uint8_t instant(void)
-{
-    m0110_send(M0110_INSTANT);
-    uint8_t data = m0110_recv();
-    if (data != M0110_NULL) {
-        debug_hex(data); debug(" ");
-    }
-    return data;
-}
-
-static inline void clock_lo()
-{
-    M0110_CLOCK_PORT &= ~(1<<M0110_CLOCK_BIT);
-    M0110_CLOCK_DDR  |=  (1<<M0110_CLOCK_BIT);
-}
-static inline void clock_hi()
-{
-    /* input with pull up */
-    M0110_CLOCK_DDR  &= ~(1<<M0110_CLOCK_BIT);
-    M0110_CLOCK_PORT |=  (1<<M0110_CLOCK_BIT);
-}
 static inline bool clock_in()
 {
-    M0110_CLOCK_DDR  &= ~(1<<M0110_CLOCK_BIT);
-    M0110_CLOCK_PORT |=  (1<<M0110_CLOCK_BIT);
-    _delay_us(1);
     return M0110_CLOCK_PIN&(1<<M0110_CLOCK_BIT);
 }
 static inline void data_lo()
@@ -359,42 +417,19 @@ static inline void data_hi()
 }
 static inline bool data_in()
 {
-    M0110_DATA_DDR  &= ~(1<<M0110_DATA_BIT);
-    M0110_DATA_PORT |=  (1<<M0110_DATA_BIT);
-    _delay_us(1);
     return M0110_DATA_PIN&(1<<M0110_DATA_BIT);
 }
 
-static inline uint16_t wait_clock_lo(uint16_t us)
-{
-    while (clock_in()  && us) { asm(""); _delay_us(1); us--; }
-    return us;
-}
-static inline uint16_t wait_clock_hi(uint16_t us)
-{
-    while (!clock_in() && us) { asm(""); _delay_us(1); us--; }
-    return us;
-}
-static inline uint16_t wait_data_lo(uint16_t us)
-{
-    while (data_in() && us)  { asm(""); _delay_us(1); us--; }
-    return us;
-}
-static inline uint16_t wait_data_hi(uint16_t us)
-{
-    while (!data_in() && us)  { asm(""); _delay_us(1); us--; }
-    return us;
-}
-
 static inline void idle(void)
 {
-    clock_hi();
+    /* clock: input with pull up */
+    M0110_CLOCK_DDR  &= ~(1<<M0110_CLOCK_BIT);
+    M0110_CLOCK_PORT |=  (1<<M0110_CLOCK_BIT);
     data_hi();
 }
 
 static inline void request(void)
 {
-    clock_hi();
     data_lo();
 }
 
@@ -54,6 +54,8 @@ POSSIBILITY OF SUCH DAMAGE.
 #   error "M0110 data port setting is required in config.h"
 #endif
 
+/* clock pin interrupt on both edges: M0110_INT_INIT/ON/OFF and M0110_INT_VECT */
+
 /* Commands */
 #define M0110_INQUIRY       0x10
 #define M0110_INSTANT       0x14
@@ -74,19 +76,33 @@ POSSIBILITY OF SUCH DAMAGE.
 /* This inidcates no response. */
 #define M0110_ERROR         0xFF
 
+/* time to power up before receiving command(ms) */
+#ifndef M0110_BOOT_TIME
+#define M0110_BOOT_TIME     1000
+#endif
+
+/* no clock edge from keyboard within this means error(ms), Inquiry can take 250ms */
+#ifndef M0110_TIMEOUT
+#define M0110_TIMEOUT       500
+#endif
+
+/* wait after error before next command(ms) */
+#ifndef M0110_ERROR_WAIT
+#define M0110_ERROR_WAIT    500
+#endif
+
 /* scan code offset for keypad and arrow keys */
 #define M0110_KEYPAD_OFFSET 0x40
 #define M0110_CALC_OFFSET   0x60
 
 
-extern uint8_t m0110_error;
+/* last error, kept until next response is received: 1 no clock for command,
+ * 2 no response, 3 response broken */
+extern volatile uint8_t m0110_error;
 
 /* host role */
 void m0110_init(void);
-uint8_t m0110_send(uint8_t data);
-uint8_t m0110_recv(void);
+void m0110_task(void);
 uint8_t m0110_recv_key(void);
-uint8_t m0110_inquiry(void);
-uint8_t m0110_instant(void);
 
 #endif
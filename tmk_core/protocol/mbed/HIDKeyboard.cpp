@@ -1,37 +1,168 @@
 #include <stdint.h>
+#include <string.h>
 #include "USBHID.h"
 #include "USBHID_Types.h"
 #include "USBDescriptor.h"
 #include "HIDKeyboard.h"
+#include "host.h"
+
+#ifdef MOUSE_EXTENDED_REPORT
+#   error "MOUSE_EXTENDED_REPORT is not supported on mbed. Remove it in Makefile."
+#endif
 
 #define DEFAULT_CONFIGURATION (1)
 
+/* HID class requests not in USBHID_Types.h */
+#define GET_PROTOCOL (0x3)
+#define SET_PROTOCOL (0xb)
+
 
 HIDKeyboard::HIDKeyboard(uint16_t vendor_id, uint16_t product_id, uint16_t product_release): USBDevice(vendor_id, product_id, product_release)
 {
+    for (uint8_t i = 0; i < TOTAL_INTERFACES; i++) {
+        slot[i].len = 0;
+        slot[i].busy = false;
+        slot[i].pending = false;
+    }
+    led_state = 0;
+    protocol_state = 1;
+    idle_rate = 0;
+#ifdef CONSOLE_ENABLE
+    console_len = 0;
+#endif
     USBDevice::connect();
 }
 
-bool HIDKeyboard::sendReport(report_keyboard_t report) {
-    USBDevice::write(EP1IN, report.raw, sizeof(report), MAX_PACKET_SIZE_EP1);
+/* Start transfer on endpoint or park report in its pending slot.
+ * Caller must keep USB interrupt from running meanwhile. */
+void HIDKeyboard::startReport(uint8_t epnum, uint8_t *buf, uint8_t len)
+{
+    ep_slot_t *s = &slot[epnum - 1];
+
+    memcpy(s->buf, buf, len);
+    s->len = len;
+    if (s->busy) {
+        s->pending = true;
+    } else {
+        s->busy = true;
+        s->pending = false;
+        writeNB(EPNUM_TO_IN(epnum), s->buf, s->len, MAX_PACKET_SIZE_EPINT);
+    }
+}
+
+bool HIDKeyboard::writeReport(uint8_t epnum, uint8_t *buf, uint8_t len)
+{
+    if (!configured()) return false;
+
+    __disable_irq();
+    startReport(epnum, buf, len);
+    __enable_irq();
+    return true;
+}
+
+/* IN transfer completed: called in ISR context */
+bool HIDKeyboard::writeCompleted(uint8_t epnum)
+{
+    if (epnum > TOTAL_INTERFACES) return false;
+
+    ep_slot_t *s = &slot[epnum - 1];
+    if (s->pending) {
+        s->pending = false;
+        writeNB(EPNUM_TO_IN(epnum), s->buf, s->len, MAX_PACKET_SIZE_EPINT);
+    } else {
+        s->busy = false;
+    }
     return true;
 }
 
+bool HIDKeyboard::sendReport(report_keyboard_t report) {
+#ifdef NKRO_ENABLE
+    if (protocol_state && keyboard_nkro) {
+        return writeReport(NKRO_IN_EPNUM, report.raw, NKRO_EPSIZE);
+    }
+#endif
+    return writeReport(KEYBOARD_IN_EPNUM, report.raw, KEYBOARD_EPSIZE);
+}
+
+#ifdef MOUSE_ENABLE
+bool HIDKeyboard::sendMouse(report_mouse_t report) {
+    return writeReport(MOUSE_IN_EPNUM, (uint8_t *)&report, sizeof(report_mouse_t));
+}
+#endif
+
+#ifdef EXTRAKEY_ENABLE
+bool HIDKeyboard::sendExtra(uint8_t report_id, uint16_t data) {
+    uint8_t report[3] = { report_id, (uint8_t)LSB(data), (uint8_t)MSB(data) };
+    return writeReport(EXTRAKEY_IN_EPNUM, report, sizeof(report));
+}
+#endif
+
+#ifdef CONSOLE_ENABLE
+bool HIDKeyboard::sendConsole(uint8_t c) {
+    if (!configured()) return false;
+
+    bool ret = true;
+    __disable_irq();
+    if (console_len == CONSOLE_EPSIZE) {
+        // previous packet still waits for endpoint
+        ret = false;
+    } else {
+        console_buf[console_len++] = c;
+        // flush on full packet here, otherwise on next SOF
+        if (console_len == CONSOLE_EPSIZE && !slot[CONSOLE_IN_EPNUM - 1].pending) {
+            startReport(CONSOLE_IN_EPNUM, console_buf, CONSOLE_EPSIZE);
+            console_len = 0;
+        }
+    }
+    __enable_irq();
+    return ret;
+}
+#endif
+
+/* Start of Frame: called in ISR context every 1ms */
+void HIDKeyboard::SOF(int frameNumber) {
+#ifdef CONSOLE_ENABLE
+    if (console_len && !slot[CONSOLE_IN_EPNUM - 1].pending && configured()) {
+        // zero padding for hid_listen
+        memset(&console_buf[console_len], 0, CONSOLE_EPSIZE - console_len);
+        startReport(CONSOLE_IN_EPNUM, console_buf, CONSOLE_EPSIZE);
+        console_len = 0;
+    }
+#endif
+}
+
 uint8_t HIDKeyboard::leds() {
     return led_state;
 }
 
+uint8_t HIDKeyboard::protocol() {
+    return protocol_state;
+}
+
 bool HIDKeyboard::USBCallback_setConfiguration(uint8_t configuration) {
     if (configuration != DEFAULT_CONFIGURATION) {
         return false;
     }
 
     // Configure endpoints > 0
-    addEndpoint(EPINT_IN, MAX_PACKET_SIZE_EPINT);
-    //addEndpoint(EPINT_OUT, MAX_PACKET_SIZE_EPINT);
+    addEndpoint(EPNUM_TO_IN(KEYBOARD_IN_EPNUM), MAX_PACKET_SIZE_EPINT);
+#ifdef MOUSE_ENABLE
+    addEndpoint(EPNUM_TO_IN(MOUSE_IN_EPNUM), MAX_PACKET_SIZE_EPINT);
+#endif
+#ifdef EXTRAKEY_ENABLE
+    addEndpoint(EPNUM_TO_IN(EXTRAKEY_IN_EPNUM), MAX_PACKET_SIZE_EPINT);
+#endif
+#ifdef CONSOLE_ENABLE
+    addEndpoint(EPNUM_TO_IN(CONSOLE_IN_EPNUM), MAX_PACKET_SIZE_EPINT);
+#endif
+#ifdef NKRO_ENABLE
+    addEndpoint(EPNUM_TO_IN(NKRO_IN_EPNUM), MAX_PACKET_SIZE_EPINT);
+#endif
 
-    // We activate the endpoint to be able to recceive data
-    //readStart(EPINT_OUT, MAX_PACKET_SIZE_EPINT);
+    for (uint8_t i = 0; i < TOTAL_INTERFACES; i++) {
+        slot[i].busy = false;
+        slot[i].pending = false;
+    }
     return true;
 }
 
@@ -63,99 +194,284 @@ uint8_t * HIDKeyboard::stringIserialDesc() {
     return stringIserialDescriptor;
 }
 
-uint8_t * HIDKeyboard::reportDesc() {
-    static uint8_t reportDescriptor[] = {
-        USAGE_PAGE(1), 0x01,                    // Generic Desktop
-        USAGE(1), 0x06,                         // Keyboard
-        COLLECTION(1), 0x01,                    // Application
-
-        USAGE_PAGE(1), 0x07,                    // Key Codes
-        USAGE_MINIMUM(1), 0xE0,
-        USAGE_MAXIMUM(1), 0xE7,
-        LOGICAL_MINIMUM(1), 0x00,
-        LOGICAL_MAXIMUM(1), 0x01,
-        REPORT_SIZE(1), 0x01,
-        REPORT_COUNT(1), 0x08,
-        INPUT(1), 0x02,                         // Data, Variable, Absolute
-
-        REPORT_COUNT(1), 0x01,
-        REPORT_SIZE(1), 0x08,
-        INPUT(1), 0x01,                         // Constant
-
-        REPORT_COUNT(1), 0x05,
-        REPORT_SIZE(1), 0x01,
-        USAGE_PAGE(1), 0x08,                    // LEDs
-        USAGE_MINIMUM(1), 0x01,
-        USAGE_MAXIMUM(1), 0x05,
-        OUTPUT(1), 0x02,                        // Data, Variable, Absolute
-
-        REPORT_COUNT(1), 0x01,
-        REPORT_SIZE(1), 0x03,
-        OUTPUT(1), 0x01,                        // Constant
-
-
-        REPORT_COUNT(1), 0x06,
-        REPORT_SIZE(1), 0x08,
-        LOGICAL_MINIMUM(1), 0x00,
-        LOGICAL_MAXIMUM(1), 0xFF,
-        USAGE_PAGE(1), 0x07,                    // Key Codes
-        USAGE_MINIMUM(1), 0x00,
-        USAGE_MAXIMUM(1), 0xFF,
-        INPUT(1), 0x00,                         // Data, Array
-        END_COLLECTION(0),
-    };
-    reportLength = sizeof(reportDescriptor);
-    return reportDescriptor;
+static uint8_t keyboardReportDescriptor[] = {
+    USAGE_PAGE(1), 0x01,                    // Generic Desktop
+    USAGE(1), 0x06,                         // Keyboard
+    COLLECTION(1), 0x01,                    // Application
+
+    USAGE_PAGE(1), 0x07,                    // Key Codes
+    USAGE_MINIMUM(1), 0xE0,
+    USAGE_MAXIMUM(1), 0xE7,
+    LOGICAL_MINIMUM(1), 0x00,
+    LOGICAL_MAXIMUM(1), 0x01,
+    REPORT_SIZE(1), 0x01,
+    REPORT_COUNT(1), 0x08,
+    INPUT(1), 0x02,                         // Data, Variable, Absolute
+
+    REPORT_COUNT(1), 0x01,
+    REPORT_SIZE(1), 0x08,
+    INPUT(1), 0x01,                         // Constant
+
+    REPORT_COUNT(1), 0x05,
+    REPORT_SIZE(1), 0x01,
+    USAGE_PAGE(1), 0x08,                    // LEDs
+    USAGE_MINIMUM(1), 0x01,
+    USAGE_MAXIMUM(1), 0x05,
+    OUTPUT(1), 0x02,                        // Data, Variable, Absolute
+
+    REPORT_COUNT(1), 0x01,
+    REPORT_SIZE(1), 0x03,
+    OUTPUT(1), 0x01,                        // Constant
+
+
+    REPORT_COUNT(1), 0x06,
+    REPORT_SIZE(1), 0x08,
+    LOGICAL_MINIMUM(1), 0x00,
+    LOGICAL_MAXIMUM(1), 0xFF,
+    USAGE_PAGE(1), 0x07,                    // Key Codes
+    USAGE_MINIMUM(1), 0x00,
+    USAGE_MAXIMUM(1), 0xFF,
+    INPUT(1), 0x00,                         // Data, Array
+    END_COLLECTION(0),
+};
+
+#ifdef MOUSE_ENABLE
+static uint8_t mouseReportDescriptor[] = {
+    USAGE_PAGE(1), 0x01,                    // Generic Desktop
+    USAGE(1), 0x02,                         // Mouse
+    COLLECTION(1), 0x01,                    // Application
+    USAGE(1), 0x01,                         // Pointer
+    COLLECTION(1), 0x00,                    // Physical
+
+    USAGE_PAGE(1), 0x09,                    // Button
+    USAGE_MINIMUM(1), 0x01,
+    USAGE_MAXIMUM(1), 0x05,
+    LOGICAL_MINIMUM(1), 0x00,
+    LOGICAL_MAXIMUM(1), 0x01,
+    REPORT_COUNT(1), 0x05,
+    REPORT_SIZE(1), 0x01,
+    INPUT(1), 0x02,                         // Data, Variable, Absolute
+    REPORT_COUNT(1), 0x01,
+    REPORT_SIZE(1), 0x03,
+    INPUT(1), 0x01,                         // Constant
+
+    USAGE_PAGE(1), 0x01,                    // Generic Desktop
+    USAGE(1), 0x30,                         // X
+    USAGE(1), 0x31,                         // Y
+    LOGICAL_MINIMUM(1), 0x81,               // -127
+    LOGICAL_MAXIMUM(1), 0x7f,               // 127
+    REPORT_COUNT(1), 0x02,
+    REPORT_SIZE(1), 0x08,
+    INPUT(1), 0x06,                         // Data, Variable, Relative
+
+    USAGE(1), 0x38,                         // Wheel
+    LOGICAL_MINIMUM(1), 0x81,
+    LOGICAL_MAXIMUM(1), 0x7f,
+    REPORT_COUNT(1), 0x01,
+    REPORT_SIZE(1), 0x08,
+    INPUT(1), 0x06,                         // Data, Variable, Relative
+
+    USAGE_PAGE(1), 0x0C,                    // Consumer
+    USAGE(2), 0x38, 0x02,                   // AC Pan (Horizontal wheel)
+    LOGICAL_MINIMUM(1), 0x81,
+    LOGICAL_MAXIMUM(1), 0x7f,
+    REPORT_COUNT(1), 0x01,
+    REPORT_SIZE(1), 0x08,
+    INPUT(1), 0x06,                         // Data, Variable, Relative
+
+    END_COLLECTION(0),
+    END_COLLECTION(0),
+};
+#endif
+
+#ifdef EXTRAKEY_ENABLE
+static uint8_t extrakeyReportDescriptor[] = {
+    USAGE_PAGE(1), 0x01,                    // Generic Desktop
+    USAGE(1), 0x80,                         // System Control
+    COLLECTION(1), 0x01,                    // Application
+    REPORT_ID(1), REPORT_ID_SYSTEM,
+    LOGICAL_MINIMUM(2), 0x01, 0x00,
+    LOGICAL_MAXIMUM(2), 0xB7, 0x00,
+    USAGE_MINIMUM(2), 0x01, 0x00,           // System Power Down
+    USAGE_MAXIMUM(2), 0xB7, 0x00,           // System Display LCD Autoscale
+    REPORT_SIZE(1), 0x10,
+    REPORT_COUNT(1), 0x01,
+    INPUT(1), 0x00,                         // Data, Array, Absolute
+    END_COLLECTION(0),
+
+    USAGE_PAGE(1), 0x0C,                    // Consumer
+    USAGE(1), 0x01,                         // Consumer Control
+    COLLECTION(1), 0x01,                    // Application
+    REPORT_ID(1), REPORT_ID_CONSUMER,
+    LOGICAL_MINIMUM(2), 0x01, 0x00,
+    LOGICAL_MAXIMUM(2), 0x9C, 0x02,
+    USAGE_MINIMUM(2), 0x01, 0x00,
+    USAGE_MAXIMUM(2), 0x9C, 0x02,           // AC Distribute Vertically
+    REPORT_SIZE(1), 0x10,
+    REPORT_COUNT(1), 0x01,
+    INPUT(1), 0x00,                         // Data, Array, Absolute
+    END_COLLECTION(0),
+};
+#endif
+
+#ifdef CONSOLE_ENABLE
+static uint8_t consoleReportDescriptor[] = {
+    USAGE_PAGE(2), 0x31, 0xFF,              // Vendor Page(PJRC Teensy compatible)
+    USAGE(1), 0x74,                         // Vendor Usage(PJRC Teensy compatible)
+    COLLECTION(1), 0x01,                    // Application
+    USAGE(1), 0x75,                         // Vendor Usage 0x75
+    LOGICAL_MINIMUM(1), 0x00,
+    LOGICAL_MAXIMUM(2), 0xFF, 0x00,
+    REPORT_COUNT(1), CONSOLE_EPSIZE,
+    REPORT_SIZE(1), 0x08,
+    INPUT(1), 0x02,                         // Data, Variable, Absolute
+    USAGE(1), 0x76,                         // Vendor Usage 0x76
+    LOGICAL_MINIMUM(1), 0x00,
+    LOGICAL_MAXIMUM(2), 0xFF, 0x00,
+    REPORT_COUNT(1), CONSOLE_EPSIZE,
+    REPORT_SIZE(1), 0x08,
+    OUTPUT(1), 0x02,                        // Data, Variable, Absolute
+    END_COLLECTION(0),
+};
+#endif
+
+#ifdef NKRO_ENABLE
+static uint8_t nkroReportDescriptor[] = {
+    USAGE_PAGE(1), 0x01,                    // Generic Desktop
+    USAGE(1), 0x06,                         // Keyboard
+    COLLECTION(1), 0x01,                    // Application
+
+    USAGE_PAGE(1), 0x07,                    // Key Codes
+    USAGE_MINIMUM(1), 0xE0,
+    USAGE_MAXIMUM(1), 0xE7,
+    LOGICAL_MINIMUM(1), 0x00,
+    LOGICAL_MAXIMUM(1), 0x01,
+    REPORT_COUNT(1), 0x08,
+    REPORT_SIZE(1), 0x01,
+    INPUT(1), 0x02,                         // Data, Variable, Absolute
+
+    USAGE_PAGE(1), 0x08,                    // LEDs
+    USAGE_MINIMUM(1), 0x01,
+    USAGE_MAXIMUM(1), 0x05,
+    REPORT_COUNT(1), 0x05,
+    REPORT_SIZE(1), 0x01,
+    OUTPUT(1), 0x02,                        // Data, Variable, Absolute
+    REPORT_COUNT(1), 0x01,
+    REPORT_SIZE(1), 0x03,
+    OUTPUT(1), 0x01,                        // Constant
+
+    USAGE_PAGE(1), 0x07,                    // Key Codes
+    USAGE_MINIMUM(1), 0x00,
+    USAGE_MAXIMUM(1), (NKRO_EPSIZE-1)*8-1,
+    LOGICAL_MINIMUM(1), 0x00,
+    LOGICAL_MAXIMUM(1), 0x01,
+    REPORT_COUNT(1), (NKRO_EPSIZE-1)*8,
+    REPORT_SIZE(1), 0x01,
+    INPUT(1), 0x02,                         // Data, Variable, Absolute
+    END_COLLECTION(0),
+};
+#endif
+
+uint8_t * HIDKeyboard::reportDesc(uint8_t interface) {
+    switch (interface) {
+#ifdef MOUSE_ENABLE
+        case MOUSE_INTERFACE:       return mouseReportDescriptor;
+#endif
+#ifdef EXTRAKEY_ENABLE
+        case EXTRAKEY_INTERFACE:    return extrakeyReportDescriptor;
+#endif
+#ifdef CONSOLE_ENABLE
+        case CONSOLE_INTERFACE:     return consoleReportDescriptor;
+#endif
+#ifdef NKRO_ENABLE
+        case NKRO_INTERFACE:        return nkroReportDescriptor;
+#endif
+        case KEYBOARD_INTERFACE:    return keyboardReportDescriptor;
+        default:                    return NULL;
+    }
 }
 
-uint16_t HIDKeyboard::reportDescLength() {
-    reportDesc();
-    return reportLength;
+uint16_t HIDKeyboard::reportDescLength(uint8_t interface) {
+    switch (interface) {
+#ifdef MOUSE_ENABLE
+        case MOUSE_INTERFACE:       return sizeof(mouseReportDescriptor);
+#endif
+#ifdef EXTRAKEY_ENABLE
+        case EXTRAKEY_INTERFACE:    return sizeof(extrakeyReportDescriptor);
+#endif
+#ifdef CONSOLE_ENABLE
+        case CONSOLE_INTERFACE:     return sizeof(consoleReportDescriptor);
+#endif
+#ifdef NKRO_ENABLE
+        case NKRO_INTERFACE:        return sizeof(nkroReportDescriptor);
+#endif
+        case KEYBOARD_INTERFACE:    return sizeof(keyboardReportDescriptor);
+        default:                    return 0;
+    }
 }
 
+/* Interface, HID and IN endpoint descriptor of each HID interface */
+#define HID_INTERFACE_LENGTH    (INTERFACE_DESCRIPTOR_LENGTH \
+                               + HID_DESCRIPTOR_LENGTH \
+                               + ENDPOINT_DESCRIPTOR_LENGTH)
+#define HID_INTERFACE_DESC(interface, subclass, protocol, epnum, epsize, interval) \
+        INTERFACE_DESCRIPTOR_LENGTH,    /* bLength */ \
+        INTERFACE_DESCRIPTOR,           /* bDescriptorType */ \
+        (interface),                    /* bInterfaceNumber */ \
+        0x00,                           /* bAlternateSetting */ \
+        0x01,                           /* bNumEndpoints */ \
+        HID_CLASS,                      /* bInterfaceClass */ \
+        (subclass),                     /* bInterfaceSubClass */ \
+        (protocol),                     /* bInterfaceProtocol */ \
+        0x00,                           /* iInterface */ \
+ \
+        HID_DESCRIPTOR_LENGTH,          /* bLength */ \
+        HID_DESCRIPTOR,                 /* bDescriptorType */ \
+        LSB(HID_VERSION_1_11),          /* bcdHID (LSB) */ \
+        MSB(HID_VERSION_1_11),          /* bcdHID (MSB) */ \
+        0x00,                           /* bCountryCode */ \
+        0x01,                           /* bNumDescriptors */ \
+        REPORT_DESCRIPTOR,              /* bDescriptorType */ \
+        (uint8_t)(LSB(reportDescLength(interface))),  /* wDescriptorLength (LSB) */ \
+        (uint8_t)(MSB(reportDescLength(interface))),  /* wDescriptorLength (MSB) */ \
+ \
+        ENDPOINT_DESCRIPTOR_LENGTH,     /* bLength */ \
+        ENDPOINT_DESCRIPTOR,            /* bDescriptorType */ \
+        PHY_TO_DESC(EPNUM_TO_IN(epnum)),/* bEndpointAddress */ \
+        E_INTERRUPT,                    /* bmAttributes */ \
+        LSB(epsize),                    /* wMaxPacketSize (LSB) */ \
+        MSB(epsize),                    /* wMaxPacketSize (MSB) */ \
+        (interval)                      /* bInterval (milliseconds) */
+
 #define TOTAL_DESCRIPTOR_LENGTH ((1 * CONFIGURATION_DESCRIPTOR_LENGTH) \
-                               + (1 * INTERFACE_DESCRIPTOR_LENGTH) \
-                               + (1 * HID_DESCRIPTOR_LENGTH) \
-                               + (1 * ENDPOINT_DESCRIPTOR_LENGTH))
+                               + (TOTAL_INTERFACES * HID_INTERFACE_LENGTH))
 uint8_t * HIDKeyboard::configurationDesc() {
     static uint8_t configurationDescriptor[] = {
         CONFIGURATION_DESCRIPTOR_LENGTH,// bLength
         CONFIGURATION_DESCRIPTOR,       // bDescriptorType
         LSB(TOTAL_DESCRIPTOR_LENGTH),   // wTotalLength (LSB)
         MSB(TOTAL_DESCRIPTOR_LENGTH),   // wTotalLength (MSB)
-        0x01,                           // bNumInterfaces
+        TOTAL_INTERFACES,               // bNumInterfaces
         DEFAULT_CONFIGURATION,          // bConfigurationValue
         0x00,                           // iConfiguration
         C_RESERVED | C_REMOTE_WAKEUP,   // bmAttributes
-        C_POWER(100),                   // bMaxPowerHello World from Mbed
-
-        INTERFACE_DESCRIPTOR_LENGTH,    // bLength
-        INTERFACE_DESCRIPTOR,           // bDescriptorType
-        0x00,                           // bInterfaceNumber
-        0x00,                           // bAlternateSetting
-        0x01,                           // bNumEndpoints
-        HID_CLASS,                      // bInterfaceClass
-        1,                              // bInterfaceSubClass (boot)
-        1,                              // bInterfaceProtocol (keyboard)
-        0x00,                           // iInterface
-
-        HID_DESCRIPTOR_LENGTH,          // bLength
-        HID_DESCRIPTOR,                 // bDescriptorType
-        LSB(HID_VERSION_1_11),          // bcdHID (LSB)
-        MSB(HID_VERSION_1_11),          // bcdHID (MSB)
-        0x00,                           // bCountryCode
-        0x01,                           // bNumDescriptors
-        REPORT_DESCRIPTOR,              // bDescriptorType
-        (uint8_t)(LSB(reportDescLength())),  // wDescriptorLength (LSB)
-        (uint8_t)(MSB(reportDescLength())),  // wDescriptorLength (MSB)
-
-        ENDPOINT_DESCRIPTOR_LENGTH,     // bLength
-        ENDPOINT_DESCRIPTOR,            // bDescriptorType
-        PHY_TO_DESC(EP1IN),             // bEndpointAddress
-        E_INTERRUPT,                    // bmAttributes
-        LSB(MAX_PACKET_SIZE_EPINT),     // wMaxPacketSize (LSB)
-        MSB(MAX_PACKET_SIZE_EPINT),     // wMaxPacketSize (MSB)
-        1,                           // bInterval (milliseconds)
+        C_POWER(100),                   // bMaxPower
+
+        // boot keyboard
+        HID_INTERFACE_DESC(KEYBOARD_INTERFACE, 1, 1, KEYBOARD_IN_EPNUM, KEYBOARD_EPSIZE, 1),
+#ifdef MOUSE_ENABLE
+        // boot mouse
+        HID_INTERFACE_DESC(MOUSE_INTERFACE, 1, 2, MOUSE_IN_EPNUM, MOUSE_EPSIZE, 1),
+#endif
+#ifdef EXTRAKEY_ENABLE
+        HID_INTERFACE_DESC(EXTRAKEY_INTERFACE, 0, 0, EXTRAKEY_IN_EPNUM, EXTRAKEY_EPSIZE, 10),
+#endif
+#ifdef CONSOLE_ENABLE
+        HID_INTERFACE_DESC(CONSOLE_INTERFACE, 0, 0, CONSOLE_IN_EPNUM, CONSOLE_EPSIZE, 1),
+#endif
+#ifdef NKRO_ENABLE
+        HID_INTERFACE_DESC(NKRO_INTERFACE, 0, 0, NKRO_IN_EPNUM, NKRO_EPSIZE, 1),
+#endif
     };
     return configurationDescriptor;
 }
@@ -189,7 +505,7 @@ uint8_t * HIDKeyboard::deviceDesc() {
 bool HIDKeyboard::USBCallback_request() {
     bool success = false;
     CONTROL_TRANSFER * transfer = getTransferPtr();
-    uint8_t *hidDescriptor;
+    uint8_t interface = transfer->setup.wIndex & 0xFF;
 
     // Process additional standard requests
 
@@ -201,22 +517,23 @@ bool HIDKeyboard::USBCallback_request() {
                 switch (DESCRIPTOR_TYPE(transfer->setup.wValue))
                 {
                     case REPORT_DESCRIPTOR:
-                        if ((reportDesc() != NULL) \
-                            && (reportDescLength() != 0))
+                        if ((reportDesc(interface) != NULL) \
+                            && (reportDescLength(interface) != 0))
                         {
-                            transfer->remaining = reportDescLength();
-                            transfer->ptr = reportDesc();
+                            transfer->remaining = reportDescLength(interface);
+                            transfer->ptr = reportDesc(interface);
                             transfer->direction = DEVICE_TO_HOST;
                             success = true;
                         }
                         break;
                     case HID_DESCRIPTOR:
-                            // Find the HID descriptor, after the configuration descriptor
-                            hidDescriptor = findDescriptor(HID_DESCRIPTOR);
-                            if (hidDescriptor != NULL)
+                            // HID descriptor of the interface, after the configuration descriptor
+                            if (interface < TOTAL_INTERFACES)
                             {
                                 transfer->remaining = HID_DESCRIPTOR_LENGTH;
-                                transfer->ptr = hidDescriptor;
+                                transfer->ptr = configurationDesc() + CONFIGURATION_DESCRIPTOR_LENGTH
+                                              + interface * HID_INTERFACE_LENGTH
+                                              + INTERFACE_DESCRIPTOR_LENGTH;
                                 transfer->direction = DEVICE_TO_HOST;
                                 success = true;
                             }
@@ -236,16 +553,45 @@ bool HIDKeyboard::USBCallback_request() {
     {
         switch (transfer->setup.bRequest) {
             case SET_REPORT:
-                // LED indicator
-                // TODO: check Interface and Report length?
-                // if (transfer->setup.wIndex == INTERFACE_KEYBOAD) { }
-                // if (transfer->setup.wLength == 1)
-
+                // LED indicator of keyboard interfaces
+                if (interface == KEYBOARD_INTERFACE
+#ifdef NKRO_ENABLE
+                        || interface == NKRO_INTERFACE
+#endif
+                        ) {
+                    transfer->remaining = 1;
+                    //transfer->ptr = ?? what ptr should be set when OUT(not used?)
+                    transfer->direction = HOST_TO_DEVICE;
+                    transfer->notify = true;    /* notify with USBCallback_requestCompleted */
+                    success = true;
+                }
+                break;
+            case GET_PROTOCOL:
+                if (interface == KEYBOARD_INTERFACE) {
+                    transfer->remaining = 1;
+                    transfer->ptr = &protocol_state;
+                    transfer->direction = DEVICE_TO_HOST;
+                    success = true;
+                }
+                break;
+            case SET_PROTOCOL:
+                if (interface == KEYBOARD_INTERFACE) {
+                    protocol_state = transfer->setup.wValue & 0xFF;
+                    keyboard_protocol = protocol_state;
+                    success = true;
+                }
+                break;
+            case GET_IDLE:
                 transfer->remaining = 1;
-                //transfer->ptr = ?? what ptr should be set when OUT(not used?)
-                transfer->direction = HOST_TO_DEVICE;
-                transfer->notify = true;    /* notify with USBCallback_requestCompleted */
+                transfer->ptr = &idle_rate;
+                transfer->direction = DEVICE_TO_HOST;
                 success = true;
+                break;
+            case SET_IDLE:
+                idle_rate = (transfer->setup.wValue >> 8) & 0xFF;
+                keyboard_idle = idle_rate;
+                success = true;
+                break;
             default:
                 break;
         }
@@ -1,4 +1,5 @@
 #ifndef HIDKEYBOARD_H
+#define HIDKEYBOARD_H
 
 #include "stdint.h"
 #include "stdbool.h"
@@ -6,26 +7,115 @@
 #include "report.h"
 
 
+/* index of interface */
+#define KEYBOARD_INTERFACE          0
+
+#ifdef MOUSE_ENABLE
+#   define MOUSE_INTERFACE          (KEYBOARD_INTERFACE + 1)
+#else
+#   define MOUSE_INTERFACE          KEYBOARD_INTERFACE
+#endif
+
+#ifdef EXTRAKEY_ENABLE
+#   define EXTRAKEY_INTERFACE       (MOUSE_INTERFACE + 1)
+#else
+#   define EXTRAKEY_INTERFACE       MOUSE_INTERFACE
+#endif
+
+#ifdef CONSOLE_ENABLE
+#   define CONSOLE_INTERFACE        (EXTRAKEY_INTERFACE + 1)
+#else
+#   define CONSOLE_INTERFACE        EXTRAKEY_INTERFACE
+#endif
+
+#ifdef NKRO_ENABLE
+#   define NKRO_INTERFACE           (CONSOLE_INTERFACE + 1)
+#else
+#   define NKRO_INTERFACE           CONSOLE_INTERFACE
+#endif
+
+/* nubmer of interfaces */
+#define TOTAL_INTERFACES            (NKRO_INTERFACE + 1)
+
+
+/* Endpoint number: interface N uses IN endpoint N+1 */
+#define KEYBOARD_IN_EPNUM           (KEYBOARD_INTERFACE + 1)
+#define MOUSE_IN_EPNUM              (MOUSE_INTERFACE + 1)
+#define EXTRAKEY_IN_EPNUM           (EXTRAKEY_INTERFACE + 1)
+#define CONSOLE_IN_EPNUM            (CONSOLE_INTERFACE + 1)
+#define NKRO_IN_EPNUM               (NKRO_INTERFACE + 1)
+
+#if TOTAL_INTERFACES >= NUMBER_OF_LOGICAL_ENDPOINTS
+#   error "Endpoints are not available enough to support all functions. Remove some in Makefile.(MOUSEKEY, EXTRAKEY, CONSOLE, NKRO)"
+#endif
+
+/* physical IN endpoint of logical endpoint number */
+#define EPNUM_TO_IN(n)              (((n) << 1) | 1)
+
+#define KEYBOARD_EPSIZE             8
+#define MOUSE_EPSIZE                8
+#define EXTRAKEY_EPSIZE             8
+#define CONSOLE_EPSIZE              32
+#define NKRO_EPSIZE                 KEYBOARD_REPORT_SIZE
+
+
 class HIDKeyboard : public USBDevice {
 public:
     HIDKeyboard(uint16_t vendor_id = 0xFEED, uint16_t product_id = 0xabed, uint16_t product_release = 0x0001);
 
+    /* Non-blocking: a report written while its endpoint is still busy is
+     * kept in the endpoint's pending slot, replacing older pending one, and
+     * sent from the IN completion interrupt. */
     bool sendReport(report_keyboard_t report);
+#ifdef MOUSE_ENABLE
+    bool sendMouse(report_mouse_t report);
+#endif
+#ifdef EXTRAKEY_ENABLE
+    bool sendExtra(uint8_t report_id, uint16_t data);
+#endif
+#ifdef CONSOLE_ENABLE
+    bool sendConsole(uint8_t c);
+#endif
     uint8_t leds(void);
+    uint8_t protocol(void);
 protected:
-    uint16_t reportLength;
     virtual bool USBCallback_setConfiguration(uint8_t configuration);
     virtual uint8_t * stringImanufacturerDesc();
     virtual uint8_t * stringIproductDesc();
     virtual uint8_t * stringIserialDesc();
-    virtual uint16_t reportDescLength();
-    virtual uint8_t * reportDesc();
+    virtual uint16_t reportDescLength(uint8_t interface);
+    virtual uint8_t * reportDesc(uint8_t interface);
     virtual uint8_t * configurationDesc();
     //virtual uint8_t * deviceDesc();
     virtual bool USBCallback_request();
     virtual void USBCallback_requestCompleted(uint8_t * buf, uint32_t length);
+    virtual void SOF(int frameNumber);
+
+    virtual bool EP1_IN_callback() { return writeCompleted(1); };
+    virtual bool EP2_IN_callback() { return writeCompleted(2); };
+    virtual bool EP3_IN_callback() { return writeCompleted(3); };
+    virtual bool EP4_IN_callback() { return writeCompleted(4); };
+    virtual bool EP5_IN_callback() { return writeCompleted(5); };
 private:
+    typedef struct {
+        uint8_t buf[CONSOLE_EPSIZE];
+        uint8_t len;
+        volatile bool busy;         // transfer in progress
+        volatile bool pending;      // buf waits for endpoint
+    } ep_slot_t;
+
+    void startReport(uint8_t epnum, uint8_t *buf, uint8_t len);
+    bool writeReport(uint8_t epnum, uint8_t *buf, uint8_t len);
+    bool writeCompleted(uint8_t epnum);
+
+    ep_slot_t slot[TOTAL_INTERFACES];
     uint8_t led_state;
+    uint8_t protocol_state;
+    uint8_t idle_rate;
+#ifdef CONSOLE_ENABLE
+    uint8_t console_buf[CONSOLE_EPSIZE];
+    volatile uint8_t console_len;
+#endif
 };
 
 #endif
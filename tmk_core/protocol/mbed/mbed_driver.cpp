@@ -1,10 +1,14 @@
 #include "HIDKeyboard.h"
 #include "host.h"
 #include "host_driver.h"
+#include "sendchar.h"
 #include "mbed_driver.h"
 
 HIDKeyboard keyboard;
 
+uint8_t keyboard_idle = 0;
+uint8_t keyboard_protocol = 1;
+
 
 /* Host driver */
 static uint8_t keyboard_leds(void);
@@ -32,10 +36,28 @@ static void send_keyboard(report_keyboard_t *report)
 }
 static void send_mouse(report_mouse_t *report)
 {
+#ifdef MOUSE_ENABLE
+    keyboard.sendMouse(*report);
+#endif
 }
 static void send_system(uint16_t data)
 {
+#ifdef EXTRAKEY_ENABLE
+    keyboard.sendExtra(REPORT_ID_SYSTEM, data);
+#endif
 }
 static void send_consumer(uint16_t data)
 {
+#ifdef EXTRAKEY_ENABLE
+    keyboard.sendExtra(REPORT_ID_CONSUMER, data);
+#endif
+}
+
+
+/* Console */
+#ifdef CONSOLE_ENABLE
+int8_t sendchar(uint8_t c)
+{
+    return keyboard.sendConsole(c) ? 0 : -1;
 }
+#endif
@@ -27,6 +27,7 @@
 #include <avr/wdt.h>
 #include <util/delay.h>
 #include "keyboard.h"
+#include "startup.h"
 #include "usb.h"
 #include "matrix.h"
 #include "print.h"
@@ -52,11 +53,16 @@ int main(void)
     // If the Teensy is powered without a PC connected to the USB port,
     // this will wait forever.
     usb_init();
-    while (!usb_configured()) /* wait */ ;
-
     print_set_sendchar(sendchar);
 
+    // init modules while waiting
     keyboard_init();
+    while (!usb_configured()) {
+        keyboard_init_task();
+    }
+    startup_mark(STARTUP_USB);
+    if (debug_enable && startup_reached(STARTUP_READY)) startup_print();
+
     host_set_driver(pjrc_driver());
 #ifdef SLEEP_LED_ENABLE
     sleep_led_init();
@@ -257,6 +257,51 @@ static const uint8_t PROGMEM mouse_hid_report_desc[] = {
     0x05, 0x01,                    //     USAGE_PAGE (Generic Desktop)
     0x09, 0x30,                    //     USAGE (X)
     0x09, 0x31,                    //     USAGE (Y)
+#ifdef MOUSE_EXTENDED_REPORT
+    0x16, 0x01, 0x80,              //     LOGICAL_MINIMUM (-32767)
+    0x26, 0xff, 0x7f,              //     LOGICAL_MAXIMUM (32767)
+    0x75, 0x10,                    //     REPORT_SIZE (16)
+    0x95, 0x02,                    //     REPORT_COUNT (2)
+    0x81, 0x06,                    //     INPUT (Data,Var,Rel)
+                                   // ----------------------------  Vertical wheel
+    0xa1, 0x02,                    //     COLLECTION (Logical)
+    0x09, 0x48,                    //       USAGE (Resolution Multiplier)
+    0x15, 0x00,                    //       LOGICAL_MINIMUM (0)
+    0x25, 0x01,                    //       LOGICAL_MAXIMUM (1)
+    0x35, 0x01,                    //       PHYSICAL_MINIMUM (1)
+    0x45, MOUSE_WHEEL_RESOLUTION,  //       PHYSICAL_MAXIMUM (8)
+    0x75, 0x02,                    //       REPORT_SIZE (2)
+    0x95, 0x01,                    //       REPORT_COUNT (1)
+    0xb1, 0x02,                    //       FEATURE (Data,Var,Abs)  - bit0-1
+    0x09, 0x38,                    //       USAGE (Wheel)
+    0x15, 0x81,                    //       LOGICAL_MINIMUM (-127)
+    0x25, 0x7f,                    //       LOGICAL_MAXIMUM (127)
+    0x35, 0x00,                    //       PHYSICAL_MINIMUM (0)        - reset physical
+    0x45, 0x00,                    //       PHYSICAL_MAXIMUM (0)
+    0x75, 0x08,                    //       REPORT_SIZE (8)
+    0x81, 0x06,                    //       INPUT (Data,Var,Rel)
+    0xc0,                          //     END_COLLECTION
+                                   // ----------------------------  Horizontal wheel
+    0xa1, 0x02,                    //     COLLECTION (Logical)
+    0x09, 0x48,                    //       USAGE (Resolution Multiplier)
+    0x15, 0x00,                    //       LOGICAL_MINIMUM (0)
+    0x25, 0x01,                    //       LOGICAL_MAXIMUM (1)
+    0x35, 0x01,                    //       PHYSICAL_MINIMUM (1)
+    0x45, MOUSE_WHEEL_RESOLUTION,  //       PHYSICAL_MAXIMUM (8)
+    0x75, 0x02,                    //       REPORT_SIZE (2)
+    0xb1, 0x02,                    //       FEATURE (Data,Var,Abs)  - bit2-3
+    0x05, 0x0c,                    //       USAGE_PAGE (Consumer Devices)
+    0x0a, 0x38, 0x02,              //       USAGE (AC Pan)
+    0x15, 0x81,                    //       LOGICAL_MINIMUM (-127)
+    0x25, 0x7f,                    //       LOGICAL_MAXIMUM (127)
+    0x35, 0x00,                    //       PHYSICAL_MINIMUM (0)
+    0x45, 0x00,                    //       PHYSICAL_MAXIMUM (0)
+    0x75, 0x08,                    //       REPORT_SIZE (8)
+    0x81, 0x06,                    //       INPUT (Data,Var,Rel)
+    0xc0,                          //     END_COLLECTION
+    0x75, 0x04,                    //     REPORT_SIZE (4)
+    0xb1, 0x03,                    //     FEATURE (Cnst,Var,Abs)  - padding
+#else
     0x15, 0x81,                    //     LOGICAL_MINIMUM (-127)
     0x25, 0x7f,                    //     LOGICAL_MAXIMUM (127)
     0x75, 0x08,                    //     REPORT_SIZE (8)
@@ -279,6 +324,7 @@ static const uint8_t PROGMEM mouse_hid_report_desc[] = {
     0x75, 0x08,                    //     REPORT_SIZE (8)
     0x95, 0x01,                    //     REPORT_COUNT (1)
     0x81, 0x06,                    //     INPUT (Data,Var,Rel)
+#endif
     0xc0,                          //   END_COLLECTION
     0xc0,                          // END_COLLECTION
 };
@@ -679,6 +725,9 @@ ISR(USB_GEN_vect)
 		UECFG1X = EP_SIZE(ENDPOINT0_SIZE) | EP_SINGLE_BUFFER;
 		UEIENX = (1<<RXSTPE);
 		usb_configuration = 0;
+#ifdef MOUSE_EXTENDED_REPORT
+		mouse_resolution = 0;
+#endif
         }
 	if ((intbits & (1<<SOFI)) && usb_configuration) {
 		t = debug_flush_timer;
@@ -945,6 +994,14 @@ ISR(USB_COM_vect)
 		if (wIndex == MOUSE_INTERFACE) {
 			if (bmRequestType == 0xA1) {
 				if (bRequest == HID_GET_REPORT) {
+#ifdef MOUSE_EXTENDED_REPORT
+                                    if ((wValue >> 8) == HID_REPORT_FEATURE) {
+					usb_wait_in_ready();
+					UEDATX = mouse_resolution;
+					usb_send_in();
+					return;
+                                    }
+#endif
                                     if (wValue == HID_REPORT_INPUT) {
 					usb_wait_in_ready();
 					UEDATX = 0;
@@ -969,6 +1026,16 @@ ISR(USB_COM_vect)
 				}
 			}
 			if (bmRequestType == 0x21) {
+#ifdef MOUSE_EXTENDED_REPORT
+				// Feature report: Resolution Multiplier
+				if (bRequest == HID_SET_REPORT && (wValue >> 8) == HID_REPORT_FEATURE) {
+					usb_wait_receive_out();
+					mouse_resolution = UEDATX;
+					usb_ack_out();
+					usb_send_in();
+					return;
+				}
+#endif
 				if (bRequest == HID_SET_PROTOCOL) {
 					usb_mouse_protocol = wValue;
 					usb_send_in();
@@ -31,13 +31,13 @@
 uint8_t usb_mouse_protocol=1;
 
 
-int8_t usb_mouse_send(int8_t x, int8_t y, int8_t wheel_v, int8_t wheel_h, uint8_t buttons)
+int8_t usb_mouse_send(mouse_xy_t x, mouse_xy_t y, int8_t wheel_v, int8_t wheel_h, uint8_t buttons)
 {
 	uint8_t intr_state, timeout;
 
 	if (!usb_configured()) return -1;
-	if (x == -128) x = -127;
-	if (y == -128) y = -127;
+	if (x < -MOUSE_XY_MAX) x = -MOUSE_XY_MAX;
+	if (y < -MOUSE_XY_MAX) y = -MOUSE_XY_MAX;
 	if (wheel_v == -128) wheel_v = -127;
 	if (wheel_h == -128) wheel_h = -127;
 	intr_state = SREG;
@@ -58,8 +58,21 @@ int8_t usb_mouse_send(int8_t x, int8_t y, int8_t wheel_v, int8_t wheel_h, uint8_
 		UENUM = MOUSE_ENDPOINT;
 	}
 	UEDATX = buttons;
+#ifdef MOUSE_EXTENDED_REPORT
+        if (usb_mouse_protocol) {
+            UEDATX = x & 0xFF;
+            UEDATX = x >> 8;
+            UEDATX = y & 0xFF;
+            UEDATX = y >> 8;
+        } else {
+            // boot protocol: 8-bit
+            UEDATX = MOUSE_XY_CLIP8(x);
+            UEDATX = MOUSE_XY_CLIP8(y);
+        }
+#else
 	UEDATX = x;
 	UEDATX = y;
+#endif
         if (usb_mouse_protocol) {
             UEDATX = wheel_v;
             UEDATX = wheel_h;
@@ -70,12 +83,17 @@ int8_t usb_mouse_send(int8_t x, int8_t y, int8_t wheel_v, int8_t wheel_h, uint8_
 	return 0;
 }
 
-void usb_mouse_print(int8_t x, int8_t y, int8_t wheel_v, int8_t wheel_h, uint8_t buttons) {
+void usb_mouse_print(mouse_xy_t x, mouse_xy_t y, int8_t wheel_v, int8_t wheel_h, uint8_t buttons) {
     if (!debug_mouse) return;
     print("usb_mouse[btn|x y v h]: ");
     phex(buttons); print("|");
+#ifdef MOUSE_EXTENDED_REPORT
+    phex16(x); print(" ");
+    phex16(y); print(" ");
+#else
     phex(x); print(" ");
     phex(y); print(" ");
+#endif
     phex(wheel_v); print(" ");
     phex(wheel_h); print("\n");
 }
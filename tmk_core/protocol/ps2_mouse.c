@@ -25,45 +25,154 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "timer.h"
 #include "print.h"
 #include "debug.h"
+#include "startup.h"
 
 
 static report_mouse_t mouse_report = {};
 
+/* packet: 3 bytes, or 4 bytes with wheel(IntelliMouse) */
+static uint8_t packet[4];
+static uint8_t packet_size = 3;
+static uint8_t mouse_id = 0;
 
-static void print_usb_data(void);
 
+static void print_usb_data(void);
 
-/* supports only 3 button mouse at this time */
-uint8_t ps2_mouse_init(void) {
-    uint8_t rcv;
 
-    ps2_host_init();
+static uint8_t send_cmd(uint8_t cmd)
+{
+    uint8_t rcv = ps2_host_send(cmd);
+    if (debug_mouse) {
+        xprintf("ps2_mouse_init: send %02X: %02X %02X\n", cmd, rcv, ps2_error);
+    }
+    return rcv;
+}
 
-    _delay_ms(1000);    // wait for powering up
+static void set_sample_rate(uint8_t rate)
+{
+    send_cmd(0xF3);
+    send_cmd(rate);
+}
 
-    // send Reset
-    rcv = ps2_host_send(0xFF);
-    print("ps2_mouse_init: send Reset: ");
-    phex(rcv); phex(ps2_error); print("\n");
+static uint8_t get_device_id(void)
+{
+    send_cmd(0xF2);
+    return ps2_host_recv_response();
+}
 
-    // read completion code of BAT
-    rcv = ps2_host_recv_response();
-    print("ps2_mouse_init: read BAT: ");
-    phex(rcv); phex(ps2_error); print("\n");
+static void configure(void)
+{
+    // IntelliMouse: sample rate 200, 100, 80 turns on wheel(ID 3)
+    set_sample_rate(200);
+    set_sample_rate(100);
+    set_sample_rate(80);
+    mouse_id = get_device_id();
+    if (mouse_id == 3) {
+        // IntelliMouse Explorer: sample rate 200, 200, 80 turns on buttons 4/5(ID 4)
+        set_sample_rate(200);
+        set_sample_rate(200);
+        set_sample_rate(80);
+        mouse_id = get_device_id();
+    }
+    if (mouse_id == 3 || mouse_id == 4) packet_size = 4;
+    if (debug_mouse) xprintf("ps2_mouse_init: ID: %02X\n", mouse_id);
 
-    // read Device ID
-    rcv = ps2_host_recv_response();
-    print("ps2_mouse_init: read DevID: ");
-    phex(rcv); phex(ps2_error); print("\n");
+    set_sample_rate(PS2_MOUSE_SAMPLE_RATE);
 
+#ifdef PS2_MOUSE_USE_REMOTE_MODE
     // send Set Remote mode
-    rcv = ps2_host_send(0xF0);
-    print("ps2_mouse_init: send 0xF0: ");
-    phex(rcv); phex(ps2_error); print("\n");
+    send_cmd(0xF0);
+#else
+    // Stream mode: enable data reporting
+    send_cmd(0xF4);
+#endif
+}
 
+/* initialization runs from ps2_mouse_task without blocking */
+static enum {
+    INIT_POWERUP,
+    INIT_BAT,
+    INIT_DEVID,
+    INIT_DONE,
+} init_state = INIT_POWERUP;
+static uint16_t init_deadline;
+
+uint8_t ps2_mouse_init(void) {
+    ps2_host_init();
+
+    // wait for powering up
+    init_state = INIT_POWERUP;
+    init_deadline = DEADLINE(PS2_MOUSE_INIT_DELAY);
     return 0;
 }
 
+static bool init_task(void)
+{
+    uint8_t rcv;
+
+    switch (init_state) {
+        case INIT_POWERUP:
+            if (!DEADLINE_PASSED(init_deadline)) return false;
+            // send Reset
+            send_cmd(0xFF);
+            init_deadline = DEADLINE(PS2_MOUSE_BAT_TIMEOUT);
+            init_state = INIT_BAT;
+            return false;
+        case INIT_BAT:
+        case INIT_DEVID:
+            // read completion code of BAT and then Device ID
+            rcv = ps2_host_recv();
+            if (ps2_error && !DEADLINE_PASSED(init_deadline)) return false;
+            if (debug_mouse) {
+                xprintf("ps2_mouse_init: read %s: %02X %02X\n",
+                        (init_state == INIT_BAT ? "BAT" : "DevID"), rcv, ps2_error);
+            }
+            if (init_state == INIT_BAT) {
+                init_deadline = DEADLINE(PS2_MOUSE_BAT_TIMEOUT);
+                init_state = INIT_DEVID;
+                return false;
+            }
+            configure();
+            init_state = INIT_DONE;
+            startup_mark(STARTUP_MOUSE);
+            // fall through
+        case INIT_DONE:
+        default:
+            return true;
+    }
+}
+
+#ifndef PS2_MOUSE_USE_REMOTE_MODE
+/* assembles packet from bytes received by interrupt in background */
+static bool packet_recv(void)
+{
+    static uint8_t len = 0;
+    static uint16_t time = 0;
+
+    // lost byte breaks packet boundary: discard stale part of packet
+    if (len && TIMER_DIFF_16(timer_read(), time) > PS2_MOUSE_PACKET_TIMEOUT) {
+        if (debug_mouse) xprintf("ps2_mouse: discard %u bytes\n", len);
+        len = 0;
+    }
+
+    while (true) {
+        uint8_t c = ps2_host_recv();
+        if (ps2_error == PS2_ERR_NODATA) return false;
+
+        // first byte always has bit3 set
+        if (len == 0) {
+            if (!(c & (1<<3))) continue;
+            time = timer_read();
+        }
+        packet[len++] = c;
+        if (len == packet_size) {
+            len = 0;
+            return true;
+        }
+    }
+}
+#endif
+
 #define X_IS_NEG  (mouse_report.buttons & (1<<PS2_MOUSE_X_SIGN))
 #define Y_IS_NEG  (mouse_report.buttons & (1<<PS2_MOUSE_Y_SIGN))
 #define X_IS_OVF  (mouse_report.buttons & (1<<PS2_MOUSE_X_OVFLW))
@@ -74,35 +183,56 @@ void ps2_mouse_task(void)
     static uint8_t scroll_state = SCROLL_NONE;
     static uint8_t buttons_prev = 0;
 
-    /* receives packet from mouse */
+    if (!init_task()) return;
+
+#ifdef PS2_MOUSE_USE_REMOTE_MODE
+    /* polls packet from mouse */
     uint8_t rcv;
     rcv = ps2_host_send(PS2_MOUSE_READ_DATA);
     if (rcv == PS2_ACK) {
-        mouse_report.buttons = ps2_host_recv_response();
-        mouse_report.x = ps2_host_recv_response();
-        mouse_report.y = ps2_host_recv_response();
+        for (uint8_t i = 0; i < packet_size; i++) {
+            packet[i] = ps2_host_recv_response();
+        }
     } else {
         if (debug_mouse) print("ps2_mouse: fail to get mouse packet\n");
         return;
     }
-        xprintf("%ud ", timer_read());
-        print("ps2_mouse raw: [");
-        phex(mouse_report.buttons); print("|");
-        print_hex8((uint8_t)mouse_report.x); print(" ");
-        print_hex8((uint8_t)mouse_report.y); print("]\n");
+#else
+    /* packet sent by mouse in stream mode */
+    if (!packet_recv()) return;
+#endif
 
-    /* if mouse moves or buttons state changes */
-    if (mouse_report.x || mouse_report.y ||
-            ((mouse_report.buttons ^ buttons_prev) & PS2_MOUSE_BTN_MASK)) {
+    uint8_t buttons_ext = 0;   // buttons 4/5
+    mouse_report.buttons = packet[0];
+    mouse_report.x = packet[1];
+    mouse_report.y = packet[2];
+    if (packet_size == 4) {
+        uint8_t z = packet[3];
+        if (mouse_id == 4) {
+            // bit5: button5, bit4: button4, bit3-0: wheel
+            if (z & (1<<4)) buttons_ext |= MOUSE_BTN4;
+            if (z & (1<<5)) buttons_ext |= MOUSE_BTN5;
+            z = (z & 0x08) ? (z | 0xF0) : (z & 0x0F);
+        }
+        // wheel: positive is toward user
+        int16_t v = -(int8_t)z * host_mouse_wheel_res();
+        mouse_report.v = MOUSE_XY_CLIP8(v);
+    }
 
-#ifdef PS2_MOUSE_DEBUG
+    if (debug_mouse) {
         print("ps2_mouse raw: [");
-        phex(mouse_report.buttons); print("|");
-        print_hex8((uint8_t)mouse_report.x); print(" ");
-        print_hex8((uint8_t)mouse_report.y); print("]\n");
-#endif
+        for (uint8_t i = 0; i < packet_size; i++) {
+            if (i) print(" ");
+            print_hex8(packet[i]);
+        }
+        print("]\n");
+    }
+
+    /* if mouse moves or buttons state changes */
+    if (mouse_report.x || mouse_report.y || mouse_report.v ||
+            ((mouse_report.buttons & PS2_MOUSE_BTN_MASK) | buttons_ext) != buttons_prev) {
 
-        buttons_prev = mouse_report.buttons;
+        buttons_prev = (mouse_report.buttons & PS2_MOUSE_BTN_MASK) | buttons_ext;
 
         // PS/2 mouse data is '9-bit integer'(-256 to 255) which is comprised of sign-bit and 8-bit value.
         // bit: 8    7 ... 0
@@ -111,15 +241,24 @@ void ps2_mouse_task(void)
         // Meanwhile USB HID mouse indicates 8bit data(-127 to 127), note that -128 is not used.
         //
         // This converts PS/2 data into HID value. Use only -127-127 out of PS/2 9-bit.
+        // With MOUSE_EXTENDED_REPORT whole 9-bit value is used.
+#ifdef MOUSE_EXTENDED_REPORT
+        mouse_report.x = X_IS_OVF ? (X_IS_NEG ? -256 : 255) :
+                                    (X_IS_NEG ? (int16_t)packet[1] - 256 : packet[1]);
+        mouse_report.y = Y_IS_OVF ? (Y_IS_NEG ? -256 : 255) :
+                                    (Y_IS_NEG ? (int16_t)packet[2] - 256 : packet[2]);
+#else
         mouse_report.x = X_IS_NEG ?
                           ((!X_IS_OVF && -127 <= mouse_report.x && mouse_report.x <= -1) ?  mouse_report.x : -127) :
                           ((!X_IS_OVF && 0 <= mouse_report.x && mouse_report.x <= 127) ? mouse_report.x : 127);
         mouse_report.y = Y_IS_NEG ?
                           ((!Y_IS_OVF && -127 <= mouse_report.y && mouse_report.y <= -1) ?  mouse_report.y : -127) :
                           ((!Y_IS_OVF && 0 <= mouse_report.y && mouse_report.y <= 127) ? mouse_report.y : 127);
+#endif
 
         // remove sign and overflow flags
         mouse_report.buttons &= PS2_MOUSE_BTN_MASK;
+        mouse_report.buttons |= buttons_ext;
 
         // invert coordinate of y to conform to USB HID mouse
         mouse_report.y = -mouse_report.y;
@@ -139,8 +278,10 @@ void ps2_mouse_task(void)
             if (mouse_report.x || mouse_report.y) {
                 scroll_state = SCROLL_SENT;
 
-                mouse_report.v = -mouse_report.y/(PS2_MOUSE_SCROLL_DIVISOR_V);
-                mouse_report.h =  mouse_report.x/(PS2_MOUSE_SCROLL_DIVISOR_H);
+                int16_t v = -mouse_report.y * host_mouse_wheel_res() / (PS2_MOUSE_SCROLL_DIVISOR_V);
+                int16_t h =  mouse_report.x * host_mouse_pan_res() / (PS2_MOUSE_SCROLL_DIVISOR_H);
+                mouse_report.v = MOUSE_XY_CLIP8(v);
+                mouse_report.h = MOUSE_XY_CLIP8(h);
                 mouse_report.x = 0;
                 mouse_report.y = 0;
                 //host_mouse_send(&mouse_report);
@@ -180,8 +321,13 @@ static void print_usb_data(void)
     if (!debug_mouse) return;
     print("ps2_mouse usb: [");
     phex(mouse_report.buttons); print("|");
+#ifdef MOUSE_EXTENDED_REPORT
+    print_hex16((uint16_t)mouse_report.x); print(" ");
+    print_hex16((uint16_t)mouse_report.y); print(" ");
+#else
     print_hex8((uint8_t)mouse_report.x); print(" ");
     print_hex8((uint8_t)mouse_report.y); print(" ");
+#endif
     print_hex8((uint8_t)mouse_report.v); print(" ");
     print_hex8((uint8_t)mouse_report.h); print("]\n");
 }
@@ -209,7 +355,9 @@ static void print_usb_data(void)
  * Stream Mode: devices sends the data when it changs its state
  * Remote Mode: host polls the data periodically
  *
- * This code uses Remote Mode and polls the data with Read Data(0xEB).
+ * This code uses Stream Mode with receiver in background(PS2_USE_INT or
+ * PS2_USE_USART), or Remote Mode and polls the data with Read Data(0xEB)
+ * when PS2_MOUSE_USE_REMOTE_MODE is defined or PS2_USE_BUSYWAIT is used.
  *
  * Data format:
  * byte|7       6       5       4       3       2       1       0
@@ -217,4 +365,9 @@ static void print_usb_data(void)
  *    0|Yovflw  Xovflw  Ysign   Xsign   1       Middle  Right   Left
  *    1|                    X movement
  *    2|                    Y movement
+ *    3|                    Z movement(wheel, ID 3)
+ *    3|0       0       Btn5    Btn4    Z movement(ID 4)
+ *
+ * IntelliMouse wheel is enabled with Set Sample Rate 200, 100, 80 and
+ * then Get Device ID returns 3; buttons 4/5 with 200, 200, 80 and ID 4.
  */
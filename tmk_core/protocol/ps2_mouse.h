@@ -22,6 +22,31 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define PS2_MOUSE_READ_DATA     0xEB
 
+/* Stream mode needs receiver in background */
+#if defined(PS2_USE_BUSYWAIT) && !defined(PS2_MOUSE_USE_REMOTE_MODE)
+#define PS2_MOUSE_USE_REMOTE_MODE
+#endif
+
+/* wait for powering up before reset(ms) */
+#ifndef PS2_MOUSE_INIT_DELAY
+#define PS2_MOUSE_INIT_DELAY    1000
+#endif
+
+/* self-test(BAT) of mouse completes within this after reset(ms) */
+#ifndef PS2_MOUSE_BAT_TIMEOUT
+#define PS2_MOUSE_BAT_TIMEOUT   1000
+#endif
+
+/* samples per second: 10, 20, 40, 60, 80, 100 or 200 */
+#ifndef PS2_MOUSE_SAMPLE_RATE
+#define PS2_MOUSE_SAMPLE_RATE   200
+#endif
+
+/* bytes of a packet should arrive within this(ms) in stream mode */
+#ifndef PS2_MOUSE_PACKET_TIMEOUT
+#define PS2_MOUSE_PACKET_TIMEOUT    20
+#endif
+
 /*
  * Data format:
  * byte|7       6       5       4       3       2       1       0
@@ -29,6 +54,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
  *    0|Yovflw  Xovflw  Ysign   Xsign   1       Middle  Right   Left
  *    1|                    X movement(0-255)
  *    2|                    Y movement(0-255)
+ *    3|                    Z movement(wheel: IntelliMouse only)
  */
 #define PS2_MOUSE_BTN_MASK      0x07
 #define PS2_MOUSE_BTN_LEFT      0
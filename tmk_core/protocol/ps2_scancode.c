@@ -0,0 +1,62 @@
+/*
+Copyright 2016 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include "progmem.h"
+#include "ps2_scancode.h"
+#include "ps2_scancode_table.h"
+
+
+void ps2_sc_init(ps2_sc_decoder_t *d, const ps2_sc_set_t *set)
+{
+    d->set = set;
+    d->state = 0;
+}
+
+uint8_t ps2_sc_decode(ps2_sc_decoder_t *d, uint8_t code, uint8_t *pos)
+{
+    const ps2_sc_state_t *s = &d->set->states[d->state];
+    const ps2_sc_trans_t *t = &d->set->trans[pgm_read_byte(&s->first)];
+    uint8_t count = pgm_read_byte(&s->count);
+
+    for (; count; count--, t++) {
+        if (pgm_read_byte(&t->code) == code) {
+            d->state = pgm_read_byte(&t->next);
+            *pos = pgm_read_byte(&t->pos);
+            return pgm_read_byte(&t->action);
+        }
+    }
+
+    d->state = 0;
+    uint8_t base = pgm_read_byte(&s->base);
+    uint8_t limit = pgm_read_byte(&s->limit);
+    switch (pgm_read_byte(&s->deflt)) {
+        case PS2_SC_DEF_MAKEBREAK:
+            *pos = (code & 0x7F) | base;
+            return (code & 0x80) ? PS2_SC_BREAK : PS2_SC_MAKE;
+        case PS2_SC_DEF_MAKE:
+            if (limit && code >= limit) return PS2_SC_CLEAR;
+            *pos = code | base;
+            return PS2_SC_MAKE;
+        case PS2_SC_DEF_BREAK:
+            if (limit && code >= limit) return PS2_SC_CLEAR;
+            *pos = code | base;
+            return PS2_SC_BREAK;
+        default:
+            return PS2_SC_NONE;
+    }
+}
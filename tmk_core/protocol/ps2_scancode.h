@@ -0,0 +1,91 @@
+/*
+Copyright 2016 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PS2_SCANCODE_H
+#define PS2_SCANCODE_H
+
+#include <stdint.h>
+
+/*
+ * Table driven scan code decoder for PS/2 Scan Code Set 1, 2 and 3
+ *
+ * Tables are generated into ps2_scancode_table.h by tmk_core/tool/ps2_scancode/gen.py
+ * from scancode.txt, edit the spec and run the tool instead of writing
+ * a new state machine.
+ *
+ * Each received byte is looked up in transitions of current state, which
+ * has a few entries at most, and default action of the state is taken when
+ * not found. Codes are decoded into matrix position(0x00-0xFF).
+ */
+
+/* events returned by ps2_sc_decode, also used as action of transition */
+#define PS2_SC_NONE     0
+#define PS2_SC_MAKE     1
+#define PS2_SC_BREAK    2
+#define PS2_SC_TAP      3   // make of key without break code(Pause), break it on next scan
+#define PS2_SC_CLEAR    4   // overrun or unexpected code, clear all keys
+
+/* default action of state */
+#define PS2_SC_DEF_RESET        0
+#define PS2_SC_DEF_MAKE         1
+#define PS2_SC_DEF_BREAK        2
+#define PS2_SC_DEF_MAKEBREAK    3   // Set 1: bit7 of code indicates break
+
+
+typedef struct {
+    uint8_t first;      // index of first transition
+    uint8_t count;      // number of transitions
+    uint8_t deflt;      // default action
+    uint8_t base;       // OR'd to code in default action
+    uint8_t limit;      // codes at or above this are unexpected, 0 means no limit
+} ps2_sc_state_t;
+
+typedef struct {
+    uint8_t code;
+    uint8_t action;
+    uint8_t pos;
+    uint8_t next;       // index of next state
+} ps2_sc_trans_t;
+
+typedef struct {
+    const ps2_sc_state_t *states;
+    const ps2_sc_trans_t *trans;
+} ps2_sc_set_t;
+
+typedef struct {
+    const ps2_sc_set_t *set;
+    uint8_t state;
+} ps2_sc_decoder_t;
+
+extern const ps2_sc_set_t ps2_sc_set1;
+extern const ps2_sc_set_t ps2_sc_set2;
+extern const ps2_sc_set_t ps2_sc_set3;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void ps2_sc_init(ps2_sc_decoder_t *d, const ps2_sc_set_t *set);
+/* returns event and stores matrix position of MAKE/BREAK/TAP into pos */
+uint8_t ps2_sc_decode(ps2_sc_decoder_t *d, uint8_t code, uint8_t *pos);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
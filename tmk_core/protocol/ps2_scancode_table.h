@@ -0,0 +1,124 @@
+/* Generated by tmk_core/tool/ps2_scancode/gen.py from scancode.txt. Do not edit. */
+#ifndef PS2_SCANCODE_TABLE_H
+#define PS2_SCANCODE_TABLE_H
+
+
+/* Scan Code Set 1 */
+static const ps2_sc_state_t ps2_sc_set1_states[] PROGMEM = {
+    /*  0 INIT           */ {   0,  6, PS2_SC_DEF_MAKEBREAK, 0x00, 0x00 },
+    /*  1 E0             */ {   6,  5, PS2_SC_DEF_MAKEBREAK, 0x80, 0x00 },
+    /*  2 E1             */ {  11,  1, PS2_SC_DEF_RESET    , 0x00, 0x00 },
+    /*  3 E1_1D          */ {  12,  1, PS2_SC_DEF_RESET    , 0x00, 0x00 },
+    /*  4 E1_1D_45       */ {  13,  1, PS2_SC_DEF_RESET    , 0x00, 0x00 },
+    /*  5 E1_1D_45_E1    */ {  14,  1, PS2_SC_DEF_RESET    , 0x00, 0x00 },
+    /*  6 E1_1D_45_E1_9D */ {  15,  1, PS2_SC_DEF_RESET    , 0x00, 0x00 },
+    /*  7 E0_46          */ {  16,  1, PS2_SC_DEF_RESET    , 0x00, 0x00 },
+    /*  8 E0_46_E0       */ {  17,  1, PS2_SC_DEF_RESET    , 0x00, 0x00 },
+};
+static const ps2_sc_trans_t ps2_sc_set1_trans[] PROGMEM = {
+    /* INIT */
+    { 0xE0, PS2_SC_NONE , 0x00,  1 },
+    { 0x00, PS2_SC_CLEAR, 0x00,  0 },
+    { 0xFF, PS2_SC_CLEAR, 0x00,  0 },
+    { 0x54, PS2_SC_MAKE , 0xB7,  0 },
+    { 0xD4, PS2_SC_BREAK, 0xB7,  0 },
+    { 0xE1, PS2_SC_NONE , 0x00,  2 },
+    /* E0 */
+    { 0x2A, PS2_SC_NONE , 0x00,  0 },
+    { 0xAA, PS2_SC_NONE , 0x00,  0 },
+    { 0x36, PS2_SC_NONE , 0x00,  0 },
+    { 0xB6, PS2_SC_NONE , 0x00,  0 },
+    { 0x46, PS2_SC_NONE , 0x00,  7 },
+    /* E1 */
+    { 0x1D, PS2_SC_NONE , 0x00,  3 },
+    /* E1_1D */
+    { 0x45, PS2_SC_NONE , 0x00,  4 },
+    /* E1_1D_45 */
+    { 0xE1, PS2_SC_NONE , 0x00,  5 },
+    /* E1_1D_45_E1 */
+    { 0x9D, PS2_SC_NONE , 0x00,  6 },
+    /* E1_1D_45_E1_9D */
+    { 0xC5, PS2_SC_TAP  , 0xC5,  0 },
+    /* E0_46 */
+    { 0xE0, PS2_SC_NONE , 0x00,  8 },
+    /* E0_46_E0 */
+    { 0xC6, PS2_SC_TAP  , 0xC5,  0 },
+};
+const ps2_sc_set_t ps2_sc_set1 = { ps2_sc_set1_states, ps2_sc_set1_trans };
+
+
+/* Scan Code Set 2 */
+static const ps2_sc_state_t ps2_sc_set2_states[] PROGMEM = {
+    /*  0 INIT                 */ {   0,  6, PS2_SC_DEF_MAKE     , 0x00, 0x80 },
+    /*  1 F0                   */ {   6,  3, PS2_SC_DEF_BREAK    , 0x00, 0x80 },
+    /*  2 E0                   */ {   9,  4, PS2_SC_DEF_MAKE     , 0x80, 0x80 },
+    /*  3 E0_F0                */ {  13,  2, PS2_SC_DEF_BREAK    , 0x80, 0x80 },
+    /*  4 E1                   */ {  15,  1, PS2_SC_DEF_RESET    , 0x00, 0x00 },
+    /*  5 E1_14                */ {  16,  1, PS2_SC_DEF_RESET    , 0x00, 0x00 },
+    /*  6 E1_14_77             */ {  17,  1, PS2_SC_DEF_RESET    , 0x00, 0x00 },
+    /*  7 E1_14_77_E1          */ {  18,  1, PS2_SC_DEF_RESET    , 0x00, 0x00 },
+    /*  8 E1_14_77_E1_F0       */ {  19,  1, PS2_SC_DEF_RESET    , 0x00, 0x00 },
+    /*  9 E1_14_77_E1_F0_14    */ {  20,  1, PS2_SC_DEF_RESET    , 0x00, 0x00 },
+    /* 10 E1_14_77_E1_F0_14_F0 */ {  21,  1, PS2_SC_DEF_RESET    , 0x00, 0x00 },
+    /* 11 E0_7E                */ {  22,  1, PS2_SC_DEF_RESET    , 0x00, 0x00 },
+    /* 12 E0_7E_E0             */ {  23,  1, PS2_SC_DEF_RESET    , 0x00, 0x00 },
+    /* 13 E0_7E_E0_F0          */ {  24,  1, PS2_SC_DEF_RESET    , 0x00, 0x00 },
+};
+static const ps2_sc_trans_t ps2_sc_set2_trans[] PROGMEM = {
+    /* INIT */
+    { 0xE0, PS2_SC_NONE , 0x00,  2 },
+    { 0xF0, PS2_SC_NONE , 0x00,  1 },
+    { 0x00, PS2_SC_CLEAR, 0x00,  0 },
+    { 0x83, PS2_SC_MAKE , 0x83,  0 },
+    { 0x84, PS2_SC_MAKE , 0xFC,  0 },
+    { 0xE1, PS2_SC_NONE , 0x00,  4 },
+    /* F0 */
+    { 0x83, PS2_SC_BREAK, 0x83,  0 },
+    { 0x84, PS2_SC_BREAK, 0xFC,  0 },
+    { 0xF0, PS2_SC_CLEAR, 0x00,  1 },
+    /* E0 */
+    { 0xF0, PS2_SC_NONE , 0x00,  3 },
+    { 0x12, PS2_SC_NONE , 0x00,  0 },
+    { 0x59, PS2_SC_NONE , 0x00,  0 },
+    { 0x7E, PS2_SC_NONE , 0x00, 11 },
+    /* E0_F0 */
+    { 0x12, PS2_SC_NONE , 0x00,  0 },
+    { 0x59, PS2_SC_NONE , 0x00,  0 },
+    /* E1 */
+    { 0x14, PS2_SC_NONE , 0x00,  5 },
+    /* E1_14 */
+    { 0x77, PS2_SC_NONE , 0x00,  6 },
+    /* E1_14_77 */
+    { 0xE1, PS2_SC_NONE , 0x00,  7 },
+    /* E1_14_77_E1 */
+    { 0xF0, PS2_SC_NONE , 0x00,  8 },
+    /* E1_14_77_E1_F0 */
+    { 0x14, PS2_SC_NONE , 0x00,  9 },
+    /* E1_14_77_E1_F0_14 */
+    { 0xF0, PS2_SC_NONE , 0x00, 10 },
+    /* E1_14_77_E1_F0_14_F0 */
+    { 0x77, PS2_SC_TAP  , 0xFE,  0 },
+    /* E0_7E */
+    { 0xE0, PS2_SC_NONE , 0x00, 12 },
+    /* E0_7E_E0 */
+    { 0xF0, PS2_SC_NONE , 0x00, 13 },
+    /* E0_7E_E0_F0 */
+    { 0x7E, PS2_SC_TAP  , 0xFE,  0 },
+};
+const ps2_sc_set_t ps2_sc_set2 = { ps2_sc_set2_states, ps2_sc_set2_trans };
+
+
+/* Scan Code Set 3 */
+static const ps2_sc_state_t ps2_sc_set3_states[] PROGMEM = {
+    /*  0 INIT */ {   0,  2, PS2_SC_DEF_MAKE     , 0x00, 0x88 },
+    /*  1 F0   */ {   2,  0, PS2_SC_DEF_BREAK    , 0x00, 0x88 },
+};
+static const ps2_sc_trans_t ps2_sc_set3_trans[] PROGMEM = {
+    /* INIT */
+    { 0xF0, PS2_SC_NONE , 0x00,  1 },
+    { 0x00, PS2_SC_CLEAR, 0x00,  0 },
+    /* F0 */
+};
+const ps2_sc_set_t ps2_sc_set3 = { ps2_sc_set3_states, ps2_sc_set3_trans };
+
+#endif
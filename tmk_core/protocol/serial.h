@@ -38,10 +38,27 @@ POSSIBILITY OF SUCH DAMAGE.
 #ifndef SERIAL_H
 #define SERIAL_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
 /* host role */
 void serial_init(void);
 uint8_t serial_recv(void);
 int16_t serial_recv2(void);
-void serial_send(uint8_t data);
+/* returns false when data is dropped: TX buffer is full and flow control
+ * prohibits sending. Check serial_send_space() first not to lose data. */
+bool serial_send(uint8_t data);
+/* free space of TX buffer and restart of transmit held by flow control */
+uint8_t serial_send_space(void);
+void serial_send_task(void);
+
+/*
+ * SERIAL_RECV_HOOK names a function which takes received bytes in RX
+ * interrupt instead of RX buffer, for protocol decoder not to depend on
+ * main loop. serial_recv() gets nothing then.
+ */
+#ifdef SERIAL_RECV_HOOK
+void SERIAL_RECV_HOOK(uint8_t data);
+#endif
 
 #endif
@@ -0,0 +1,123 @@
+/*
+Copyright 2014 Robin Haberkorn <robin.haberkorn@googlemail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "serial_mouse.h"
+#include "report.h"
+#include "host.h"
+#include "timer.h"
+#include "print.h"
+#include "debug.h"
+
+
+/* motion decoded in RX interrupt and not sent yet */
+static volatile int16_t acc_x = 0;
+static volatile int16_t acc_y = 0;
+static volatile int16_t acc_v = 0;
+static volatile int16_t acc_h = 0;
+static volatile uint8_t acc_buttons = 0;
+/* buttons pressed since last report, click shorter than a frame is not lost */
+static volatile uint8_t acc_pressed = 0;
+
+static void print_usb_data(const report_mouse_t *report);
+
+
+static void accumulate(volatile int16_t *acc, int16_t d)
+{
+    // saturate instead of wrapping around
+    int32_t sum = (int32_t)*acc + d;
+    *acc = (sum > INT16_MAX) ? INT16_MAX : (sum < -INT16_MAX ? -INT16_MAX : sum);
+}
+
+void serial_mouse_move(int16_t x, int16_t y, int16_t v, int16_t h)
+{
+    accumulate(&acc_x, x);
+    accumulate(&acc_y, y);
+    accumulate(&acc_v, v);
+    accumulate(&acc_h, h);
+}
+
+void serial_mouse_buttons(uint8_t buttons)
+{
+    acc_buttons = buttons;
+    acc_pressed |= buttons;
+}
+
+static int16_t take(int16_t acc, int16_t limit)
+{
+    return (acc > limit) ? limit : (acc < -limit ? -limit : acc);
+}
+
+void serial_mouse_task(void)
+{
+    static uint16_t last_frame = 0;
+    static uint8_t last_buttons = 0;
+    int16_t x, y, v, h;
+    uint8_t buttons;
+
+    // one report per USB frame(1ms)
+    if (timer_read() == last_frame)
+        return;
+
+    uint8_t sreg = SREG;
+    cli();
+    x = acc_x;
+    y = acc_y;
+    v = acc_v;
+    h = acc_h;
+    buttons = acc_buttons | acc_pressed;
+    acc_pressed = 0;
+    SREG = sreg;
+
+    if (!x && !y && !v && !h && buttons == last_buttons)
+        return;
+    last_frame = timer_read();
+    last_buttons = buttons;
+
+    report_mouse_t report;
+    report.buttons = buttons;
+    report.x = take(x, MOUSE_XY_MAX);
+    report.y = take(y, MOUSE_XY_MAX);
+    // a unit of wheel is multiple when host enables Resolution Multiplier
+    report.v = take(v, 127 / host_mouse_wheel_res()) * host_mouse_wheel_res();
+    report.h = take(h, 127 / host_mouse_pan_res()) * host_mouse_pan_res();
+
+    // rest is carried over to next frame
+    sreg = SREG;
+    cli();
+    acc_x -= report.x;
+    acc_y -= report.y;
+    acc_v -= report.v / host_mouse_wheel_res();
+    acc_h -= report.h / host_mouse_pan_res();
+    SREG = sreg;
+
+    print_usb_data(&report);
+    host_mouse_send(&report);
+}
+
+static void print_usb_data(const report_mouse_t *report)
+{
+    if (!debug_mouse)
+        return;
+
+    xprintf("serial_mouse usb: [%02X|%d %d %d %d]\n",
+            report->buttons, report->x, report->y,
+            report->v, report->h);
+}
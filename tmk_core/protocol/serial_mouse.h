@@ -30,4 +30,13 @@ static inline uint8_t serial_mouse_init(void)
 
 void serial_mouse_task(void);
 
+/*
+ * Packet decoder of each protocol is fed in RX interrupt through
+ * SERIAL_RECV_HOOK and accumulates motion with serial_mouse_move(), which
+ * serial_mouse_task() sends as one report per USB frame.
+ */
+void serial_mouse_recv(uint8_t data);
+void serial_mouse_move(int16_t x, int16_t y, int16_t v, int16_t h);
+void serial_mouse_buttons(uint8_t buttons);
+
 #endif
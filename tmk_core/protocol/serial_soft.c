@@ -38,18 +38,34 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <stdbool.h>
 #include <avr/io.h>
 #include <avr/interrupt.h>
-#include <util/delay.h>
 #include "serial.h"
 
 /*
- *  Stupid Inefficient Busy-wait Software Serial
+ *  Software Serial
  *  which is still useful for negative logic signal like Sun protocol
  *  if it is not supported by hardware UART.
  *
- *  TODO: delay is not accurate enough. Instruction cycle should be counted and inline assemby is needed.
+ *  Timer1 runs free at F_CPU/8 and its compare matches time bits:
+ *  RX: edge interrupt of start bit schedules compare A at center of each
+ *      bit, so that bits are sampled at middle of cell. Bit time is
+ *      computed in timer ticks and doesn't accumulate error, the frame
+ *      tolerates about +-4% of baud rate difference.
+ *  TX: bytes are queued in TX buffer and compare B shifts out a frame bit
+ *      by bit, serial_send() doesn't wait for signal.
  */
 
-#define WAIT_US     (1000000L/SERIAL_SOFT_BAUD)
+#ifdef SLEEP_LED_ENABLE
+#   error "Software serial uses Timer1 which conflicts with SLEEP_LED_ENABLE"
+#endif
+
+#define BIT_TICKS   ((uint16_t)((F_CPU / 8 + SERIAL_SOFT_BAUD / 2) / SERIAL_SOFT_BAUD))
+
+#if (F_CPU / 8 / SERIAL_SOFT_BAUD) > 0xFFFF
+#   error "SERIAL_SOFT_BAUD is too low"
+#endif
+#if (F_CPU / 8 / SERIAL_SOFT_BAUD) < 40
+#   error "SERIAL_SOFT_BAUD is too high"
+#endif
 
 #ifdef SERIAL_SOFT_LOGIC_NEGATIVE
     #define SERIAL_SOFT_RXD_IN()        !(SERIAL_SOFT_RXD_READ())
@@ -67,6 +83,21 @@ POSSIBILITY OF SUCH DAMAGE.
     #define SERIAL_SOFT_PARITY_VAL      1
 #endif
 
+#ifdef SERIAL_SOFT_DATA_7BIT
+    #define DATA_BITS   7
+#else
+    #define DATA_BITS   8
+#endif
+
+#if defined(SERIAL_SOFT_PARITY_EVEN) || defined(SERIAL_SOFT_PARITY_ODD)
+    #define PARITY_BITS 1
+#else
+    #define PARITY_BITS 0
+#endif
+
+/* start + data + parity + stop */
+#define FRAME_BITS  (1 + DATA_BITS + PARITY_BITS + 1)
+
 /* debug for signal timing, see debug pin with oscilloscope */
 #ifdef SERIAL_SOFT_DEBUG
     #define SERIAL_SOFT_DEBUG_INIT()    (DDRD |= 1<<7)
@@ -77,21 +108,40 @@ POSSIBILITY OF SUCH DAMAGE.
 #endif
 
 
+/* RX ring buffer */
+#define RBUF_SIZE   8
+static uint8_t rbuf[RBUF_SIZE];
+static volatile uint8_t rbuf_head = 0;
+static volatile uint8_t rbuf_tail = 0;
+
+/* TX ring buffer */
+#define TBUF_SIZE   16
+static uint8_t tbuf[TBUF_SIZE];
+static volatile uint8_t tbuf_head = 0;
+static volatile uint8_t tbuf_tail = 0;
+
+static volatile uint8_t rx_bits = 0;    // bits left in receiving frame
+static uint8_t rx_data;
+static uint8_t rx_parity;
+
+static uint16_t tx_frame;               // bits of frame in sending order
+static uint8_t tx_bits = 0;             // bits left in sending frame
+static volatile bool tx_busy = false;
+
+
 void serial_init(void)
 {
     SERIAL_SOFT_DEBUG_INIT();
 
-    SERIAL_SOFT_RXD_INIT();
+    // Timer1: normal mode, clk/8
+    TCCR1A = 0;
+    TCCR1B = (1<<CS11);
+    TIMSK1 &= ~((1<<OCIE1A) | (1<<OCIE1B));
+
     SERIAL_SOFT_TXD_INIT();
+    SERIAL_SOFT_RXD_INIT();
 }
 
-/* RX ring buffer */
-#define RBUF_SIZE   8
-static uint8_t rbuf[RBUF_SIZE];
-static uint8_t rbuf_head = 0;
-static uint8_t rbuf_tail = 0;
-
-
 uint8_t serial_recv(void)
 {
     uint8_t data = 0;
@@ -116,124 +166,156 @@ int16_t serial_recv2(void)
     return data;
 }
 
-void serial_send(uint8_t data)
+bool serial_send(uint8_t data)
 {
-    /* signal state: IDLE: ON, START: OFF, STOP: ON, DATA0: OFF, DATA1: ON */
+    uint8_t next = (tbuf_head + 1) % TBUF_SIZE;
+    while (next == tbuf_tail) ;     // buffer full: wait for ISR
+    tbuf[tbuf_head] = data;
+    tbuf_head = next;
+
+    uint8_t sreg = SREG;
+    cli();
+    if (!tx_busy) {
+        tx_busy = true;
+        OCR1B = TCNT1 + 16;
+        TIFR1 = (1<<OCF1B);
+        TIMSK1 |= (1<<OCIE1B);
+    }
+    SREG = sreg;
+    return true;
+}
 
-#ifdef SERIAL_SOFT_BIT_ORDER_MSB
-    #ifdef SERIAL_SOFT_DATA_7BIT
-    uint8_t mask = 0x40;
-    #else
-    uint8_t mask = 0x80;
-    #endif
-#else
-    uint8_t mask = 0x01;
-#endif
+uint8_t serial_send_space(void)
+{
+    uint8_t head = tbuf_head;
+    uint8_t tail = tbuf_tail;
+    return (tail > head ? (tail - head) : (TBUF_SIZE - head + tail)) - 1;
+}
 
-    uint8_t parity = 0;
+void serial_send_task(void)
+{
+}
 
-    /* start bit */
-    SERIAL_SOFT_TXD_OFF();
-    _delay_us(WAIT_US);
+/* frame bits in sending order from LSB, '1' is ON */
+static uint16_t make_frame(uint8_t data)
+{
+    uint16_t frame = 0;     // start bit: OFF
+    uint16_t bit = (1<<1);
+    uint8_t parity = 0;
 
-#ifdef SERIAL_SOFT_DATA_7BIT
-    while (mask&0x7F) {
+#ifdef SERIAL_SOFT_BIT_ORDER_MSB
+    for (uint8_t mask = (1<<(DATA_BITS-1)); mask; mask >>= 1) {
 #else
-    while (mask&0xFF) {
+    for (uint8_t mask = 0x01; mask & ((1<<DATA_BITS)-1); mask <<= 1) {
 #endif
-        if (data&mask) {
-            SERIAL_SOFT_TXD_ON();
+        if (data & mask) {
+            frame |= bit;
             parity ^= 1;
-        } else {
-            SERIAL_SOFT_TXD_OFF();
         }
-        _delay_us(WAIT_US);
-
-#ifdef SERIAL_SOFT_BIT_ORDER_MSB
-        mask >>= 1;
-#else
-        mask <<= 1;
+        bit <<= 1;
+    }
+#if PARITY_BITS
+    if (parity != SERIAL_SOFT_PARITY_VAL) frame |= bit;
+    bit <<= 1;
 #endif
+    frame |= bit;           // stop bit: ON
+    return frame;
+}
+
+/* TX: places next bit */
+ISR(TIMER1_COMPB_vect)
+{
+    if (tx_bits == 0) {
+        if (tbuf_head == tbuf_tail) {
+            TIMSK1 &= ~(1<<OCIE1B);
+            tx_busy = false;
+            return;
+        }
+        tx_frame = make_frame(tbuf[tbuf_tail]);
+        tbuf_tail = (tbuf_tail + 1) % TBUF_SIZE;
+        tx_bits = FRAME_BITS;
     }
 
-#if defined(SERIAL_SOFT_PARITY_EVEN) || defined(SERIAL_SOFT_PARITY_ODD)
-    /* to center of parity bit */
-    if (parity != SERIAL_SOFT_PARITY_VAL) {
+    if (tx_frame & 1) {
         SERIAL_SOFT_TXD_ON();
     } else {
         SERIAL_SOFT_TXD_OFF();
     }
-    _delay_us(WAIT_US);
-#endif
-
-    /* stop bit */
-    SERIAL_SOFT_TXD_ON();
-    _delay_us(WAIT_US);
+    tx_frame >>= 1;
+    tx_bits--;
+    OCR1B += BIT_TICKS;
 }
 
-/* detect edge of start bit */
+/* RX: detect edge of start bit */
 ISR(SERIAL_SOFT_RXD_VECT)
 {
+    uint16_t t = TCNT1;
+
+    // edges in frame being received
+    if (rx_bits) return;
+
     SERIAL_SOFT_DEBUG_TGL();
     SERIAL_SOFT_RXD_INT_ENTER();
 
-    uint8_t data = 0;
-
-#ifdef SERIAL_SOFT_BIT_ORDER_MSB
-    #ifdef SERIAL_SOFT_DATA_7BIT
-    uint8_t mask = 0x40;
-    #else
-    uint8_t mask = 0x80;
-    #endif
-#else
-    uint8_t mask = 0x01;
-#endif
+    // to center of start bit
+    OCR1A = t + BIT_TICKS/2;
+    TIFR1 = (1<<OCF1A);
+    TIMSK1 |= (1<<OCIE1A);
+    rx_data = 0;
+    rx_parity = 0;
+    rx_bits = FRAME_BITS;
+}
 
-    uint8_t parity = 0;
+/* RX: samples bit at center of cell */
+ISR(TIMER1_COMPA_vect)
+{
+    bool in = SERIAL_SOFT_RXD_IN();
+    uint8_t pos = FRAME_BITS - rx_bits;     // 0: start bit
 
-    /* to center of start bit */
-    _delay_us(WAIT_US/2);
     SERIAL_SOFT_DEBUG_TGL();
-    do {
-        /* to center of next bit */
-        _delay_us(WAIT_US);
+    OCR1A += BIT_TICKS;
 
-    SERIAL_SOFT_DEBUG_TGL();
-        if (SERIAL_SOFT_RXD_IN()) {
-            data |= mask;
-            parity ^= 1;
-        }
+    if (pos == 0) {
+        // noise: start bit is not OFF at its center
+        if (in) goto FINISH;
+    } else if (pos <= DATA_BITS) {
+        if (in) {
 #ifdef SERIAL_SOFT_BIT_ORDER_MSB
-        mask >>= 1;
+            rx_data |= (1<<(DATA_BITS - pos));
 #else
-        mask <<= 1;
+            rx_data |= (1<<(pos - 1));
 #endif
-#ifdef SERIAL_SOFT_DATA_7BIT
-    } while (mask&0x7F);
-#else
-    } while (mask&0xFF);
+            rx_parity ^= 1;
+        }
+#if PARITY_BITS
+    } else if (pos == DATA_BITS + 1) {
+        if (in) rx_parity ^= 1;
 #endif
-
-#if defined(SERIAL_SOFT_PARITY_EVEN) || defined(SERIAL_SOFT_PARITY_ODD)
-    /* to center of parity bit */
-    _delay_us(WAIT_US);
-    if (SERIAL_SOFT_RXD_IN()) { parity ^= 1; }
-    SERIAL_SOFT_DEBUG_TGL();
+    } else {
+        // stop bit
+#if PARITY_BITS
+        if (in && rx_parity == SERIAL_SOFT_PARITY_VAL) {
+#else
+        if (in) {
 #endif
-
-    /* to center of stop bit */
-    _delay_us(WAIT_US);
-
-    uint8_t next = (rbuf_head + 1) % RBUF_SIZE;
-#if defined(SERIAL_SOFT_PARITY_EVEN) || defined(SERIAL_SOFT_PARITY_ODD)
-    if ((parity == SERIAL_SOFT_PARITY_VAL) && next != rbuf_tail) {
+#ifdef SERIAL_RECV_HOOK
+            SERIAL_RECV_HOOK(rx_data);
 #else
-    if (next != rbuf_tail) {
+            uint8_t next = (rbuf_head + 1) % RBUF_SIZE;
+            if (next != rbuf_tail) {
+                rbuf[rbuf_head] = rx_data;
+                rbuf_head = next;
+            }
 #endif
-        rbuf[rbuf_head] = data;
-        rbuf_head = next;
+        }
+        goto FINISH;
     }
+    rx_bits--;
+    return;
 
+FINISH:
+    TIMSK1 &= ~(1<<OCIE1A);
+    // discard edges of data bits latched in flag
     SERIAL_SOFT_RXD_INT_EXIT();
-    SERIAL_SOFT_DEBUG_TGL();
+    rx_bits = 0;
 }
@@ -94,19 +94,90 @@ int16_t serial_recv2(void)
     return data;
 }
 
-void serial_send(uint8_t data)
+#ifdef SERIAL_UART_TXD_VECT
+/*
+ * Buffered transmit
+ *     Data is queued in TX ring buffer and sent from UDRE interrupt. When
+ *     SERIAL_UART_CTS is defined transmit is held while it is false and
+ *     restarted by serial_send_task().
+ */
+#ifndef SERIAL_UART_CTS
+#   define SERIAL_UART_CTS  true
+#endif
+
+// TX ring buffer
+#define TBUF_SIZE   64
+static uint8_t tbuf[TBUF_SIZE];
+static volatile uint8_t tbuf_head = 0;
+static volatile uint8_t tbuf_tail = 0;
+
+bool serial_send(uint8_t data)
+{
+    uint8_t next = (tbuf_head + 1) % TBUF_SIZE;
+    while (next == tbuf_tail) {
+        // buffer full: never drains while receiver prohibits sending
+        if (!SERIAL_UART_CTS) return false;
+        SERIAL_UART_TXD_INT_ON();
+    }
+    tbuf[tbuf_head] = data;
+    tbuf_head = next;
+    SERIAL_UART_TXD_INT_ON();
+    return true;
+}
+
+uint8_t serial_send_space(void)
+{
+    uint8_t head = tbuf_head;
+    uint8_t tail = tbuf_tail;
+    return (tail > head ? (tail - head) : (TBUF_SIZE - head + tail)) - 1;
+}
+
+void serial_send_task(void)
+{
+    if (tbuf_head != tbuf_tail && SERIAL_UART_CTS) {
+        SERIAL_UART_TXD_INT_ON();
+    }
+}
+
+// USART data register empty interrupt
+ISR(SERIAL_UART_TXD_VECT)
+{
+    if (tbuf_head == tbuf_tail || !SERIAL_UART_CTS) {
+        SERIAL_UART_TXD_INT_OFF();
+        return;
+    }
+    SERIAL_UART_DATA = tbuf[tbuf_tail];
+    tbuf_tail = (tbuf_tail + 1) % TBUF_SIZE;
+}
+#else
+bool serial_send(uint8_t data)
 {
     while (!SERIAL_UART_TXD_READY) ;
     SERIAL_UART_DATA = data;
+    return true;
+}
+
+uint8_t serial_send_space(void)
+{
+    return SERIAL_UART_TXD_READY ? 1 : 0;
 }
 
+void serial_send_task(void)
+{
+}
+#endif
+
 // USART RX complete interrupt
 ISR(SERIAL_UART_RXD_VECT)
 {
+#ifdef SERIAL_RECV_HOOK
+    SERIAL_RECV_HOOK(SERIAL_UART_DATA);
+#else
     uint8_t next = (rbuf_head + 1) % RBUF_SIZE;
     if (next != rbuf_tail) {
         rbuf[rbuf_head] = SERIAL_UART_DATA;
         rbuf_head = next;
     }
     rbuf_check_rts_hi();
+#endif
 }
@@ -8,6 +8,7 @@ USB_HOST_SHIELD_DIR = $(USB_HID_DIR)/USB_Host_Shield_2.0
 USB_HOST_SHIELD_SRC = \
 	$(USB_HOST_SHIELD_DIR)/Usb.cpp \
 	$(USB_HOST_SHIELD_DIR)/hid.cpp \
+	$(USB_HOST_SHIELD_DIR)/hiduniversal.cpp \
 	$(USB_HOST_SHIELD_DIR)/usbhub.cpp \
 	$(USB_HOST_SHIELD_DIR)/parsetools.cpp \
 	$(USB_HOST_SHIELD_DIR)/message.cpp 
@@ -37,6 +38,7 @@ ARDUINO_CORES_SRC = \
 # HID parser
 #
 SRC += $(USB_HID_DIR)/parser.cpp
+SRC += $(USB_HID_DIR)/hid_plan.c
 
 # replace arduino/CDC.cpp
 SRC += $(USB_HID_DIR)/override_Serial.cpp
@@ -386,6 +386,10 @@ uint8_t USB::dispatchPkt(uint8_t token, uint8_t ep, uint16_t nak_limit) {
 
                 while((long)(millis() - timeout) < 0L) //wait for transfer completion
                 {
+                        // INT pin tells completion without reading register over SPI
+                        if(!intPending())
+                                continue;
+
                         tmpdata = regRd(rHIRQ);
 
                         if(tmpdata & bmHXFRDNIRQ) {
@@ -456,9 +460,22 @@ void USB::Task(void) //USB state machine
                         break;
         }// switch( tmpdata
 
-        for(uint8_t i = 0; i < USB_NUMDEVICES; i++)
-                if(devConfig[i])
-                        rcode = devConfig[i]->Poll();
+        // Devices are polled in turn from where last call stopped and polling
+        // is put off to next call when it runs over USB_POLL_BUDGET, so that
+        // slow device can't starve other devices or caller of Task().
+        {
+                static uint8_t next = 0;
+                unsigned long start = millis();
+
+                for(uint8_t n = 0; n < USB_NUMDEVICES; n++) {
+                        uint8_t i = next;
+                        next = (next + 1) % USB_NUMDEVICES;
+                        if(devConfig[i])
+                                rcode = devConfig[i]->Poll();
+                        if((millis() - start) >= USB_POLL_BUDGET)
+                                break;
+                }
+        }
 
         switch(usb_task_state) {
                 case USB_DETACHED_SUBSTATE_INITIALIZE:
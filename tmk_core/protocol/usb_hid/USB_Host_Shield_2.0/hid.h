@@ -138,6 +138,12 @@ class HID;
 class HIDReportParser {
 public:
         virtual void Parse(HID *hid, bool is_rpt_id, uint8_t len, uint8_t *buf) = 0;
+
+        // with index of interface the report comes from, for parser of
+        // multi-interface device whose report IDs are scoped per interface
+        virtual void ParseInterface(HID *hid, uint8_t iface, bool is_rpt_id, uint8_t len, uint8_t *buf) {
+                Parse(hid, is_rpt_id, len, buf);
+        };
 };
 
 class HID : public USBDeviceConfig, public UsbConfigXtracter {
@@ -205,9 +205,9 @@ class HIDBoot : public HID //public USBDeviceConfig, public UsbConfigXtracter
         uint8_t bIfaceNum; // Interface Number
         uint8_t bNumIface; // number of interfaces in the configuration
         uint8_t bNumEP; // total number of EP in the configuration
-        uint32_t qNextPollTime; // next poll time
+        uint32_t qNextPollTime[epMUL(BOOT_PROTOCOL)]; // next poll time of each endpoint
         bool bPollEnable; // poll enable flag
-        uint8_t bInterval; // largest interval
+        uint8_t bInterval[epMUL(BOOT_PROTOCOL)]; // poll interval of each endpoint
 
         void Initialize();
 
@@ -252,11 +252,11 @@ public:
 template <const uint8_t BOOT_PROTOCOL>
 HIDBoot<BOOT_PROTOCOL>::HIDBoot(USB *p) :
 HID(p),
-qNextPollTime(0),
 bPollEnable(false) {
         Initialize();
 
         for(int i = 0; i < epMUL(BOOT_PROTOCOL); i++) {
+                qNextPollTime[i] = 0;
                 pRptParser[i] = NULL;
         }
         if(pUsb)
@@ -299,7 +299,8 @@ uint8_t HIDBoot<BOOT_PROTOCOL>::Init(uint8_t parent, uint8_t port, bool lowspeed
         if(bAddress)
                 return USB_ERROR_CLASS_INSTANCE_ALREADY_IN_USE;
 
-        bInterval = 0;
+        for(int i = 0; i < epMUL(BOOT_PROTOCOL); i++)
+                bInterval[i] = 0;
         // Get pointer to pseudo device with address 0 assigned
         p = addrPool.GetUsbDevicePtr(0);
 
@@ -539,7 +540,8 @@ void HIDBoot<BOOT_PROTOCOL>::EndpointXtract(uint8_t conf, uint8_t iface, uint8_t
         bIfaceNum = iface;
 
         if((pep->bmAttributes & 0x03) == 3 && (pep->bEndpointAddress & 0x80) == 0x80) {
-                if(pep->bInterval > bInterval) bInterval = pep->bInterval;
+                // bInterval of full/low speed interrupt endpoint is in ms
+                bInterval[bNumEP - epInterruptInIndex] = (pep->bInterval) ? pep->bInterval : 1;
 
                 // Fill in the endpoint info structure
                 epInfo[bNumEP].epAddr = (pep->bEndpointAddress & 0x0F);
@@ -559,7 +561,8 @@ uint8_t HIDBoot<BOOT_PROTOCOL>::Release() {
         bIfaceNum = 0;
         bNumEP = 1;
         bAddress = 0;
-        qNextPollTime = 0;
+        for(int i = 0; i < epMUL(BOOT_PROTOCOL); i++)
+                qNextPollTime[i] = 0;
         bPollEnable = false;
 
         return 0;
@@ -569,10 +572,14 @@ template <const uint8_t BOOT_PROTOCOL>
 uint8_t HIDBoot<BOOT_PROTOCOL>::Poll() {
         uint8_t rcode = 0;
 
-        if(bPollEnable && ((long)(millis() - qNextPollTime) >= 0L)) {
+        if(bPollEnable) {
 
-                // To-do: optimize manually, using the for loop only if needed.
+                // each endpoint is polled on its own interval
                 for(int i = 0; i < epMUL(BOOT_PROTOCOL); i++) {
+                        if((long)(millis() - qNextPollTime[i]) < 0L)
+                                continue;
+                        qNextPollTime[i] = millis() + bInterval[i];
+
                         const uint16_t const_buff_len = 16;
                         uint8_t buf[const_buff_len];
 
@@ -610,7 +617,6 @@ uint8_t HIDBoot<BOOT_PROTOCOL>::Poll() {
                         }
 
                 }
-                qNextPollTime = millis() + bInterval;
         }
         return rcode;
 }
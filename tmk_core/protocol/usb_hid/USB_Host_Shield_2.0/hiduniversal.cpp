@@ -19,8 +19,6 @@ e-mail   :  support@circuitsathome.com
 
 HIDUniversal::HIDUniversal(USB *p) :
 HID(p),
-qNextPollTime(0),
-pollInterval(0),
 bPollEnable(false),
 bHasReportId(false) {
         Initialize();
@@ -61,11 +59,12 @@ void HIDUniversal::Initialize() {
                 epInfo[i].maxPktSize = (i) ? 0 : 8;
                 epInfo[i].epAttribs = 0;
                 epInfo[i].bmNakPower = (i) ? USB_NAK_NOWAIT : USB_NAK_MAX_POWER;
+                qNextPollTime[i] = 0;
+                pollInterval[i] = 0;
         }
         bNumEP = 1;
         bNumIface = 0;
         bConfNum = 0;
-        pollInterval = 0;
 
         ZeroMemory(constBuffLen, prevBuf);
 }
@@ -329,8 +328,9 @@ void HIDUniversal::EndpointXtract(uint8_t conf, uint8_t iface, uint8_t alt, uint
                 // Fill in the endpoint index list
                 piface->epIndex[index] = bNumEP; //(pep->bEndpointAddress & 0x0F);
 
-                if(pollInterval < pep->bInterval) // Set the polling interval as the largest polling interval obtained from endpoints
-                        pollInterval = pep->bInterval;
+                // bInterval of full/low speed interrupt endpoint is in ms
+                pollInterval[bNumEP] = (pep->bInterval) ? pep->bInterval : 1;
+                qNextPollTime[bNumEP] = 0;
 
                 bNumEP++;
         }
@@ -342,7 +342,8 @@ uint8_t HIDUniversal::Release() {
 
         bNumEP = 1;
         bAddress = 0;
-        qNextPollTime = 0;
+        for(uint8_t i = 0; i < totalEndpoints; i++)
+                qNextPollTime[i] = 0;
         bPollEnable = false;
         return 0;
 }
@@ -370,51 +371,52 @@ uint8_t HIDUniversal::Poll() {
         if(!bPollEnable)
                 return 0;
 
-        if((long)(millis() - qNextPollTime) >= 0L) {
-                qNextPollTime = millis() + pollInterval;
+        uint8_t buf[constBuffLen];
 
-                uint8_t buf[constBuffLen];
-
-                for(uint8_t i = 0; i < bNumIface; i++) {
-                        uint8_t index = hidInterfaces[i].epIndex[epInterruptInIndex];
-                        uint16_t read = (uint16_t)epInfo[index].maxPktSize;
-
-                        ZeroMemory(constBuffLen, buf);
+        // each endpoint is polled on its own interval, NAK or error
+        // of an interface doesn't keep others from being polled.
+        for(uint8_t i = 0; i < bNumIface; i++) {
+                uint8_t index = hidInterfaces[i].epIndex[epInterruptInIndex];
+                if(index == 0)
+                        continue;
+                if((long)(millis() - qNextPollTime[index]) < 0L)
+                        continue;
+                qNextPollTime[index] = millis() + pollInterval[index];
 
-                        uint8_t rcode = pUsb->inTransfer(bAddress, epInfo[index].epAddr, &read, buf);
+                uint16_t read = (uint16_t)epInfo[index].maxPktSize;
 
-                        if(rcode) {
-                                if(rcode != hrNAK)
-                                        USBTRACE3("(hiduniversal.h) Poll:", rcode, 0x81);
-                                return rcode;
-                        }
+                ZeroMemory(constBuffLen, buf);
 
-                        if(read > constBuffLen)
-                                read = constBuffLen;
+                rcode = pUsb->inTransfer(bAddress, epInfo[index].epAddr, &read, buf);
 
-                        bool identical = BuffersIdentical(read, buf, prevBuf);
+                if(rcode) {
+                        if(rcode != hrNAK)
+                                USBTRACE3("(hiduniversal.h) Poll:", rcode, 0x81);
+                        continue;
+                }
 
-                        SaveBuffer(read, buf, prevBuf);
+                if(read > constBuffLen)
+                        read = constBuffLen;
 
-                        if(identical)
-                                return 0;
+                // identical reports are not skipped: relative motion of
+                // pointer repeats same report while moving steadily
+                SaveBuffer(read, buf, prevBuf);
 #if 0
-                        Notify(PSTR("\r\nBuf: "), 0x80);
+                Notify(PSTR("\r\nBuf: "), 0x80);
 
-                        for(uint8_t i = 0; i < read; i++) {
-                                D_PrintHex<uint8_t > (buf[i], 0x80);
-                                Notify(PSTR(" "), 0x80);
-                        }
+                for(uint8_t i = 0; i < read; i++) {
+                        D_PrintHex<uint8_t > (buf[i], 0x80);
+                        Notify(PSTR(" "), 0x80);
+                }
 
-                        Notify(PSTR("\r\n"), 0x80);
+                Notify(PSTR("\r\n"), 0x80);
 #endif
-                        ParseHIDData(this, bHasReportId, (uint8_t)read, buf);
+                ParseHIDData(this, bHasReportId, (uint8_t)read, buf);
 
-                        HIDReportParser *prs = GetReportParser(((bHasReportId) ? *buf : 0));
+                HIDReportParser *prs = GetReportParser(((bHasReportId) ? *buf : 0));
 
-                        if(prs)
-                                prs->Parse(this, bHasReportId, (uint8_t)read, buf);
-                }
+                if(prs)
+                        prs->ParseInterface(this, i, bHasReportId, (uint8_t)read, buf);
         }
         return rcode;
 }
@@ -46,8 +46,8 @@ class HIDUniversal : public HID {
         uint8_t bConfNum; // configuration number
         uint8_t bNumIface; // number of interfaces in the configuration
         uint8_t bNumEP; // total number of EP in the configuration
-        uint32_t qNextPollTime; // next poll time
-        uint8_t pollInterval;
+        uint32_t qNextPollTime[totalEndpoints]; // next poll time of each endpoint
+        uint8_t pollInterval[totalEndpoints]; // poll interval of each endpoint
         bool bPollEnable; // poll enable flag
 
         static const uint16_t constBuffLen = 64; // event buffer length
@@ -128,6 +128,11 @@ public:
         uint8_t getVbusState(void) {
                 return vbusState;
         };
+
+        // INT pin is asserted(low) while enabled interrupt is pending
+        bool intPending(void) {
+                return (INTR::IsSet() == 0);
+        };
         void busprobe();
         uint8_t GpxHandler();
         uint8_t IntHandler();
@@ -384,7 +389,9 @@ int8_t MAX3421e< SPI_SS, INTR >::Init() {
 
         regWr(rMODE, bmDPPULLDN | bmDMPULLDN | bmHOST); // set pull-downs, Host
 
-        regWr(rHIEN, bmCONDETIE | bmFRAMEIE); //connection detection
+        // connection detection and transfer completion assert INT pin.
+        // FRAMEIRQ is not enabled, it would keep INT asserted every 1ms.
+        regWr(rHIEN, bmCONDETIE | bmHXFRDNIE);
 
         /* check if device is connected */
         regWr(rHCTL, bmSAMPLEBUS); // sample USB bus
@@ -425,7 +432,9 @@ int8_t MAX3421e< SPI_SS, INTR >::Init(int mseconds) {
 
         regWr(rMODE, bmDPPULLDN | bmDMPULLDN | bmHOST); // set pull-downs, Host
 
-        regWr(rHIEN, bmCONDETIE | bmFRAMEIE); //connection detection
+        // connection detection and transfer completion assert INT pin.
+        // FRAMEIRQ is not enabled, it would keep INT asserted every 1ms.
+        regWr(rHIEN, bmCONDETIE | bmHXFRDNIE);
 
         /* check if device is connected */
         regWr(rHCTL, bmSAMPLEBUS); // sample USB bus
@@ -509,6 +518,10 @@ uint8_t MAX3421e< SPI_SS, INTR >::IntHandler() {
                 busprobe();
                 HIRQ_sendback |= bmCONDETIRQ;
         }
+        // completion of timed out transfer, otherwise INT stays asserted
+        if(HIRQ & bmHXFRDNIRQ) {
+                HIRQ_sendback |= bmHXFRDNIRQ;
+        }
         /* End HIRQ interrupts handling, clear serviced IRQs    */
         regWr(rHIRQ, HIRQ_sendback);
         return ( HIRQ_sendback);
@@ -24,6 +24,7 @@ bAddress(0),
 bNbrPorts(0),
 //bInitState(0),
 qNextPollTime(0),
+bInterval(USB_HUB_POLL_INTERVAL),
 bPollEnable(false) {
         epInfo[0].epAddr = 0;
         epInfo[0].maxPktSize = 8;
@@ -158,6 +159,10 @@ uint8_t USBHub::Init(uint8_t parent, uint8_t port, bool lowspeed) {
         if(rcode)
                 goto FailGetConfDescr;
 
+        // Status change endpoint follows configuration and interface descriptor
+        if(cd_len >= 25 && buf[19] == USB_DESCRIPTOR_ENDPOINT && buf[24])
+                bInterval = (buf[24] < USB_HUB_POLL_INTERVAL) ? buf[24] : USB_HUB_POLL_INTERVAL;
+
         // The following code is of no practical use in real life applications.
         // It only intended for the usb protocol sniffer to properly parse hub-class requests.
         {
@@ -220,6 +225,7 @@ uint8_t USBHub::Release() {
         bAddress = 0;
         bNbrPorts = 0;
         qNextPollTime = 0;
+        bInterval = USB_HUB_POLL_INTERVAL;
         bPollEnable = false;
         return 0;
 }
@@ -232,7 +238,7 @@ uint8_t USBHub::Poll() {
 
         if(((long)(millis() - qNextPollTime) >= 0L)) {
                 rcode = CheckHubStatus();
-                qNextPollTime = millis() + 100;
+                qNextPollTime = millis() + bInterval;
         }
         return rcode;
 }
@@ -21,6 +21,8 @@ e-mail   :  support@circuitsathome.com
 
 #define USB_DESCRIPTOR_HUB                      0x09 // Hub descriptor type
 
+#define USB_HUB_POLL_INTERVAL                   100  // longest interval of status change polling in ms
+
 // Hub Requests
 #define bmREQ_CLEAR_HUB_FEATURE                 USB_SETUP_HOST_TO_DEVICE|USB_SETUP_TYPE_CLASS|USB_SETUP_RECIPIENT_DEVICE
 #define bmREQ_CLEAR_PORT_FEATURE                USB_SETUP_HOST_TO_DEVICE|USB_SETUP_TYPE_CLASS|USB_SETUP_RECIPIENT_OTHER
@@ -172,6 +174,7 @@ class USBHub : USBDeviceConfig {
         uint8_t bNbrPorts; // number of ports
         //        uint8_t bInitState; // initialization state variable
         uint32_t qNextPollTime; // next poll time
+        uint8_t bInterval; // status change endpoint interval
         bool bPollEnable; // poll enable flag
 
         uint8_t CheckHubStatus();
@@ -0,0 +1,579 @@
+/*
+Copyright 2016 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "hid_plan.h"
+#include "debug.h"
+
+
+#define USAGE_PAGE_DESKTOP  0x01
+#define USAGE_PAGE_KEYBOARD 0x07
+#define USAGE_PAGE_LED      0x08
+#define USAGE_PAGE_BUTTON   0x09
+#define USAGE_PAGE_CONSUMER 0x0C
+
+/* local items seen */
+#define HID_LOCAL_USAGE     (1<<0)
+#define HID_LOCAL_MIN       (1<<1)
+#define HID_LOCAL_MAX       (1<<2)
+
+/* Input item data, same bits in Output item */
+#define HID_INPUT_CONSTANT  (1<<0)
+#define HID_INPUT_VARIABLE  (1<<1)
+#define HID_INPUT_RELATIVE  (1<<2)
+
+
+void hid_plan_init(hid_plan_t *plan)
+{
+    memset(plan, 0, sizeof(hid_plan_t));
+}
+
+/* Boot protocol keyboard: mods, reserved, keys[6] and LEDs in Output */
+void hid_plan_boot(hid_plan_t *plan, uint8_t iface)
+{
+    // pointer plan of composite device is kept
+    plan->nreports = 1;
+    plan->report[0] = (hid_report_plan_t){
+        .iface = iface,
+        .id = 0,
+        .length = 8,
+        .nfields = 2,
+        .field = {
+            { .offset = 0,  .size = 1, .count = 8, .usage_min = 0xE0, .usage_max = 0xE7,
+              .logical_min = 0, .flags = 0 },
+            { .offset = 16, .size = 8, .count = 6, .usage_min = 0x00, .usage_max = 0xFF,
+              .logical_min = 0, .flags = HID_FIELD_ARRAY },
+        },
+    };
+    plan->led = (hid_led_plan_t){
+        .iface = iface,
+        .id = 0,
+        .length = 1,
+        .offset = 0,
+        .usage_min = 1,
+        .count = 5,
+    };
+}
+
+/* Boot protocol mouse: buttons, x, y */
+void hid_plan_boot_mouse(hid_plan_t *plan, uint8_t iface)
+{
+    plan->mouse = (hid_mouse_plan_t){
+        .iface = iface,
+        .id = 0,
+        .length = 3,
+        .button_offset = 0,
+        .nbuttons = 3,
+        .axis = {
+            [HID_AXIS_X] = { .offset = 8,  .size = 8 },
+            [HID_AXIS_Y] = { .offset = 16, .size = 8 },
+        },
+    };
+}
+
+void hid_plan_print(const hid_plan_t *plan)
+{
+    for (uint8_t i = 0; i < plan->nreports; i++) {
+        const hid_report_plan_t *r = &plan->report[i];
+        dprintf("plan: report if:%u id:%02X len:%u\n", r->iface, r->id, r->length);
+        for (uint8_t j = 0; j < r->nfields; j++) {
+            dprintf("  %s off:%u size:%u count:%u usage:%02X-%02X\n",
+                    (r->field[j].flags & HID_FIELD_ARRAY) ? "array " : "bitmap",
+                    r->field[j].offset, r->field[j].size, r->field[j].count,
+                    r->field[j].usage_min, r->field[j].usage_max);
+        }
+    }
+
+    const hid_mouse_plan_t *m = &plan->mouse;
+    if (m->length) {
+        dprintf("plan: mouse if:%u id:%02X len:%u btn:%u@%u", m->iface, m->id, m->length, m->nbuttons, m->button_offset);
+        for (uint8_t a = 0; a < HID_AXES; a++) {
+            dprintf(" %u:%u@%u", a, m->axis[a].size, m->axis[a].offset);
+        }
+        dprint("\n");
+    }
+
+    const hid_led_plan_t *l = &plan->led;
+    if (l->length) {
+        dprintf("plan: led if:%u id:%02X len:%u usage:%02X count:%u@%u\n",
+                l->iface, l->id, l->length, l->usage_min, l->count, l->offset);
+    }
+}
+
+
+/*
+ * Report descriptor parser
+ */
+void hid_desc_init(hid_desc_parser_t *p, hid_plan_t *plan, uint8_t iface)
+{
+    memset(p, 0, sizeof(hid_desc_parser_t));
+    p->plan = plan;
+    p->iface = iface;
+}
+
+static uint16_t *report_bits(hid_desc_offset_t *table, uint8_t *n, uint8_t id)
+{
+    for (uint8_t i = 0; i < *n; i++) {
+        if (table[i].id == id) return &table[i].bits;
+    }
+    if (*n >= HID_DESC_ID_MAX) return NULL;
+    table[*n].id = id;
+    table[*n].bits = 0;
+    return &table[(*n)++].bits;
+}
+
+static hid_report_plan_t *plan_report(hid_plan_t *plan, uint8_t iface, uint8_t id, bool create)
+{
+    for (uint8_t i = 0; i < plan->nreports; i++) {
+        if (plan->report[i].iface == iface && plan->report[i].id == id) return &plan->report[i];
+    }
+    if (!create || plan->nreports >= HID_PLAN_REPORTS) return NULL;
+    hid_report_plan_t *r = &plan->report[plan->nreports++];
+    r->iface = iface;
+    r->id = id;
+    r->length = 0;
+    r->nfields = 0;
+    return r;
+}
+
+static uint8_t clamp_usage(int32_t u)
+{
+    return (u > 0xFF) ? 0xFF : (u < 0 ? 0 : u);
+}
+
+static void add_field(hid_desc_parser_t *p, uint16_t offset, uint8_t flags)
+{
+    hid_desc_global_t *g = &p->global;
+    hid_report_plan_t *r = plan_report(p->plan, p->iface, g->report_id, true);
+    if (!r || r->nfields >= HID_PLAN_FIELDS) {
+        dprintf("plan: no room for id:%02X\n", g->report_id);
+        return;
+    }
+
+    hid_field_t *f = &r->field[r->nfields];
+    f->offset = offset;
+    f->size = g->report_size;
+    f->count = g->report_count;
+    if (p->local & HID_LOCAL_MIN) {
+        f->usage_min = p->usage_min;
+    } else if (p->local & HID_LOCAL_USAGE) {
+        f->usage_min = p->usage;
+    } else {
+        f->usage_min = 0;
+    }
+
+    if (flags & HID_INPUT_VARIABLE) {
+        // only bitmap of one bit per usage is supported
+        if (g->report_size != 1) return;
+        f->usage_max = clamp_usage(f->usage_min + g->report_count - 1);
+        f->logical_min = 0;
+        f->flags = 0;
+    } else {
+        int16_t lmin = g->logical_min;
+        int16_t lmax = g->logical_max;
+        if (g->report_size > 16 || lmin < 0 || lmin > 0xFF) return;
+        if (lmax < lmin) lmax &= 0xFF;  // e.g. Logical Maximum(255) in one byte
+        uint8_t umax = clamp_usage(f->usage_min + (lmax - lmin));
+        if ((p->local & HID_LOCAL_MAX) && p->usage_max < umax) {
+            umax = p->usage_max;
+        }
+        f->usage_max = umax;
+        f->logical_min = lmin;
+        f->flags = HID_FIELD_ARRAY;
+    }
+    r->nfields++;
+}
+
+static uint8_t usage_axis(uint16_t page, uint16_t usage)
+{
+    if (page == USAGE_PAGE_DESKTOP) {
+        if (usage == 0x30) return HID_AXIS_X;
+        if (usage == 0x31) return HID_AXIS_Y;
+        if (usage == 0x38) return HID_AXIS_WHEEL;
+    } else if (page == USAGE_PAGE_CONSUMER) {
+        if (usage == 0x238) return HID_AXIS_PAN;    // AC Pan
+    }
+    return HID_AXES;
+}
+
+static void mouse_field(hid_desc_parser_t *p, uint16_t offset, uint8_t flags)
+{
+    hid_desc_global_t *g = &p->global;
+    hid_mouse_plan_t *m = &p->plan->mouse;
+
+    if (!(flags & HID_INPUT_VARIABLE)) return;
+    // only first pointer report is used
+    if (m->length && (m->iface != p->iface || m->id != g->report_id)) return;
+
+    if (g->usage_page == USAGE_PAGE_BUTTON) {
+        if (g->report_size != 1 || m->nbuttons) return;
+        m->button_offset = offset;
+        m->nbuttons = (g->report_count > HID_MOUSE_BUTTONS) ? HID_MOUSE_BUTTONS : g->report_count;
+    } else {
+        if (!(flags & HID_INPUT_RELATIVE) || g->report_size > 16) return;
+        bool found = false;
+        for (uint8_t i = 0; i < g->report_count; i++) {
+            uint8_t a;
+            // last usage applies to rest of elements
+            if (p->naxes) {
+                a = p->axes[(i < p->naxes) ? i : p->naxes - 1];
+            } else if (p->local & HID_LOCAL_MIN) {
+                a = usage_axis(g->usage_page, p->usage_min + i);
+            } else {
+                a = HID_AXES;
+            }
+            if (a == HID_AXES || m->axis[a].size) continue;
+            m->axis[a].offset = offset + (uint16_t)i * g->report_size;
+            m->axis[a].size = g->report_size;
+            found = true;
+        }
+        if (!found) return;
+    }
+    m->iface = p->iface;
+    m->id = g->report_id;
+    if (!m->length) m->length = 1;     // fixed up by input_item()
+}
+
+static void input_item(hid_desc_parser_t *p, uint8_t flags)
+{
+    hid_desc_global_t *g = &p->global;
+    uint16_t *bits = report_bits(p->input, &p->ninputs, g->report_id);
+    if (!bits) return;
+
+    uint16_t offset = *bits;
+    *bits += (uint16_t)g->report_size * g->report_count;
+
+    if (!(flags & HID_INPUT_CONSTANT) && g->report_size && g->report_count) {
+        if (g->usage_page == USAGE_PAGE_KEYBOARD) {
+            add_field(p, offset, flags);
+        } else {
+            mouse_field(p, offset, flags);
+        }
+    }
+
+    // Input items following keyboard fields still make report longer
+    uint8_t length = (*bits + 7) / 8 + (g->report_id ? 1 : 0);
+    hid_report_plan_t *r = plan_report(p->plan, p->iface, g->report_id, false);
+    if (r) {
+        r->length = length;
+    }
+    hid_mouse_plan_t *m = &p->plan->mouse;
+    if (m->length && m->iface == p->iface && m->id == g->report_id) {
+        m->length = length;
+    }
+}
+
+static void output_item(hid_desc_parser_t *p, uint8_t flags)
+{
+    hid_desc_global_t *g = &p->global;
+    uint16_t *bits = report_bits(p->output, &p->noutputs, g->report_id);
+    if (!bits) return;
+
+    uint16_t offset = *bits;
+    *bits += (uint16_t)g->report_size * g->report_count;
+
+    hid_led_plan_t *l = &p->plan->led;
+    // only first LED report is used, LEDs are one bit each
+    if (!l->length && g->usage_page == USAGE_PAGE_LED && g->report_size == 1 && g->report_count &&
+            !(flags & HID_INPUT_CONSTANT) && (flags & HID_INPUT_VARIABLE) &&
+            (p->local & (HID_LOCAL_MIN | HID_LOCAL_USAGE))) {
+        l->iface = p->iface;
+        l->id = g->report_id;
+        l->offset = offset;
+        l->usage_min = (p->local & HID_LOCAL_MIN) ? p->usage_min : p->usage;
+        l->count = (g->report_count > 8) ? 8 : g->report_count;
+        l->length = 1;      // fixed up below
+    }
+
+    // Output items following LEDs still make report longer
+    if (l->length && l->iface == p->iface && l->id == g->report_id) {
+        l->length = (*bits + 7) / 8 + (g->report_id ? 1 : 0);
+    }
+}
+
+static void item(hid_desc_parser_t *p)
+{
+    uint32_t d = p->data;
+    int32_t s = d;
+    // sign extension
+    if (p->nbytes == 1)      s = (int8_t)d;
+    else if (p->nbytes == 2) s = (int16_t)d;
+
+    switch (p->prefix & 0xFC) {
+        /* Main */
+        case 0x80:  // Input
+        case 0x90:  // Output
+            if ((p->prefix & 0xFC) == 0x80) {
+                input_item(p, d);
+            } else {
+                output_item(p, d);
+            }
+            // fall through
+        case 0xB0:  // Feature
+        case 0xA0:  // Collection
+        case 0xC0:  // End Collection
+            p->local = 0;
+            p->naxes = 0;
+            break;
+
+        /* Global */
+        case 0x04:  // Usage Page
+            p->global.usage_page = (d > 0xFF) ? 0 : d;
+            break;
+        case 0x14:  // Logical Minimum
+            p->global.logical_min = (s < INT16_MIN) ? INT16_MIN : (s > INT16_MAX ? INT16_MAX : s);
+            break;
+        case 0x24:  // Logical Maximum
+            p->global.logical_max = (s < INT16_MIN) ? INT16_MIN : (s > INT16_MAX ? INT16_MAX : s);
+            break;
+        case 0x74:  // Report Size
+            p->global.report_size = (d > 0xFF) ? 0xFF : d;
+            break;
+        case 0x84:  // Report ID
+            p->global.report_id = d;
+            break;
+        case 0x94:  // Report Count
+            p->global.report_count = (d > 0xFF) ? 0xFF : d;
+            break;
+        case 0xA4:  // Push
+            if (p->sp < HID_DESC_STACK) p->stack[p->sp++] = p->global;
+            break;
+        case 0xB4:  // Pop
+            if (p->sp) p->global = p->stack[--p->sp];
+            break;
+
+        /* Local */
+        case 0x08:  // Usage
+            if (p->naxes < HID_DESC_USAGES) {
+                uint16_t page = (p->nbytes == 4) ? (d >> 16) : p->global.usage_page;
+                p->axes[p->naxes++] = usage_axis(page, d & 0xFFFF);
+            }
+            // extended usage with other page
+            if (p->nbytes == 4 && (d >> 16) != USAGE_PAGE_KEYBOARD) break;
+            if (!(p->local & HID_LOCAL_USAGE)) {
+                p->usage = clamp_usage(d & 0xFFFF);
+                p->local |= HID_LOCAL_USAGE;
+            }
+            break;
+        case 0x18:  // Usage Minimum
+            p->usage_min = clamp_usage(d & 0xFFFF);
+            p->local |= HID_LOCAL_MIN;
+            break;
+        case 0x28:  // Usage Maximum
+            p->usage_max = clamp_usage(d & 0xFFFF);
+            p->local |= HID_LOCAL_MAX;
+            break;
+        default:
+            break;
+    }
+}
+
+#define LONG_ITEM           0xFE
+#define LONG_ITEM_SIZE      0xFFFF
+
+void hid_desc_feed(hid_desc_parser_t *p, uint8_t c)
+{
+    if (p->remain == 0) {
+        p->prefix = c;
+        p->data = 0;
+        p->nbytes = 0;
+        if (c == LONG_ITEM) {
+            p->remain = LONG_ITEM_SIZE;
+            return;
+        }
+        p->remain = ((c & 3) == 3) ? 4 : (c & 3);
+        if (p->remain == 0) item(p);
+        return;
+    }
+
+    if (p->prefix == LONG_ITEM) {
+        // skip data and tag of long item
+        if (p->remain == LONG_ITEM_SIZE) {
+            p->remain = c + 1;
+        } else {
+            p->remain--;
+        }
+        return;
+    }
+
+    p->data |= (uint32_t)c << (8 * p->nbytes++);
+    if (--p->remain == 0) item(p);
+}
+
+
+/*
+ * Report decoder
+ */
+static uint16_t get_bits(const uint8_t *buf, uint8_t len, uint16_t offset, uint8_t size)
+{
+    if (size == 8 && !(offset & 7)) {
+        return ((offset >> 3) < len) ? buf[offset >> 3] : 0;
+    }
+
+    uint16_t v = 0;
+    for (uint8_t i = 0; i < size; i++, offset++) {
+        if ((offset >> 3) >= len) break;
+        if (buf[offset >> 3] & (1 << (offset & 7))) v |= (1 << i);
+    }
+    return v;
+}
+
+/* pointer report comes from the interface */
+static bool mouse_on(const hid_plan_t *plan, uint8_t iface)
+{
+    return plan->mouse.length && plan->mouse.iface == iface;
+}
+
+static const hid_report_plan_t *match_report(const hid_plan_t *plan, uint8_t iface,
+                                             const uint8_t *buf, uint8_t len, int8_t *index)
+{
+    int8_t found = HID_PLAN_NOMATCH;
+    for (uint8_t i = 0; i < plan->nreports; i++) {
+        const hid_report_plan_t *r = &plan->report[i];
+        if (r->iface != iface) continue;
+        if (r->id) {
+            // interface with IDs sends every report with ID
+            if (len && buf[0] == r->id && len >= r->length) {
+                found = i;
+                break;
+            }
+        } else {
+            // interface without ID has only this report, besides pointer
+            // report of composite device told by length
+            if (len == r->length || (!mouse_on(plan, iface) && len > r->length)) {
+                found = i;
+            }
+            break;
+        }
+    }
+    *index = found;
+    return (found < 0) ? NULL : &plan->report[found];
+}
+
+int8_t hid_plan_decode(const hid_plan_t *plan, uint8_t iface, const uint8_t *buf, uint8_t len,
+                       uint8_t bits[HID_PLAN_BITS_SIZE])
+{
+    int8_t index;
+    const hid_report_plan_t *r = match_report(plan, iface, buf, len, &index);
+    if (!r) return HID_PLAN_NOMATCH;
+
+    if (r->id) {
+        buf++;
+        len--;
+    }
+
+    memset(bits, 0, HID_PLAN_BITS_SIZE);
+    for (uint8_t i = 0; i < r->nfields; i++) {
+        const hid_field_t *f = &r->field[i];
+        uint16_t offset = f->offset;
+        uint8_t usage = f->usage_min;
+
+        if (!(f->flags & HID_FIELD_ARRAY)) {
+            uint8_t n = f->count;
+            // byte aligned bitmap is copied
+            while (n >= 8 && !(offset & 7) && !(usage & 7) && (uint16_t)usage + 7 <= f->usage_max) {
+                if ((offset >> 3) >= len) break;
+                bits[usage >> 3] |= buf[offset >> 3];
+                offset += 8;
+                n -= 8;
+                if (usage == 0xF8) { n = 0; break; }
+                usage += 8;
+            }
+            for (; n && usage <= f->usage_max; n--, offset++) {
+                if (get_bits(buf, len, offset, 1)) {
+                    bits[usage >> 3] |= (1 << (usage & 7));
+                }
+                if (usage == 0xFF) break;
+                usage++;
+            }
+        } else {
+            for (uint8_t n = 0; n < f->count; n++, offset += f->size) {
+                uint16_t v = get_bits(buf, len, offset, f->size);
+                if (v < f->logical_min) continue;
+                v -= f->logical_min;
+                if (v > (uint16_t)(f->usage_max - f->usage_min)) continue;
+                uint8_t u = f->usage_min + v;
+                if (u == 0) continue;               // no event
+                if (u <= 3) return HID_PLAN_ERROR;  // ErrorRollOver, POSTFail, ErrorUndefined
+                bits[u >> 3] |= (1 << (u & 7));
+            }
+        }
+    }
+    // 00-03 are not keys
+    bits[0] &= 0xF0;
+    return index;
+}
+
+/* keyboard report comes from the interface */
+static bool keyboard_on(const hid_plan_t *plan, uint8_t iface)
+{
+    for (uint8_t i = 0; i < plan->nreports; i++) {
+        if (plan->report[i].iface == iface) return true;
+    }
+    return false;
+}
+
+int8_t hid_plan_decode_mouse(const hid_plan_t *plan, uint8_t iface, const uint8_t *buf, uint8_t len,
+                             hid_mouse_t *mouse)
+{
+    const hid_mouse_plan_t *m = &plan->mouse;
+    if (!mouse_on(plan, iface)) return HID_PLAN_NOMATCH;
+
+    if (m->id) {
+        if (!len || buf[0] != m->id || len < m->length) return HID_PLAN_NOMATCH;
+        buf++;
+        len--;
+    } else if (len != m->length && (keyboard_on(plan, iface) || len < m->length)) {
+        return HID_PLAN_NOMATCH;
+    }
+
+    mouse->buttons = get_bits(buf, len, m->button_offset, m->nbuttons);
+    for (uint8_t a = 0; a < HID_AXES; a++) {
+        uint8_t size = m->axis[a].size;
+        if (!size) {
+            mouse->axis[a] = 0;
+            continue;
+        }
+        uint16_t v = get_bits(buf, len, m->axis[a].offset, size);
+        // sign extension
+        if (size < 16 && (v & (1U << (size - 1)))) {
+            v |= (uint16_t)(0xFFFF << size);
+        }
+        mouse->axis[a] = (int16_t)v;
+    }
+    return 0;
+}
+
+uint8_t hid_plan_leds(const hid_plan_t *plan, uint8_t leds, uint8_t *buf, uint8_t size)
+{
+    const hid_led_plan_t *l = &plan->led;
+    if (!l->length || l->length > size) return 0;
+
+    memset(buf, 0, l->length);
+    uint8_t *report = buf;
+    if (l->id) *report++ = l->id;
+    for (uint8_t i = 0; i < l->count; i++) {
+        // LED usage 1-8 is bit 0-7 of host state
+        uint8_t u = l->usage_min + i;
+        if (u == 0 || u > 8 || !(leds & (1 << (u - 1)))) continue;
+        uint16_t offset = l->offset + i;
+        report[offset >> 3] |= (1 << (offset & 7));
+    }
+    return l->length;
+}
@@ -0,0 +1,199 @@
+/*
+Copyright 2016 Jun Wako <wakojun@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HID_PLAN_H
+#define HID_PLAN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+ * Keyboard report extraction plan
+ *
+ * HID report descriptor is parsed once at enumeration and Input items of
+ * Keyboard/Keypad page are recorded as fields of the plan:
+ *   bitmap - one bit per usage(NKRO bitmap and modifiers)
+ *   array  - indexes of usage in each element(6KRO keys)
+ * A report is decoded into key bitmap with 256 bits indexed by usage,
+ * modifiers are at E0-E7 there.
+ *
+ * Buttons and relative axes of a pointer report(mouse, trackball or
+ * pointer of composite device) are recorded in the same pass, and so is
+ * place of LEDs in Output report, which can have its own report ID.
+ *
+ * Report IDs are scoped per interface, so reports are recorded with index
+ * of interface whose descriptor they come from and a report received on an
+ * interface is matched only with reports of the interface.
+ */
+
+#ifndef HID_PLAN_REPORTS
+#define HID_PLAN_REPORTS    2
+#endif
+#ifndef HID_PLAN_FIELDS
+#define HID_PLAN_FIELDS     4
+#endif
+
+#define HID_PLAN_BITS_SIZE  32
+
+/* field flags */
+#define HID_FIELD_ARRAY     (1<<0)
+
+typedef struct {
+    uint16_t offset;        // bit offset in report, after report ID
+    uint8_t  size;          // bits of an element
+    uint8_t  count;         // number of elements
+    uint8_t  usage_min;
+    uint8_t  usage_max;
+    uint8_t  logical_min;   // array: value of usage_min
+    uint8_t  flags;
+} hid_field_t;
+
+typedef struct {
+    uint8_t iface;          // index of interface
+    uint8_t id;             // report ID, 0: not used
+    uint8_t length;         // bytes of Input report including ID
+    uint8_t nfields;
+    hid_field_t field[HID_PLAN_FIELDS];
+} hid_report_plan_t;
+
+/* pointer axes */
+enum {
+    HID_AXIS_X = 0,
+    HID_AXIS_Y,
+    HID_AXIS_WHEEL,
+    HID_AXIS_PAN,
+    HID_AXES
+};
+
+#define HID_MOUSE_BUTTONS   8
+
+typedef struct {
+    uint16_t offset;
+    uint8_t  size;          // 0: not in report
+} hid_axis_t;
+
+typedef struct {
+    uint8_t iface;
+    uint8_t id;
+    uint8_t length;         // 0: no pointer report
+    uint16_t button_offset;
+    uint8_t nbuttons;
+    hid_axis_t axis[HID_AXES];
+} hid_mouse_plan_t;
+
+/* LED Output report */
+typedef struct {
+    uint8_t iface;
+    uint8_t id;
+    uint8_t length;         // bytes of Output report including ID, 0: no LED
+    uint16_t offset;        // bit offset of first LED, after report ID
+    uint8_t usage_min;      // usage of first LED, 1: Num Lock
+    uint8_t count;
+} hid_led_plan_t;
+
+typedef struct {
+    uint8_t nreports;
+    hid_report_plan_t report[HID_PLAN_REPORTS];
+    hid_mouse_plan_t mouse;
+    hid_led_plan_t led;
+} hid_plan_t;
+
+/* decoded pointer report */
+typedef struct {
+    uint8_t buttons;
+    int16_t axis[HID_AXES];
+} hid_mouse_t;
+
+
+/* report descriptor parser, fed byte by byte */
+#define HID_DESC_ID_MAX     8
+#define HID_DESC_STACK      2
+#define HID_DESC_USAGES     4
+
+typedef struct {
+    uint8_t usage_page;
+    uint8_t report_size;
+    uint8_t report_count;
+    uint8_t report_id;
+    int16_t logical_min;
+    int16_t logical_max;
+} hid_desc_global_t;
+
+/* bits of report with the ID so far */
+typedef struct {
+    uint8_t id;
+    uint16_t bits;
+} hid_desc_offset_t;
+
+typedef struct {
+    hid_plan_t *plan;
+    uint8_t iface;
+    uint8_t prefix;
+    uint16_t remain;        // data bytes of current item left
+    uint8_t nbytes;
+    uint32_t data;
+    hid_desc_global_t global;
+    hid_desc_global_t stack[HID_DESC_STACK];
+    uint8_t sp;
+    /* local items */
+    uint8_t usage;
+    uint8_t usage_min;
+    uint8_t usage_max;
+    uint8_t local;          // HID_LOCAL_* set since last main item
+    uint8_t axes[HID_DESC_USAGES];  // HID_AXIS_* of usages, HID_AXES: other
+    uint8_t naxes;
+    /* bit offsets of Input and Output reports */
+    uint8_t ninputs;
+    hid_desc_offset_t input[HID_DESC_ID_MAX];
+    uint8_t noutputs;
+    hid_desc_offset_t output[HID_DESC_ID_MAX];
+} hid_desc_parser_t;
+
+
+/* hid_plan_decode() */
+#define HID_PLAN_NOMATCH    -1      // not keyboard report
+#define HID_PLAN_ERROR      -2      // ErrorRollOver, keep last state
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void hid_plan_init(hid_plan_t *plan);
+void hid_plan_boot(hid_plan_t *plan, uint8_t iface);
+void hid_plan_boot_mouse(hid_plan_t *plan, uint8_t iface);
+void hid_plan_print(const hid_plan_t *plan);
+
+/* descriptor of interface iface is fed into plan */
+void hid_desc_init(hid_desc_parser_t *p, hid_plan_t *plan, uint8_t iface);
+void hid_desc_feed(hid_desc_parser_t *p, uint8_t c);
+
+/* returns index of report plan, bits are filled with keys on */
+int8_t hid_plan_decode(const hid_plan_t *plan, uint8_t iface, const uint8_t *buf, uint8_t len,
+                       uint8_t bits[HID_PLAN_BITS_SIZE]);
+/* returns 0 when pointer report is decoded into mouse */
+int8_t hid_plan_decode_mouse(const hid_plan_t *plan, uint8_t iface, const uint8_t *buf, uint8_t len,
+                             hid_mouse_t *mouse);
+/* LED Output report from host LED state(bit 0: Num Lock) including report ID,
+ * returns its length or 0 when no LED report or it is longer than size */
+uint8_t hid_plan_leds(const hid_plan_t *plan, uint8_t leds, uint8_t *buf, uint8_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
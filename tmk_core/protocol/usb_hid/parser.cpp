@@ -4,30 +4,224 @@
 #include "debug.h"
 
 
-report_keyboard_t usb_hid_keyboard_report;
+#ifndef USB_HID_DESC_MAX
+#define USB_HID_DESC_MAX    1024
+#endif
+
+
+uint8_t usb_hid_keyboard_bits[HID_PLAN_BITS_SIZE];
 uint16_t usb_hid_time_stamp;
+usb_hid_mouse_t usb_hid_mouse;
+
+KBDReportParser *KBDReportParser::parsers[USB_HID_MAX_KEYBOARDS];
+uint8_t KBDReportParser::nparsers = 0;
 
 
+KBDReportParser::KBDReportParser() : time_stamp(0), mouse_buttons(0)
+{
+    hid_plan_init(&plan);
+    hid_plan_boot(&plan, 0);
+    ::memset(report_bits, 0, sizeof(report_bits));
+    if (nparsers < USB_HID_MAX_KEYBOARDS) {
+        parsers[nparsers++] = this;
+    }
+}
+
 void KBDReportParser::Parse(HID *hid, bool is_rpt_id, uint8_t len, uint8_t *buf)
 {
-    bool is_error = false;
-    report_keyboard_t *report = (report_keyboard_t *)buf;
+    ParseInterface(hid, 0, is_rpt_id, len, buf);
+}
 
-    dprintf("keyboard input:  %02X %02X", report->mods, report->reserved);
-    for (uint8_t i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
-        if (IS_ERROR(report->keys[i])) {
-            is_error = true;
-        }
-        dprintf(" %02X", report->keys[i]);
+void KBDReportParser::ParseInterface(HID *hid, uint8_t iface, bool is_rpt_id, uint8_t len, uint8_t *buf)
+{
+    uint8_t bits[HID_PLAN_BITS_SIZE];
+
+    dprintf("input[%02X:%u]:", hid->GetAddress(), iface);
+    for (uint8_t i = 0; i < len; i++) {
+        dprintf(" %02X", buf[i]);
     }
     dprint("\r\n");
 
+    int8_t index = hid_plan_decode(&plan, iface, buf, len, bits);
+    if (index == HID_PLAN_NOMATCH) {
+        ParseMouse(iface, len, buf);
+        return;
+    }
     // ignore error and not send report to computer
-    if (is_error) {
+    if (index == HID_PLAN_ERROR) {
         dprint("Error usage! \r\n");
         return;
     }
 
-    ::memcpy(&usb_hid_keyboard_report, buf, sizeof(report_keyboard_t));
+    // same keys are reported again by some keyboards
+    if (::memcmp(report_bits[index], bits, HID_PLAN_BITS_SIZE) == 0) {
+        return;
+    }
+    ::memcpy(report_bits[index], bits, HID_PLAN_BITS_SIZE);
+    time_stamp = millis();
+    Merge();
+}
+
+static void accumulate(int16_t *acc, int16_t delta)
+{
+    // saturate instead of wrapping around
+    int32_t sum = (int32_t)*acc + delta;
+    *acc = (sum > 32767) ? 32767 : (sum < -32768 ? -32768 : sum);
+}
+
+void KBDReportParser::ParseMouse(uint8_t iface, uint8_t len, uint8_t *buf)
+{
+    hid_mouse_t mouse;
+    if (hid_plan_decode_mouse(&plan, iface, buf, len, &mouse) == HID_PLAN_NOMATCH) {
+        return;
+    }
+
+    accumulate(&usb_hid_mouse.x, mouse.axis[HID_AXIS_X]);
+    accumulate(&usb_hid_mouse.y, mouse.axis[HID_AXIS_Y]);
+    accumulate(&usb_hid_mouse.v, mouse.axis[HID_AXIS_WHEEL]);
+    accumulate(&usb_hid_mouse.h, mouse.axis[HID_AXIS_PAN]);
+
+    if (mouse.buttons != mouse_buttons) {
+        mouse_buttons = mouse.buttons;
+        time_stamp = millis();
+        Merge();
+    }
+}
+
+void KBDReportParser::Clear()
+{
+    ::memset(report_bits, 0, sizeof(report_bits));
+    mouse_buttons = 0;
+    time_stamp = millis();
+    Merge();
+}
+
+/* union of keys of all devices */
+void KBDReportParser::Merge()
+{
+    for (uint8_t i = 0; i < HID_PLAN_BITS_SIZE; i++) {
+        uint8_t b = 0;
+        for (uint8_t p = 0; p < nparsers; p++) {
+            for (uint8_t r = 0; r < HID_PLAN_REPORTS; r++) {
+                b |= parsers[p]->report_bits[r][i];
+            }
+            if (i == USB_HID_MOUSE_BUTTON / 8) {
+                b |= parsers[p]->mouse_buttons;
+            }
+        }
+        usb_hid_keyboard_bits[i] = b;
+    }
     usb_hid_time_stamp = millis();
 }
+
+
+void KBDReportDescParser::Parse(const uint16_t len, const uint8_t *pbuf, const uint16_t &offset)
+{
+    for (uint16_t i = 0; i < len; i++) {
+        hid_desc_feed(&desc, pbuf[i]);
+    }
+}
+
+
+HIDReportKeyboard::HIDReportKeyboard(USB *p) : HIDUniversal(p), kbdIface(0), mouseIface(0),
+        leds(0), ledsPending(false)
+{
+    SetReportParser(0, &parser);
+}
+
+uint8_t HIDReportKeyboard::OnInitSuccessful()
+{
+    bool boot_kbd = false;
+    bool boot_mouse = false;
+    uint8_t kbd_index = 0;      // index of interface in hidInterfaces
+    uint8_t mouse_index = 0;
+
+    parser.Clear();
+    hid_plan_init(&parser.plan);
+
+    for (uint8_t i = 0; i < maxHidInterfaces; i++) {
+        if (hidInterfaces[i].epIndex[epInterruptInIndex] == 0)
+            continue;
+
+        uint8_t iface = hidInterfaces[i].bmInterface;
+        uint8_t nreports = parser.plan.nreports;
+        if (hidInterfaces[i].bmProtocol == HID_PROTOCOL_KEYBOARD && !boot_kbd) {
+            boot_kbd = true;
+            kbdIface = iface;
+            kbd_index = i;
+        }
+        if (hidInterfaces[i].bmProtocol == HID_PROTOCOL_MOUSE && !boot_mouse) {
+            boot_mouse = true;
+            mouseIface = iface;
+            mouse_index = i;
+        }
+
+        // boot interface may be left in boot protocol by previous host
+        SetProtocol(iface, HID_RPT_PROTOCOL);
+
+        // HID::GetReportDescr() reads only first 128 bytes
+        uint8_t buf[64];
+        KBDReportDescParser desc(&parser.plan, i);
+        uint8_t rcode = pUsb->ctrlReq(bAddress, 0x00, bmREQ_HID_REPORT, USB_REQUEST_GET_DESCRIPTOR, 0x00,
+                HID_DESCRIPTOR_REPORT, iface, USB_HID_DESC_MAX, sizeof(buf), buf, &desc);
+        if (rcode) {
+            dprintf("report desc: iface:%d error:%02X\n", iface, rcode);
+        }
+        if (!nreports && parser.plan.nreports) {
+            kbdIface = iface;
+        }
+    }
+
+    if (parser.plan.nreports == 0 && boot_kbd) {
+        dprint("report desc: no keyboard report, use boot protocol\n");
+        SetProtocol(kbdIface, HID_BOOT_PROTOCOL);
+        hid_plan_boot(&parser.plan, kbd_index);
+    }
+    if (parser.plan.mouse.length == 0 && boot_mouse) {
+        dprint("report desc: no pointer report, use boot protocol\n");
+        SetProtocol(mouseIface, HID_BOOT_PROTOCOL);
+        hid_plan_boot_mouse(&parser.plan, mouse_index);
+    }
+    dprintf("keyboard[%02X]: iface:%d\n", bAddress, kbdIface);
+    hid_plan_print(&parser.plan);
+
+    // LED state set before attached
+    ledsPending = true;
+    return 0;
+}
+
+/* keys of detached keyboard are released */
+uint8_t HIDReportKeyboard::Release()
+{
+    parser.Clear();
+    return HIDUniversal::Release();
+}
+
+uint8_t HIDReportKeyboard::Poll()
+{
+    uint8_t rcode = HIDUniversal::Poll();
+
+    // no LED on mouse
+    const hid_led_plan_t *l = &parser.plan.led;
+    if (ledsPending && isReady() && l->length) {
+        ledsPending = false;
+        uint8_t data[8];
+        uint8_t len = hid_plan_leds(&parser.plan, leds, data, sizeof(data));
+        if (!len) {
+            dprintf("led[%02X]: report too long:%u\n", bAddress, l->length);
+            return rcode;
+        }
+        uint8_t rc = SetReport(0, hidInterfaces[l->iface].bmInterface, 2, l->id, len, data);
+        if (rc) {
+            dprintf("led[%02X]: error:%02X\n", bAddress, rc);
+        }
+    }
+    return rcode;
+}
+
+/* supersedes state not sent yet */
+void HIDReportKeyboard::SetLeds(uint8_t leds)
+{
+    this->leds = leds;
+    ledsPending = true;
+}
@@ -2,11 +2,81 @@
 #define PARSER_H
 
 #include "hid.h"
+#include "hiduniversal.h"
+#include "hid_plan.h"
 
+#ifndef USB_HID_MAX_KEYBOARDS
+#define USB_HID_MAX_KEYBOARDS   4
+#endif
+
+/*
+ * Keyboard and pointer state of a device
+ *
+ * Each device decodes its reports with its own plan, keys and mouse buttons
+ * of all devices are merged into usb_hid_keyboard_bits and pointer motion
+ * is added up in usb_hid_mouse. Boot protocol plan is used unless plan is
+ * set from report descriptor.
+ */
 class KBDReportParser : public HIDReportParser
 {
 public:
+	KBDReportParser();
 	virtual void Parse(HID *hid, bool is_rpt_id, uint8_t len, uint8_t *buf);
+	virtual void ParseInterface(HID *hid, uint8_t iface, bool is_rpt_id, uint8_t len, uint8_t *buf);
+	/* releases all keys of the device */
+	void Clear();
+
+	hid_plan_t plan;
+	uint16_t time_stamp;
+private:
+	void ParseMouse(uint8_t iface, uint8_t len, uint8_t *buf);
+	static void Merge();
+	static KBDReportParser *parsers[USB_HID_MAX_KEYBOARDS];
+	static uint8_t nparsers;
+
+	// keys of each report in plan
+	uint8_t report_bits[HID_PLAN_REPORTS][HID_PLAN_BITS_SIZE];
+	uint8_t mouse_buttons;
+};
+
+/* Feeds report descriptor to plan parser */
+class KBDReportDescParser : public USBReadParser
+{
+public:
+	KBDReportDescParser(hid_plan_t *plan, uint8_t iface) { hid_desc_init(&desc, plan, iface); }
+	virtual void Parse(const uint16_t len, const uint8_t *pbuf, const uint16_t &offset);
+private:
+	hid_desc_parser_t desc;
+};
+
+/*
+ * Keyboard in report protocol
+ *
+ * Report descriptor of every interface is parsed into plan at enumeration,
+ * reports are decoded with it so that NKRO keyboard can be used with full
+ * rollover. Reports are matched with plan of the interface polled. Falls
+ * back to boot protocol when no keyboard report is found in descriptor of
+ * boot keyboard.
+ *
+ * LED state is sent from Poll() in host task instead of when it is set,
+ * only the latest state is sent if it changes again before that. It is
+ * sent with report ID and length of LED Output report in descriptor.
+ */
+class HIDReportKeyboard : public HIDUniversal
+{
+public:
+	HIDReportKeyboard(USB *p);
+	uint8_t Release();
+	uint8_t Poll();
+	void SetLeds(uint8_t leds);
+protected:
+	virtual uint8_t OnInitSuccessful();
+private:
+	KBDReportParser parser;
+	uint8_t kbdIface;   // interface which keyboard report comes from
+	uint8_t mouseIface;
+	uint8_t leds;
+	bool ledsPending;
 };
 
 #endif
@@ -1,10 +1,26 @@
 #ifndef USB_HID_H
 #define USB_HID_H
 
-#include "report.h"
+#include <stdint.h>
+#include "hid_plan.h"
 
 
-extern report_keyboard_t usb_hid_keyboard_report;
+/* keys on in bitmap indexed by usage ID, modifiers at E0-E7.
+ * union of keys of all keyboards attached. */
+extern uint8_t usb_hid_keyboard_bits[HID_PLAN_BITS_SIZE];
+/* updated when keys of any keyboard change */
 extern uint16_t usb_hid_time_stamp;
 
+/* mouse buttons 1-8 are keys E8-EF in the bitmap so that keymap can use them */
+#define USB_HID_MOUSE_BUTTON    0xE8
+
+/* motion of all pointers accumulated until it is sent */
+typedef struct {
+    int16_t x;
+    int16_t y;
+    int16_t v;
+    int16_t h;
+} usb_hid_mouse_t;
+extern usb_hid_mouse_t usb_hid_mouse;
+
 #endif
@@ -16,6 +16,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "usbdrv.h"
 #include "usbconfig.h"
 #include "host.h"
@@ -23,17 +24,43 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "print.h"
 #include "debug.h"
 #include "host_driver.h"
+#include "timer.h"
 #include "vusb.h"
 
+#ifdef MOUSE_EXTENDED_REPORT
+#   error "MOUSE_EXTENDED_REPORT is not supported on V-USB. Remove it in Makefile."
+#endif
+
 
 static uint8_t vusb_keyboard_leds = 0;
 static uint8_t vusb_idle_rate = 0;
 
-/* Keyboard report send buffer */
+/* Keyboard report send buffer
+ *
+ * Reports are queued here by send_keyboard() and drained by
+ * vusb_transfer_keyboard() from the main loop right after usbPoll().
+ * An unsent report at the tail is coalesced with a newer one when no key
+ * changes state twice across the two, so no keystroke is lost. When the
+ * queue is full the tail is superseded by the newest report instead of
+ * dropping it; the latest state, including every release, always reaches
+ * the host and keys can not get stuck.
+ */
+#ifndef KBUF_SIZE
 #define KBUF_SIZE 16
+#endif
 static report_keyboard_t kbuf[KBUF_SIZE];
 static uint8_t kbuf_head = 0;
 static uint8_t kbuf_tail = 0;
+static uint8_t kbuf_hwm = 0;            // queue high-water mark
+static report_keyboard_t kbuf_last;     // last report handed to V-USB
+
+/* max time(ms) send_keyboard() polls USB to drain a full queue */
+#ifndef KBUF_DRAIN_WAIT
+#define KBUF_DRAIN_WAIT 20
+#endif
+
+#define KBUF_COUNT()    ((uint8_t)(kbuf_head - kbuf_tail + KBUF_SIZE) % KBUF_SIZE)
+#define KBUF_PREV(i)    ((uint8_t)((i) + KBUF_SIZE - 1) % KBUF_SIZE)
 
 typedef struct {
         uint8_t modifier;
@@ -48,17 +75,49 @@ void vusb_transfer_keyboard(void)
 {
     if (usbInterruptIsReady()) {
         if (kbuf_head != kbuf_tail) {
-            usbSetInterrupt((void *)&kbuf[kbuf_tail], sizeof(report_keyboard_t));
+            kbuf_last = kbuf[kbuf_tail];
+            usbSetInterrupt((void *)&kbuf_last, sizeof(report_keyboard_t));
             kbuf_tail = (kbuf_tail + 1) % KBUF_SIZE;
             if (debug_keyboard) {
                 print("V-USB: kbuf["); pdec(kbuf_tail); print("->"); pdec(kbuf_head); print("](");
-                phex((kbuf_head < kbuf_tail) ? (KBUF_SIZE - kbuf_tail + kbuf_head) : (kbuf_head - kbuf_tail));
+                phex(KBUF_COUNT());
                 print(")\n");
             }
         }
     }
 }
 
+uint8_t vusb_kbuf_high_water(void)
+{
+    return kbuf_hwm;
+}
+
+static bool report_has_key(report_keyboard_t *report, uint8_t key)
+{
+    for (uint8_t i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
+        if (report->keys[i] == key) return true;
+    }
+    return false;
+}
+
+/* true if no key changes in both a->b and b->c, that is, c can replace b */
+static bool kbuf_mergeable(report_keyboard_t *a, report_keyboard_t *b, report_keyboard_t *c)
+{
+    if ((a->mods ^ b->mods) & (b->mods ^ c->mods)) return false;
+
+    report_keyboard_t *r[3] = { a, b, c };
+    for (uint8_t n = 0; n < 3; n++) {
+        for (uint8_t i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
+            uint8_t key = r[n]->keys[i];
+            if (!key) continue;
+            bool in_a = report_has_key(a, key);
+            bool in_b = report_has_key(b, key);
+            bool in_c = report_has_key(c, key);
+            if (in_a != in_b && in_b != in_c) return false;
+        }
+    }
+    return true;
+}
 
 /*------------------------------------------------------------------*
  * Host driver
@@ -88,17 +147,38 @@ static uint8_t keyboard_leds(void) {
 
 static void send_keyboard(report_keyboard_t *report)
 {
+    if (kbuf_head != kbuf_tail) {
+        uint8_t last = KBUF_PREV(kbuf_head);
+        report_keyboard_t *prev = (last == kbuf_tail) ? &kbuf_last : &kbuf[KBUF_PREV(last)];
+        if (kbuf_mergeable(prev, &kbuf[last], report)) {
+            kbuf[last] = *report;
+            return;
+        }
+    }
+
     uint8_t next = (kbuf_head + 1) % KBUF_SIZE;
+    if (next == kbuf_tail) {
+        // NOTE: Macro can send key strokes faster than V-USB drains them.
+        // Give the host a few interrupt intervals before superseding.
+        uint16_t t = timer_read();
+        while (next == kbuf_tail && timer_elapsed(t) < KBUF_DRAIN_WAIT) {
+            usbPoll();
+            vusb_transfer_keyboard();
+        }
+    }
+
     if (next != kbuf_tail) {
         kbuf[kbuf_head] = *report;
         kbuf_head = next;
+        if (KBUF_COUNT() > kbuf_hwm) {
+            kbuf_hwm = KBUF_COUNT();
+            debug("kbuf: hwm "); debug_dec(kbuf_hwm); debug("\n");
+        }
     } else {
+        // latest state supersedes unsent tail so that release is never lost
+        kbuf[KBUF_PREV(kbuf_head)] = *report;
         debug("kbuf: full\n");
     }
-
-    // NOTE: send key strokes of Macro
-    usbPoll();
-    vusb_transfer_keyboard();
 }
 
 
@@ -23,5 +23,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 host_driver_t *vusb_driver(void);
 void vusb_transfer_keyboard(void);
+uint8_t vusb_kbuf_high_water(void);
 
 #endif
@@ -329,6 +329,7 @@ MSG_COMPILING_CPP = Compiling C++:
 MSG_ASSEMBLING = Assembling:
 MSG_CLEANING = Cleaning project:
 MSG_CREATING_LIBRARY = Creating library:
+MSG_SPARSE_KEYMAP = Packing sparse keymap:
 
 
 
@@ -579,6 +580,35 @@ $(OBJDIR)/%.o : %.S
 	$(CC) -c $(ALL_ASFLAGS) $< -o $@
 
 
+# Sparse keymap: keymaps[] of SPARSE_KEYMAP_SRC is packed by host program.
+#   Protocol headers are not for host, then PROTOCOL_* and NKRO_ENABLE are
+#   not passed. Dense keymaps[] is not referenced anymore and removed by
+#   --gc-sections. Tables packed are checked against keymaps[] by looking up
+#   every key with keymap_sparse.c on host.
+ifdef SPARSE_KEYMAP_ENABLE
+HOSTCC ?= cc
+SPARSE_KEYMAP_SRC ?= $(firstword $(SRC))
+SPARSE_KEYMAP_TOOL = $(TMK_DIR)/tool/sparse_keymap
+CFLAGS += -I$(OBJDIR)
+
+SPARSE_KEYMAP_HOSTCC = $(HOSTCC) -DPROGMEM= $(filter-out -DPROTOCOL_% -DNKRO_ENABLE,$(OPT_DEFS)) \
+	-DKEYMAP_SRC=\"$(abspath $(SPARSE_KEYMAP_SRC))\" $(if $(CONFIG_H),-include $(CONFIG_H)) \
+	-I$(SPARSE_KEYMAP_TOOL)/host $(patsubst %,-I%,$(EXTRAINCDIRS)) \
+	-ffunction-sections -fdata-sections -Wl,--gc-sections
+
+$(OBJDIR)/keymap_sparse_table.h : $(SPARSE_KEYMAP_SRC) $(CONFIG_H) $(SPARSE_KEYMAP_TOOL)/pack.c \
+		$(SPARSE_KEYMAP_TOOL)/check.c $(TMK_DIR)/common/keymap_sparse.c
+	@echo
+	@echo $(MSG_SPARSE_KEYMAP) $<
+	$(SPARSE_KEYMAP_HOSTCC) $(SPARSE_KEYMAP_TOOL)/pack.c -o $(OBJDIR)/keymap_pack
+	$(OBJDIR)/keymap_pack $(notdir $<) > $@
+	$(SPARSE_KEYMAP_HOSTCC) -I$(OBJDIR) $(SPARSE_KEYMAP_TOOL)/check.c -o $(OBJDIR)/keymap_check
+	$(OBJDIR)/keymap_check || (rm -f $@; false)
+
+$(OBJDIR)/common/keymap_sparse.o : $(OBJDIR)/keymap_sparse_table.h
+endif
+
+
 # Create preprocessed source for use in sending a bug report.
 %.i : %.c
 	$(CC) -E -mmcu=$(MCU) $(CFLAGS) $< -o $@ 
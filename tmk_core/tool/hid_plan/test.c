@@ -0,0 +1,248 @@
+/*
+ * Host tests of tmk_core/protocol/usb_hid/hid_plan.c
+ *
+ *     usage: test
+ *
+ * Report descriptors of interfaces are fed into a plan and reports
+ * received on the interfaces are checked against keys and pointer motion
+ * expected, so are LED reports built for them. Exits with non-zero when any
+ * of them fails.
+ *
+ *     cc -I../../common -I../../protocol/usb_hid -DNO_PRINT -DNO_DEBUG \
+ *         -o test test.c ../../protocol/usb_hid/hid_plan.c
+ */
+#include <stdio.h>
+#include <string.h>
+#include "hid_plan.h"
+
+
+/* boot keyboard: mods, reserved, keys[6] and LED output */
+static const uint8_t desc_boot[] = {
+    0x05, 0x01, 0x09, 0x06, 0xA1, 0x01,
+    0x05, 0x07, 0x19, 0xE0, 0x29, 0xE7, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x08, 0x81, 0x02,
+    0x95, 0x01, 0x75, 0x08, 0x81, 0x01,
+    0x95, 0x05, 0x75, 0x01, 0x05, 0x08, 0x19, 0x01, 0x29, 0x05, 0x91, 0x02,
+    0x95, 0x01, 0x75, 0x03, 0x91, 0x01,
+    0x95, 0x06, 0x75, 0x08, 0x15, 0x00, 0x25, 0x65, 0x05, 0x07, 0x19, 0x00, 0x29, 0x65, 0x81, 0x00,
+    0xC0,
+};
+
+/* NKRO: ID 1 mods and bitmap of 00-77, ID 2 consumer */
+static const uint8_t desc_nkro[] = {
+    0x05, 0x01, 0x09, 0x06, 0xA1, 0x01, 0x85, 0x01,
+    0x05, 0x07, 0x19, 0xE0, 0x29, 0xE7, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x08, 0x81, 0x02,
+    0x05, 0x07, 0x19, 0x00, 0x29, 0x77, 0x95, 0x78, 0x75, 0x01, 0x81, 0x02,
+    0xC0,
+    0x05, 0x0C, 0x09, 0x01, 0xA1, 0x01, 0x85, 0x02,
+    0x15, 0x00, 0x26, 0xFF, 0x02, 0x19, 0x00, 0x2A, 0xFF, 0x02, 0x75, 0x10, 0x95, 0x01, 0x81, 0x00,
+    0xC0,
+};
+
+/* vendor defined: 8 bytes input */
+static const uint8_t desc_vendor[] = {
+    0x06, 0x00, 0xFF, 0x09, 0x01, 0xA1, 0x01,
+    0x15, 0x00, 0x26, 0xFF, 0x00, 0x75, 0x08, 0x95, 0x08, 0x09, 0x01, 0x81, 0x02,
+    0xC0,
+};
+
+/* mouse: ID 1 buttons 1-5, 16-bit X/Y, wheel and AC Pan */
+static const uint8_t desc_mouse[] = {
+    0x05, 0x01, 0x09, 0x02, 0xA1, 0x01, 0x85, 0x01, 0x09, 0x01, 0xA1, 0x00,
+    0x05, 0x09, 0x19, 0x01, 0x29, 0x05, 0x15, 0x00, 0x25, 0x01, 0x95, 0x05, 0x75, 0x01, 0x81, 0x02,
+    0x95, 0x01, 0x75, 0x03, 0x81, 0x01,
+    0x05, 0x01, 0x09, 0x30, 0x09, 0x31, 0x16, 0x01, 0x80, 0x26, 0xFF, 0x7F, 0x75, 0x10, 0x95, 0x02, 0x81, 0x06,
+    0x09, 0x38, 0x15, 0x81, 0x25, 0x7F, 0x75, 0x08, 0x95, 0x01, 0x81, 0x06,
+    0x05, 0x0C, 0x0A, 0x38, 0x02, 0x95, 0x01, 0x81, 0x06,
+    0xC0, 0xC0,
+};
+
+/* NKRO with LED Output of ID 3 after a reserved byte, Caps Lock and Scroll Lock only */
+static const uint8_t desc_nkro_led[] = {
+    0x05, 0x01, 0x09, 0x06, 0xA1, 0x01, 0x85, 0x01,
+    0x05, 0x07, 0x19, 0xE0, 0x29, 0xE7, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x08, 0x81, 0x02,
+    0x05, 0x07, 0x19, 0x00, 0x29, 0x77, 0x95, 0x78, 0x75, 0x01, 0x81, 0x02,
+    0x85, 0x03, 0x95, 0x01, 0x75, 0x08, 0x91, 0x01,
+    0x05, 0x08, 0x19, 0x02, 0x29, 0x03, 0x95, 0x02, 0x75, 0x01, 0x91, 0x02,
+    0x95, 0x06, 0x91, 0x01,
+    0xC0,
+};
+
+
+static unsigned passed = 0, failed = 0;
+
+static void load(hid_plan_t *plan, uint8_t iface, const uint8_t *desc, unsigned len)
+{
+    hid_desc_parser_t p;
+    hid_desc_init(&p, plan, iface);
+    for (unsigned i = 0; i < len; i++) hid_desc_feed(&p, desc[i]);
+}
+
+static void result(const char *name, int ok, const char *got)
+{
+    if (ok) {
+        passed++;
+    } else {
+        failed++;
+        printf("FAIL %s: got '%s'\n", name, got);
+    }
+}
+
+/* keys expected as "04 E1", "nomatch" or "error" */
+static void expect_keys(const char *name, const hid_plan_t *plan, uint8_t iface,
+                        const uint8_t *buf, uint8_t len, const char *want)
+{
+    uint8_t bits[HID_PLAN_BITS_SIZE];
+    char got[256] = "";
+    int8_t r = hid_plan_decode(plan, iface, buf, len, bits);
+    if (r == HID_PLAN_NOMATCH) {
+        strcpy(got, "nomatch");
+    } else if (r == HID_PLAN_ERROR) {
+        strcpy(got, "error");
+    } else {
+        for (unsigned u = 0; u < 256; u++) {
+            if (bits[u >> 3] & (1 << (u & 7))) {
+                sprintf(got + strlen(got), "%s%02X", got[0] ? " " : "", u);
+            }
+        }
+    }
+    result(name, strcmp(got, want) == 0, got);
+}
+
+/* pointer expected as "btn x y wheel pan" or "nomatch" */
+static void expect_mouse(const char *name, const hid_plan_t *plan, uint8_t iface,
+                         const uint8_t *buf, uint8_t len, const char *want)
+{
+    hid_mouse_t mouse;
+    char got[64] = "nomatch";
+    if (hid_plan_decode_mouse(plan, iface, buf, len, &mouse) == 0) {
+        sprintf(got, "%02X %d %d %d %d", mouse.buttons, mouse.axis[HID_AXIS_X], mouse.axis[HID_AXIS_Y],
+                mouse.axis[HID_AXIS_WHEEL], mouse.axis[HID_AXIS_PAN]);
+    }
+    result(name, strcmp(got, want) == 0, got);
+}
+
+#define MOUSE(name, plan, iface, want, ...) do { \
+    const uint8_t buf[] = { __VA_ARGS__ }; \
+    expect_mouse(name, plan, iface, buf, sizeof(buf), want); \
+} while (0)
+
+/* LED report expected as "if:0 01 02" or "none" */
+static void expect_leds(const char *name, const hid_plan_t *plan, uint8_t leds, uint8_t size,
+                        const char *want)
+{
+    uint8_t buf[16];
+    char got[64] = "none";
+    uint8_t len = hid_plan_leds(plan, leds, buf, size);
+    if (len) {
+        sprintf(got, "if:%u", plan->led.iface);
+        for (uint8_t i = 0; i < len; i++) {
+            sprintf(got + strlen(got), " %02X", buf[i]);
+        }
+    }
+    result(name, strcmp(got, want) == 0, got);
+}
+
+#define KEYS(name, plan, iface, want, ...) do { \
+    const uint8_t buf[] = { __VA_ARGS__ }; \
+    expect_keys(name, plan, iface, buf, sizeof(buf), want); \
+} while (0)
+
+
+static void test_boot(void)
+{
+    hid_plan_t plan;
+    hid_plan_init(&plan);
+    load(&plan, 0, desc_boot, sizeof(desc_boot));
+
+    KEYS("boot keys", &plan, 0, "04 05 E1 E5",   0x22, 0, 0x04, 0x05, 0, 0, 0, 0);
+    KEYS("boot rollover", &plan, 0, "error",    0x00, 0, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01);
+    KEYS("boot longer", &plan, 0, "29",         0x00, 0, 0x29, 0, 0, 0, 0, 0, 0);
+    KEYS("boot other iface", &plan, 1, "nomatch", 0x00, 0, 0x04, 0, 0, 0, 0, 0);
+
+    hid_plan_init(&plan);
+    hid_plan_boot(&plan, 1);
+    KEYS("boot plan", &plan, 1, "06 E0",        0x01, 0, 0x06, 0, 0, 0, 0, 0);
+    KEYS("boot plan other iface", &plan, 0, "nomatch", 0x01, 0, 0x06, 0, 0, 0, 0, 0);
+}
+
+/* boot keyboard and NKRO interface of one device */
+static void test_composite(void)
+{
+    hid_plan_t plan;
+    hid_plan_init(&plan);
+    load(&plan, 0, desc_boot, sizeof(desc_boot));
+    load(&plan, 1, desc_nkro, sizeof(desc_nkro));
+    load(&plan, 2, desc_vendor, sizeof(desc_vendor));
+
+    KEYS("nkro keys", &plan, 1, "04 2F 77 E1",
+         0x01, 0x02, 0x10, 0, 0, 0, 0, 0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0x80);
+    KEYS("nkro consumer", &plan, 1, "nomatch", 0x02, 0xE9, 0x00);
+    // modifiers of boot report equal to ID of NKRO report
+    KEYS("boot LCtrl", &plan, 0, "04 E0",       0x01, 0, 0x04, 0, 0, 0, 0, 0);
+    KEYS("boot LShift", &plan, 0, "05 E1",      0x02, 0, 0x05, 0, 0, 0, 0, 0);
+    // report of same length on vendor interface
+    KEYS("vendor", &plan, 2, "nomatch",         0x00, 0, 0x04, 0, 0, 0, 0, 0);
+    KEYS("vendor with ID byte", &plan, 2, "nomatch",
+         0x01, 0x02, 0x10, 0, 0, 0, 0, 0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0x80);
+}
+
+/* keyboard and mouse interfaces of one receiver */
+static void test_mouse(void)
+{
+    hid_plan_t plan;
+    hid_plan_init(&plan);
+    load(&plan, 0, desc_boot, sizeof(desc_boot));
+    load(&plan, 1, desc_mouse, sizeof(desc_mouse));
+
+    MOUSE("mouse", &plan, 1, "05 -2 300 1 -1",  0x01, 0x05, 0xFE, 0xFF, 0x2C, 0x01, 0x01, 0xFF);
+    MOUSE("mouse short", &plan, 1, "nomatch",   0x01, 0x05, 0xFE, 0xFF, 0x2C, 0x01);
+    MOUSE("mouse other ID", &plan, 1, "nomatch", 0x02, 0x05, 0xFE, 0xFF, 0x2C, 0x01, 0x01, 0xFF);
+    // report of one interface isn't decoded as the other
+    KEYS("mouse as keys", &plan, 1, "nomatch",  0x01, 0x05, 0xFE, 0xFF, 0x2C, 0x01, 0x01, 0xFF);
+    MOUSE("keys as mouse", &plan, 0, "nomatch", 0x01, 0, 0x04, 0, 0, 0, 0, 0);
+    KEYS("keys", &plan, 0, "04 E0",             0x01, 0, 0x04, 0, 0, 0, 0, 0);
+
+    // boot mouse may send extra bytes
+    hid_plan_init(&plan);
+    hid_plan_boot(&plan, 0);
+    hid_plan_boot_mouse(&plan, 1);
+    MOUSE("boot mouse", &plan, 1, "01 -1 2 0 0", 0x01, 0xFF, 0x02);
+    MOUSE("boot mouse longer", &plan, 1, "03 5 -5 0 0", 0x03, 0x05, 0xFB, 0x01);
+    MOUSE("boot mouse other iface", &plan, 0, "nomatch", 0x01, 0xFF, 0x02);
+    KEYS("boot mouse as keys", &plan, 1, "nomatch", 0x01, 0xFF, 0x02);
+}
+
+/* LED Output report with ID and on other than first interface */
+static void test_leds(void)
+{
+    hid_plan_t plan;
+    hid_plan_init(&plan);
+    load(&plan, 0, desc_boot, sizeof(desc_boot));
+    expect_leds("boot leds", &plan, 0x1F, 16, "if:0 1F");
+
+    hid_plan_init(&plan);
+    hid_plan_boot(&plan, 2);
+    expect_leds("boot plan leds", &plan, 0x02, 16, "if:2 02");
+
+    hid_plan_init(&plan);
+    load(&plan, 0, desc_vendor, sizeof(desc_vendor));
+    expect_leds("no leds", &plan, 0x02, 16, "none");
+    load(&plan, 1, desc_nkro_led, sizeof(desc_nkro_led));
+    expect_leds("nkro caps", &plan, 0x02, 16, "if:1 03 00 01");
+    expect_leds("nkro scroll", &plan, 0x05, 16, "if:1 03 00 02");
+    expect_leds("nkro short buffer", &plan, 0x02, 2, "none");
+    KEYS("nkro leds keys", &plan, 1, "04",
+         0x01, 0x00, 0x10, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+}
+
+
+int main(void)
+{
+    test_boot();
+    test_composite();
+    test_mouse();
+    test_leds();
+
+    printf("%u passed, %u failed\n", passed, failed);
+    return failed ? 1 : 0;
+}
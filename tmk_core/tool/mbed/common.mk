@@ -7,6 +7,7 @@ OBJECTS += \
 	$(OBJDIR)/common/host.o \
 	$(OBJDIR)/common/keymap.o \
 	$(OBJDIR)/common/keyboard.o \
+	$(OBJDIR)/common/startup.o \
 	$(OBJDIR)/common/print.o \
 	$(OBJDIR)/common/debug.o \
 	$(OBJDIR)/common/util.o \
@@ -38,12 +39,10 @@ ifdef MOUSEKEY_ENABLE
 endif
 
 ifdef EXTRAKEY_ENABLE
-    $(error Not Supported)
     OPT_DEFS += -DEXTRAKEY_ENABLE
 endif
 
 ifdef CONSOLE_ENABLE
-    $(error Not Supported)
     OPT_DEFS += -DCONSOLE_ENABLE
 else
     OPT_DEFS += -DNO_PRINT
@@ -57,7 +56,6 @@ ifdef COMMAND_ENABLE
 endif
 
 ifdef NKRO_ENABLE
-    $(error Not Supported)
     OPT_DEFS += -DNKRO_ENABLE
 endif
 
@@ -79,3 +77,5 @@ ifdef KEYMAP_SECTION_ENABLE
     OPT_DEFS += -DKEYMAP_SECTION_ENABLE
     EXTRALDFLAGS = -Wl,-L$(TMK_DIR),-Tldscript_keymap_avr5.x
 endif
+
+CC_FLAGS += $(OPT_DEFS)
@@ -77,6 +77,8 @@ INCLUDE_PATHS += \
 	-I$(MBED_DIR)/libraries/USBDevice/USBSerial
 
 # TMK mbed protocol
+OPT_DEFS += -DPROTOCOL_MBED
+
 OBJECTS += \
 	$(OBJDIR)/protocol/mbed/mbed_driver.o \
 	$(OBJDIR)/protocol/mbed/HIDKeyboard.o
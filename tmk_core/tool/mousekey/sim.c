@@ -0,0 +1,121 @@
+/*
+ * Host simulation of tmk_core/common/mousekey.c
+ *
+ *     usage: sim [-w] [-c curve] [hold_ms [total_ms]]
+ *
+ * KC_MS_RIGHT(and KC_MS_WH_UP with -w) is held from 0ms for hold_ms
+ * (default 2000) and mousekey_task() is called every 1ms until total_ms
+ * (default hold_ms + 1000). Each line has time(ms), pointer position x and
+ * its speed(units/s over last 100ms), then wheel position v and its speed.
+ * Summary at the end tells when repeat started, when it reached full speed
+ * and how far it went after release.
+ *
+ *     cc -I../../common -DNO_PRINT -DNO_DEBUG -o sim sim.c
+ *
+ * Options of config.h can be given with -D, e.g. -DMOUSEKEY_INERTIA=100.
+ * -c sets mk_curve, e.g. -c 500 for slow start.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PROGMEM
+#define pgm_read_word(p)    *(p)
+#include "../../common/mousekey.c"
+
+
+/* timer stub */
+static uint32_t now = 0;
+
+uint16_t timer_read(void) { return now; }
+uint32_t timer_read32(void) { return now; }
+uint16_t timer_elapsed(uint16_t last) { return TIMER_DIFF_16((uint16_t)now, last); }
+uint32_t timer_elapsed32(uint32_t last) { return TIMER_DIFF_32(now, last); }
+
+
+debug_config_t debug_config;
+
+/* host stub: motion sent is added up */
+#define HISTORY 100
+static long pos_x = 0, pos_v = 0;
+static long hist_x[HISTORY], hist_v[HISTORY];
+
+#ifdef MOUSE_EXTENDED_REPORT
+uint8_t mouse_resolution = 0;
+#endif
+
+void host_mouse_send(report_mouse_t *report)
+{
+    pos_x += report->x;
+    pos_v += report->v;
+}
+
+
+int main(int argc, char *argv[])
+{
+    int wheel = 0;
+    unsigned long hold = 2000, total = 0;
+    int i = 1;
+
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-w") == 0) {
+            wheel = 1;
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            mk_curve = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: sim [-w] [-c curve] [hold_ms [total_ms]]\n");
+            return 1;
+        }
+    }
+    if (i < argc) hold = strtoul(argv[i++], NULL, 0);
+    total = (i < argc) ? strtoul(argv[i], NULL, 0) : hold + 1000;
+
+    unsigned long first = 0, full = 0, stop = 0;
+    long max_speed = 0, at_release = 0;
+
+    printf("#   ms       x   x/s       v   v/s\n");
+    for (now = 0; now < total; now++) {
+        if (now == 0) {
+            // sent per key as action does
+            mousekey_on(KC_MS_RIGHT);
+            mousekey_send();
+            if (wheel) {
+                mousekey_on(KC_MS_WH_UP);
+                mousekey_send();
+            }
+        }
+        if (now == hold) {
+            mousekey_off(KC_MS_RIGHT);
+            if (wheel) mousekey_off(KC_MS_WH_UP);
+            at_release = pos_x;
+        }
+        mousekey_task();
+
+        long speed_x = (pos_x - hist_x[now % HISTORY]) * (1000 / HISTORY);
+        long speed_v = (pos_v - hist_v[now % HISTORY]) * (1000 / HISTORY);
+        hist_x[now % HISTORY] = pos_x;
+        hist_v[now % HISTORY] = pos_v;
+        printf("%6lu %7ld %5ld %7ld %5ld\n", (unsigned long)now, pos_x, speed_x, pos_v, speed_v);
+
+        // motion after the step sent on press
+        if (!first && now && pos_x > MOUSEKEY_MOVE_DELTA) first = now;
+        if (now < hold && speed_x > max_speed) {
+            max_speed = speed_x;
+            full = now;
+        }
+        if (now >= hold && !stop && !vel_x) {
+            stop = now;
+        }
+    }
+
+    if (first) {
+        printf("# repeat from %lums, full speed %ld/s at %lums,", first, max_speed, full);
+    } else {
+        printf("# no repeat,");
+    }
+    printf(" %ld after release", pos_x - at_release);
+    if (stop) printf(" until %lums", stop);
+    printf("\n");
+    return 0;
+}
@@ -0,0 +1,91 @@
+/*
+ * Host simulation of tmk_core/common/power_policy.c against key event traces
+ *
+ *     usage: sim [-v] < typing.txt
+ *
+ * Trace has time of a key event(ms) per line, '#' starts comment. Clock is
+ * stepped by 1ms with power_policy_task() and events are fed with
+ * power_policy_activity(). State changes are printed with -v, then time
+ * spent in each state and number of events arrived in each state; events
+ * in IDLE or SLEEP pay wake latency of the link.
+ *
+ *     cc -I../../common -DNO_PRINT -DNO_DEBUG -o sim sim.c ../../common/power_policy.c
+ *
+ * Options of config.h can be given with -D, e.g. -DPOWER_SLEEP_TIMEOUT=5000.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "timer.h"
+#include "power_policy.h"
+
+
+/* timer stub */
+static uint32_t now = 0;
+
+uint16_t timer_read(void) { return now; }
+uint32_t timer_read32(void) { return now; }
+uint16_t timer_elapsed(uint16_t last) { return TIMER_DIFF_16((uint16_t)now, last); }
+uint32_t timer_elapsed32(uint32_t last) { return TIMER_DIFF_32(now, last); }
+
+
+static const char *state_name[] = { "ACTIVE", "IDLE", "SLEEP" };
+static power_state_t last = POWER_ACTIVE;
+static uint32_t spent[3];
+static int verbose = 0;
+
+static void check_state(void)
+{
+    if (power_policy_state() != last) {
+        last = power_policy_state();
+        if (verbose) printf("%8lu %s\n", (unsigned long)now, state_name[last]);
+    }
+}
+
+/* one ms of main loop */
+static void step(void)
+{
+    power_policy_task();
+    check_state();
+    spent[last]++;
+    now++;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned hits[3] = {};
+    unsigned events = 0;
+    char line[64];
+    unsigned long t;
+
+    verbose = (argc > 1 && strcmp(argv[1], "-v") == 0);
+    while (fgets(line, sizeof(line), stdin)) {
+        if (line[0] == '#' || sscanf(line, "%lu", &t) != 1) continue;
+        if (t < now) {
+            // events in the same ms are fed at once
+            if (t + 1 < now) {
+                fprintf(stderr, "trace not sorted: %lu\n", t);
+                return 1;
+            }
+            power_policy_activity();
+            events++;
+            continue;
+        }
+        while (now < t) step();
+
+        hits[last]++;
+        events++;
+        power_policy_activity();
+        check_state();
+        step();
+    }
+    // tail to see it goes to sleep
+    for (uint32_t i = 0; i < POWER_SLEEP_MAX + POWER_IDLE_MAX; i++) step();
+
+    printf("events: %u, time: %lums\n", events, (unsigned long)now);
+    for (int s = POWER_ACTIVE; s <= POWER_SLEEP; s++) {
+        printf("%-6s %9lums %5.1f%%  events arrived: %u\n", state_name[s],
+               (unsigned long)spent[s], 100.0 * spent[s] / now, hits[s]);
+    }
+    return 0;
+}
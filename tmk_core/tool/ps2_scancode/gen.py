@@ -0,0 +1,201 @@
+#!/usr/bin/env python
+"""
+Generate PS/2 scan code transition tables for tmk_core/protocol/ps2_scancode.c
+
+    usage: gen.py [scancode.txt [ps2_scancode_table.h]]
+
+See scancode.txt for the spec format.
+"""
+import os
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SPEC = os.path.join(HERE, 'scancode.txt')
+OUT = os.path.join(HERE, '..', '..', 'protocol', 'ps2_scancode_table.h')
+
+DEFAULTS = {
+    'reset':     'PS2_SC_DEF_RESET',
+    'make':      'PS2_SC_DEF_MAKE',
+    'break':     'PS2_SC_DEF_BREAK',
+    'makebreak': 'PS2_SC_DEF_MAKEBREAK',
+}
+ACTIONS = {
+    'goto':   'PS2_SC_NONE',
+    'ignore': 'PS2_SC_NONE',
+    'make':   'PS2_SC_MAKE',
+    'break':  'PS2_SC_BREAK',
+    'tap':    'PS2_SC_TAP',
+    'clear':  'PS2_SC_CLEAR',
+}
+WITH_POS = ('make', 'break', 'tap')
+
+
+class SpecError(Exception):
+    pass
+
+
+class State(object):
+    def __init__(self, name, default, base=0, limit=0):
+        self.name = name
+        self.default = default
+        self.base = base
+        self.limit = limit
+        self.trans = []     # [code, action, pos, next]
+
+    def find(self, code):
+        for t in self.trans:
+            if t[0] == code:
+                return t
+        return None
+
+    def add(self, code, action, pos, next):
+        if self.find(code):
+            raise SpecError('duplicate code %02X in state %s' % (code, self.name))
+        self.trans.append([code, action, pos, next])
+
+
+class Set(object):
+    def __init__(self, name):
+        self.name = name
+        self.states = []
+
+    def state(self, name):
+        for s in self.states:
+            if s.name == name:
+                return s
+        return None
+
+    def add_seq(self, codes, action, pos):
+        s = self.states[0]
+        for i, code in enumerate(codes[:-1]):
+            t = s.find(code)
+            if t is None:
+                name = '_'.join('%02X' % c for c in codes[:i + 1])
+                n = self.state(name) or State(name, 'reset')
+                if n not in self.states:
+                    self.states.append(n)
+                s.add(code, 'goto', 0, name)
+                s = n
+            elif t[1] == 'goto' and t[3]:
+                s = self.state(t[3])
+            else:
+                raise SpecError('sequence conflicts at %02X in state %s' % (code, s.name))
+        s.add(codes[-1], action, pos, None)
+
+
+def hexbyte(s):
+    v = int(s, 16)
+    if not 0 <= v <= 0xFF:
+        raise SpecError('not a byte: %s' % s)
+    return v
+
+
+def parse(lines):
+    sets = []
+    cur = None
+    state = None
+    for lineno, line in enumerate(lines, 1):
+        line = line.split('#', 1)[0].split()
+        if not line:
+            continue
+        try:
+            if line[0] == 'set':
+                cur = Set(line[1])
+                sets.append(cur)
+                state = None
+                continue
+            if cur is None:
+                raise SpecError('no set')
+            if line[0] == 'state':
+                if line[2] not in DEFAULTS:
+                    raise SpecError('unknown default: %s' % line[2])
+                opts = dict(zip(line[3::2], (hexbyte(v) for v in line[4::2])))
+                state = State(line[1], line[2], opts.get('base', 0), opts.get('limit', 0))
+                cur.states.append(state)
+                continue
+
+            next = None
+            if '->' in line:
+                i = line.index('->')
+                next = line[i + 1]
+                line = line[:i]
+            is_seq = line[0] == 'seq'
+            if is_seq:
+                i = line.index(':')
+                codes = [hexbyte(c) for c in line[1:i]]
+                line = line[i + 1:]
+            else:
+                if state is None:
+                    raise SpecError('no state')
+                codes = [hexbyte(line[0])]
+                line = line[1:]
+            action = line[0]
+            if action not in ACTIONS:
+                raise SpecError('unknown action: %s' % action)
+            pos = hexbyte(line[1]) if action in WITH_POS else 0
+            if is_seq:
+                cur.add_seq(codes, action, pos)
+            else:
+                state.add(codes[0], action, pos, next)
+        except (SpecError, IndexError, ValueError) as e:
+            raise SpecError('line %d: %s' % (lineno, e))
+
+    for st in sets:
+        for s in st.states:
+            for t in s.trans:
+                if t[3] and not st.state(t[3]):
+                    raise SpecError('set %s: unknown state %s' % (st.name, t[3]))
+    return sets
+
+
+def generate(sets, spec):
+    out = []
+    w = out.append
+    w('/* Generated by tmk_core/tool/ps2_scancode/gen.py from %s. Do not edit. */' % os.path.basename(spec))
+    w('#ifndef PS2_SCANCODE_TABLE_H')
+    w('#define PS2_SCANCODE_TABLE_H')
+    for st in sets:
+        index = dict((s.name, i) for i, s in enumerate(st.states))
+        ntrans = sum(len(s.trans) for s in st.states)
+        if len(st.states) > 256 or ntrans > 256:
+            raise SpecError('set %s: too many states or transitions' % st.name)
+        w('')
+        w('')
+        w('/* Scan Code Set %s */' % st.name)
+        w('static const ps2_sc_state_t ps2_sc_set%s_states[] PROGMEM = {' % st.name)
+        width = max(len(s.name) for s in st.states)
+        first = 0
+        for i, s in enumerate(st.states):
+            w('    /* %2d %-*s */ { %3d, %2d, %-20s, 0x%02X, 0x%02X },' %
+              (i, width, s.name, first, len(s.trans), DEFAULTS[s.default], s.base, s.limit))
+            first += len(s.trans)
+        w('};')
+        w('static const ps2_sc_trans_t ps2_sc_set%s_trans[] PROGMEM = {' % st.name)
+        for s in st.states:
+            w('    /* %s */' % s.name)
+            for code, action, pos, next in s.trans:
+                w('    { 0x%02X, %-12s, 0x%02X, %2d },' %
+                  (code, ACTIONS[action], pos, index[next] if next else 0))
+        w('};')
+        w('const ps2_sc_set_t ps2_sc_set%s = { ps2_sc_set%s_states, ps2_sc_set%s_trans };' %
+          (st.name, st.name, st.name))
+    w('')
+    w('#endif')
+    return '\n'.join(out) + '\n'
+
+
+def main(argv):
+    spec = argv[1] if len(argv) > 1 else SPEC
+    dest = argv[2] if len(argv) > 2 else OUT
+    with open(spec) as f:
+        sets = parse(f.readlines())
+    with open(dest, 'w') as f:
+        f.write(generate(sets, spec))
+
+
+if __name__ == '__main__':
+    try:
+        main(sys.argv)
+    except SpecError as e:
+        sys.stderr.write('gen.py: %s\n' % e)
+        sys.exit(1)
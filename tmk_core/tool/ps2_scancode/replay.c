@@ -0,0 +1,113 @@
+/*
+ * Replays recorded byte streams through tmk_core/protocol/ps2_scancode.c
+ *
+ *     usage: replay [replay.txt]
+ *
+ * Exits with non-zero when decoded events differ from expected ones. See
+ * replay.txt for the format. Run after gen.py to check tables generated.
+ *
+ *     cc -I../../common -I../../protocol -o replay replay.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/* host has no program space */
+#define PROGMEM
+#define pgm_read_byte(p)    (*(const uint8_t *)(p))
+#include "../../protocol/ps2_scancode.c"
+
+
+#define EVENTS_MAX  32
+
+static const char event_char[] = "?MBTC";
+
+/* formats events as in replay.txt */
+static void format(char *buf, const uint8_t *ev, const uint8_t *pos, int n)
+{
+    buf[0] = '\0';
+    for (int i = 0; i < n; i++) {
+        if (ev[i] == PS2_SC_CLEAR) {
+            sprintf(buf + strlen(buf), "%sC", i ? " " : "");
+        } else {
+            sprintf(buf + strlen(buf), "%s%c%02X", i ? " " : "", event_char[ev[i]], pos[i]);
+        }
+    }
+}
+
+/* normalizes expected events: upper case and single spaces */
+static void normalize(char *buf, const char *s)
+{
+    char *p = buf;
+    for (; *s; s++) {
+        if (*s == ' ' || *s == '\t') {
+            if (p != buf && p[-1] != ' ') *p++ = ' ';
+        } else {
+            *p++ = (*s >= 'a' && *s <= 'z') ? *s - 'a' + 'A' : *s;
+        }
+    }
+    if (p != buf && p[-1] == ' ') p--;
+    *p = '\0';
+}
+
+int main(int argc, char *argv[])
+{
+    const char *file = argc > 1 ? argv[1] : "replay.txt";
+    FILE *fp = fopen(file, "r");
+    if (!fp) {
+        perror(file);
+        return 2;
+    }
+
+    const ps2_sc_set_t *set = NULL;
+    unsigned lineno = 0, passed = 0, failed = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), fp)) {
+        lineno++;
+        char *p = strchr(line, '#');
+        if (p) *p = '\0';
+        line[strcspn(line, "\r\n")] = '\0';
+
+        unsigned n;
+        if (sscanf(line, " set %u", &n) == 1) {
+            set = (n == 1) ? &ps2_sc_set1 : (n == 2) ? &ps2_sc_set2 : (n == 3) ? &ps2_sc_set3 : NULL;
+            if (!set) {
+                fprintf(stderr, "%s:%u: unknown set %u\n", file, lineno, n);
+                return 2;
+            }
+            continue;
+        }
+        char *colon = strchr(line, ':');
+        if (!colon) continue;
+        *colon = '\0';
+        if (!set) {
+            fprintf(stderr, "%s:%u: no set given\n", file, lineno);
+            return 2;
+        }
+
+        ps2_sc_decoder_t d;
+        uint8_t ev[EVENTS_MAX], pos[EVENTS_MAX];
+        int nev = 0;
+        ps2_sc_init(&d, set);
+        for (char *tok = strtok(line, " \t"); tok; tok = strtok(NULL, " \t")) {
+            uint8_t code = strtoul(tok, NULL, 16);
+            uint8_t e = ps2_sc_decode(&d, code, &pos[nev]);
+            if (e != PS2_SC_NONE && nev < EVENTS_MAX) ev[nev++] = e;
+        }
+
+        char got[EVENTS_MAX * 4 + 1], want[256];
+        format(got, ev, pos, nev);
+        normalize(want, colon + 1);
+        if (strcmp(got, want) == 0) {
+            passed++;
+        } else {
+            failed++;
+            printf("%s:%u: expected '%s' but got '%s'\n", file, lineno, want, got);
+        }
+    }
+    fclose(fp);
+
+    printf("%u passed, %u failed\n", passed, failed);
+    return failed ? 1 : 0;
+}
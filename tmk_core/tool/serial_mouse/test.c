@@ -0,0 +1,112 @@
+/*
+ * Host tests of serial mouse packet decoders
+ *
+ *     usage: test
+ *
+ * Byte streams are fed into serial_mouse_recv() of Microsoft and
+ * Mousesystems protocol and motion and buttons passed to serial_mouse.c
+ * are checked against expected. Exits with non-zero when any of them fails.
+ *
+ *     cc -I../../common -I../../protocol -o test test.c
+ *
+ * Add -DSERIAL_MOUSE_CENTER_SCROLL to test scroll with middle button.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#define serial_mouse_recv   microsoft_recv
+#include "../../protocol/serial_mouse_microsoft.c"
+#undef serial_mouse_recv
+#define serial_mouse_recv   mousesystems_recv
+#include "../../protocol/serial_mouse_mousesystems.c"
+#undef serial_mouse_recv
+
+
+/* stubs of serial_mouse.c: decoded since start of a case */
+static int16_t acc_x, acc_y, acc_v, acc_h;
+static uint8_t acc_buttons;
+static unsigned packets;
+
+void serial_mouse_move(int16_t x, int16_t y, int16_t v, int16_t h)
+{
+    acc_x += x;
+    acc_y += y;
+    acc_v += v;
+    acc_h += h;
+}
+
+void serial_mouse_buttons(uint8_t buttons)
+{
+    acc_buttons = buttons;
+    packets++;
+}
+
+
+static unsigned passed = 0, failed = 0;
+
+/* result as "btn x y v h" or "none" when no packet is decoded */
+static void expect(const char *name, void (*recv)(uint8_t), const uint8_t *data, unsigned len,
+                   const char *want)
+{
+    char got[64] = "none";
+    acc_x = acc_y = acc_v = acc_h = 0;
+    packets = 0;
+    for (unsigned i = 0; i < len; i++) recv(data[i]);
+    if (packets) {
+        sprintf(got, "%02X %d %d %d %d", acc_buttons, acc_x, acc_y, acc_v, acc_h);
+    }
+    if (strcmp(got, want) == 0) {
+        passed++;
+    } else {
+        failed++;
+        printf("FAIL %s: got '%s'\n", name, got);
+    }
+}
+
+#define FEED(name, recv, want, ...) do { \
+    const uint8_t data[] = { __VA_ARGS__ }; \
+    expect(name, recv, data, sizeof(data), want); \
+} while (0)
+
+
+/* 3 bytes: 1 L R Y7 Y6 X7 X6, X5-X0, Y5-Y0, Logitech may add 4th byte */
+static void test_microsoft(void)
+{
+    FEED("ms move", microsoft_recv, "01 5 -3 0 0",          0x6C, 0x05, 0x3D);
+    FEED("ms sync", microsoft_recv, "02 -128 -1 0 0",       0x05, 0x12, 0x5E, 0x00, 0x3F);
+    FEED("ms partial", microsoft_recv, "none",              0x40, 0x01);
+    FEED("ms resync", microsoft_recv, "00 2 0 0 0",         0x40, 0x02, 0x00);
+    FEED("ms merged", microsoft_recv, "00 3 -2 0 0",        0x40, 0x01, 0x00, 0x4C, 0x02, 0x3E);
+    // Logitech middle button stays until next 4th byte
+    FEED("ms middle", microsoft_recv, "04 1 0 0 0",         0x40, 0x01, 0x00, 0x20);
+    FEED("ms middle held", microsoft_recv, "05 1 0 0 0",    0x60, 0x01, 0x00);
+    FEED("ms middle released", microsoft_recv, "01 0 0 0 0", 0x60, 0x00, 0x00, 0x00);
+    FEED("ms stray", microsoft_recv, "none",                0x20, 0x01);
+    FEED("ms release", microsoft_recv, "00 0 0 0 0",        0x40, 0x00, 0x00);
+}
+
+/* 5 bytes: 1 0 0 0 0 L M R(0: pressed), X1, Y1, X2, Y2, Y is upward */
+static void test_mousesystems(void)
+{
+    FEED("msys move", mousesystems_recv, "00 7 -3 0 0",     0x87, 0x03, 0x02, 0x04, 0x01);
+    FEED("msys sync", mousesystems_recv, "01 -2 1 0 0",     0x00, 0x7F, 0x83, 0xFF, 0xFF, 0xFF, 0x00);
+    FEED("msys buttons", mousesystems_recv, "06 0 0 0 0",   0x84, 0x00, 0x00, 0x00, 0x00);
+    FEED("msys merged", mousesystems_recv, "00 254 -254 0 0",
+         0x87, 0x7F, 0x7F, 0x7F, 0x7F);
+    FEED("msys partial", mousesystems_recv, "none",         0x87, 0x01, 0x01, 0x01);
+    FEED("msys rest", mousesystems_recv, "00 2 -1 0 0",     0x00);
+#ifdef SERIAL_MOUSE_CENTER_SCROLL
+    FEED("msys scroll", mousesystems_recv, "00 0 0 2 1",    0x85, 0x01, 0x01, 0x00, 0x01);
+    FEED("msys middle", mousesystems_recv, "04 0 0 0 0",    0x85, 0x00, 0x00, 0x00, 0x00);
+#endif
+}
+
+
+int main(void)
+{
+    test_microsoft();
+    test_mousesystems();
+
+    printf("%u passed, %u failed\n", passed, failed);
+    return failed ? 1 : 0;
+}
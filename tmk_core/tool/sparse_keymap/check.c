@@ -0,0 +1,47 @@
+/*
+ * Checks sparse keymap tables generated by pack.c
+ *
+ *     usage: keymap_check
+ *
+ * Every key of every layer is looked up with tmk_core/common/keymap_sparse.c
+ * and compared with dense keymaps[]. Exits with non-zero on mismatch.
+ *
+ * Built for host and run by rules.mk after packing, with the same options
+ * as pack.c and keymap_sparse_table.h in include path.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "keycode.h"
+#include "matrix.h"
+#include KEYMAP_SRC
+#include "../../common/keymap_sparse.c"
+
+
+#define LAYERS  (sizeof(keymaps) / sizeof(keymaps[0]))
+
+int main(void)
+{
+    unsigned errors = 0;
+
+    for (unsigned layer = 0; layer < LAYERS; layer++) {
+        for (unsigned row = 0; row < MATRIX_ROWS; row++) {
+            for (unsigned col = 0; col < MATRIX_COLS; col++) {
+                keypos_t key = { .row = row, .col = col };
+                uint8_t want = keymaps[layer][row][col];
+                uint8_t got = keymap_sparse_keycode(layer, key);
+                if (got != want) {
+                    fprintf(stderr, "sparse keymap: layer %u row %u col %u: 0x%02X, not 0x%02X\n",
+                            layer, row, col, got, want);
+                    errors++;
+                }
+            }
+        }
+    }
+    // beyond keymaps[] is transparent
+    if (keymap_sparse_keycode(LAYERS, (keypos_t){ .row = 0, .col = 0 }) != KC_TRNS) {
+        fprintf(stderr, "sparse keymap: layer %u is not transparent\n", (unsigned)LAYERS);
+        errors++;
+    }
+    return errors ? 1 : 0;
+}
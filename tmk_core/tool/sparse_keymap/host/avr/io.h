@@ -0,0 +1 @@
+/* host build of keymap source for tool/sparse_keymap */
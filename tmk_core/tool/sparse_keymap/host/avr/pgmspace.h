@@ -0,0 +1,7 @@
+/* host build of keymap source for tool/sparse_keymap */
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+#define pgm_read_byte(p)    (*(const uint8_t *)(p))
+#define pgm_read_word(p)    (*(const uint16_t *)(p))
+#define pgm_read_dword(p)   (*(const uint32_t *)(p))
@@ -0,0 +1,92 @@
+/*
+ * Generates sparse keymap tables from dense keymaps[] for
+ * tmk_core/common/keymap_sparse.c
+ *
+ *     usage: keymap_pack <keymap name> > keymap_sparse_table.h
+ *
+ * Built for host by rules.mk with SPARSE_KEYMAP_ENABLE; keymap source is
+ * included with KEYMAP_SRC and CONFIG_H.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include "keycode.h"
+#include "matrix.h"
+#include KEYMAP_SRC
+
+
+#define LAYERS  (sizeof(keymaps) / sizeof(keymaps[0]))
+
+/* most common keycode of layer, KC_TRNS wins a tie, then lower keycode */
+static uint8_t fill_keycode(unsigned layer)
+{
+    unsigned count[256] = {};
+    uint8_t fill = KC_TRNS;
+
+    for (unsigned row = 0; row < MATRIX_ROWS; row++) {
+        for (unsigned col = 0; col < MATRIX_COLS; col++) {
+            count[keymaps[layer][row][col]]++;
+        }
+    }
+    for (unsigned keycode = 0; keycode < 256; keycode++) {
+        if (count[keycode] > count[fill]) fill = keycode;
+    }
+    return fill;
+}
+
+int main(int argc, char *argv[])
+{
+    uint8_t fill[LAYERS];
+    unsigned n = 0;
+
+    printf("/* Generated from %s by tool/sparse_keymap. Do not edit. */\n\n",
+           argc > 1 ? argv[1] : "keymap");
+    printf("#define SPARSE_KEYMAP_LAYERS %u\n\n", (unsigned)LAYERS);
+
+    printf("static const uint8_t PROGMEM sparse_fill[] = {\n   ");
+    for (unsigned layer = 0; layer < LAYERS; layer++) {
+        fill[layer] = fill_keycode(layer);
+        printf(" 0x%02X,", fill[layer]);
+    }
+    printf("\n};\n\n");
+
+    printf("static const sparse_row_t PROGMEM sparse_rows[][MATRIX_ROWS] = {\n");
+    for (unsigned layer = 0; layer < LAYERS; layer++) {
+        printf("    {   /* layer %u */\n", layer);
+        for (unsigned row = 0; row < MATRIX_ROWS; row++) {
+            uint32_t bits = 0;
+            unsigned index = n;
+            for (unsigned col = 0; col < MATRIX_COLS; col++) {
+                if (keymaps[layer][row][col] != fill[layer]) {
+                    bits |= (uint32_t)1 << col;
+                    n++;
+                }
+            }
+            printf("        { 0x%0*lX, %u },\n", (MATRIX_COLS + 3) / 4, (unsigned long)bits, index);
+        }
+        printf("    },\n");
+    }
+    printf("};\n\n");
+
+    printf("static const uint8_t PROGMEM sparse_keycodes[] = {");
+    for (unsigned layer = 0; layer < LAYERS; layer++) {
+        printf("\n    /* layer %u */", layer);
+        unsigned i = 0;
+        for (unsigned row = 0; row < MATRIX_ROWS; row++) {
+            for (unsigned col = 0; col < MATRIX_COLS; col++) {
+                uint8_t keycode = keymaps[layer][row][col];
+                if (keycode == fill[layer]) continue;
+                printf("%s0x%02X,", (i++ % 12) ? " " : "\n    ", keycode);
+            }
+        }
+    }
+    // no empty array when every layer is filled with one keycode
+    if (!n) printf("\n    KC_TRNS,");
+    printf("\n};\n");
+
+    unsigned dense = LAYERS * MATRIX_ROWS * MATRIX_COLS;
+    unsigned sparse = LAYERS * (1 + MATRIX_ROWS * (sizeof(matrix_row_t) + 2)) + (n ? n : 1);
+    printf("\n/* %u keys: %u bytes, dense keymaps: %u bytes */\n", n, sparse, dense);
+    fprintf(stderr, "sparse keymap: %u layers, %u bytes(dense: %u bytes)\n",
+            (unsigned)LAYERS, sparse, dense);
+    return 0;
+}
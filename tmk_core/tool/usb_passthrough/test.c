@@ -0,0 +1,133 @@
+/*
+ * Host tests of passthrough of converter/usb_usb/matrix.c
+ *
+ *     usage: test
+ *
+ * Key bitmaps are fed into matrix_scan() with a stub keymap and reports
+ * sent directly are checked against key changes queued for keyboard_task.
+ * Exits with non-zero when any of them fails.
+ *
+ *     cc -I../../../converter/usb_usb -I../../common -I../../protocol/usb_hid \
+ *         -DNO_PRINT -DNO_DEBUG -DCOMMAND_ENABLE -include config.h \
+ *         -o test test.c ../../common/util.c
+ */
+#include <stdio.h>
+#include <string.h>
+#include "../../../converter/usb_usb/matrix.c"
+
+
+/* stubs of USB host and action pipeline */
+uint8_t usb_hid_keyboard_bits[HID_PLAN_BITS_SIZE];
+uint16_t usb_hid_time_stamp;
+uint32_t layer_state = 0;
+uint32_t default_layer_state = 0;
+
+static bool tapping_idle = true;
+bool action_tapping_idle(void) { return tapping_idle; }
+
+/* layer 0: identity but CapsLock is LCtrl, layer 1: A is Escape */
+action_t layer_switch_get_action(keypos_t key)
+{
+    uint8_t code = CODE(key.row, key.col);
+    if (code == KC_CAPSLOCK) return (action_t){ .code = ACTION_KEY(KC_LCTRL) };
+    if ((layer_state & 2) && code == KC_A) return (action_t){ .code = ACTION_KEY(KC_ESC) };
+    return (action_t){ .code = ACTION_KEY(code) };
+}
+
+static report_keyboard_t report;
+report_keyboard_t *keyboard_report = &report;
+static unsigned reports_sent;
+
+void clear_keys(void) { memset(report.keys, 0, sizeof(report.keys)); }
+void set_mods(uint8_t mods) { report.mods = mods; }
+void add_key(uint8_t key)
+{
+    for (uint8_t i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
+        if (report.keys[i] == 0) { report.keys[i] = key; return; }
+    }
+}
+void send_keyboard_report(void) { reports_sent++; }
+
+
+static unsigned passed = 0, failed = 0;
+
+static void result(const char *name, int ok, const char *got)
+{
+    if (ok) {
+        passed++;
+    } else {
+        failed++;
+        printf("FAIL %s: got '%s'\n", name, got);
+    }
+}
+
+/* new key bitmap from keys down, 0 for none */
+static void keys(const uint8_t *codes, uint8_t n)
+{
+    memset(usb_hid_keyboard_bits, 0, sizeof(usb_hid_keyboard_bits));
+    for (uint8_t i = 0; i < n; i++) {
+        if (codes[i] == KC_NO) continue;
+        usb_hid_keyboard_bits[codes[i] >> 3] |= (1 << (codes[i] & 7));
+    }
+    usb_hid_time_stamp++;
+}
+
+/* result of a scan as "report 22 04 05" or "change +04 -39" */
+static void expect_scan(const char *name, const char *want)
+{
+    char got[256];
+    unsigned sent = reports_sent;
+    matrix_scan();
+    if (reports_sent != sent) {
+        sprintf(got, "report %02X", report.mods);
+        for (uint8_t i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
+            if (report.keys[i]) sprintf(got + strlen(got), " %02X", report.keys[i]);
+        }
+    } else {
+        keypos_t key;
+        bool pressed;
+        strcpy(got, "change");
+        while (matrix_get_change(&key, &pressed)) {
+            sprintf(got + strlen(got), " %c%02X", pressed ? '+' : '-', CODE(key.row, key.col));
+        }
+    }
+    result(name, strcmp(got, want) == 0, got);
+}
+
+#define SCAN(name, want, ...) do { \
+    const uint8_t codes[] = { __VA_ARGS__ }; \
+    keys(codes, sizeof(codes)); \
+    expect_scan(name, want); \
+} while (0)
+
+
+int main(void)
+{
+    SCAN("press", "report 00 04 05",            KC_A, KC_B);
+    SCAN("mods", "report 42 04",                KC_A, KC_LSHIFT, KC_RALT);
+    SCAN("release", "report 00",                0);
+    // keys passed directly are known to keyboard_task
+    SCAN("mapped key", "change +39 +E0",        KC_CAPSLOCK, KC_LCTRL);
+    SCAN("mapped key held", "change +04",       KC_CAPSLOCK, KC_LCTRL, KC_A);
+    SCAN("mapped key released", "change -39",   KC_LCTRL, KC_A);
+    SCAN("identity again", "report 01 04 05",   KC_LCTRL, KC_A, KC_B);
+    SCAN("all released", "report 00",           0);
+
+    tapping_idle = false;
+    SCAN("tapping", "change +04",               KC_A);
+    tapping_idle = true;
+    SCAN("tapping done", "report 00 04 05",     KC_A, KC_B);
+
+    layer_state = 2;
+    SCAN("layer changed", "change -05",         KC_A);
+    layer_state = 0;
+    SCAN("layer back", "report 00 04",          KC_A);
+    SCAN("release", "report 00",                0);
+
+    // command is handled in action pipeline
+    SCAN("command", "change +E1 +E5",           KC_LSHIFT, KC_RSHIFT);
+    SCAN("command released", "report 00",        0);
+
+    printf("%u passed, %u failed\n", passed, failed);
+    return failed ? 1 : 0;
+}